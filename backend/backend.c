@@ -8,9 +8,11 @@
 #include <wlr/backend/session.h>
 #include <wlr/backend/interface.h>
 #include <wlr/backend/drm.h>
+#include <wlr/backend/headless.h>
 #include <wlr/backend/libinput.h>
 #include <wlr/backend/wayland.h>
 #include <wlr/backend/multi.h>
+#include <wlr/backend/replay.h>
 #include <wlr/util/log.h>
 #include "backend/udev.h"
 
@@ -69,8 +71,68 @@ static struct wlr_backend *attempt_wl_backend(struct wl_display *display) {
 	return backend;
 }
 
+static struct wlr_backend *attempt_headless_backend(struct wl_display *display,
+		const char *_outputs) {
+	char *end;
+	int outputs = (int)strtol(_outputs, &end, 10);
+	if (*end || outputs < 0) {
+		wlr_log(L_ERROR, "WLR_HEADLESS_OUTPUTS specified with invalid integer, ignoring");
+		outputs = 1;
+	}
+
+	struct wlr_backend *backend = wlr_headless_backend_create(display);
+	if (backend) {
+		while (outputs--) {
+			wlr_headless_add_output(backend, 1280, 720);
+		}
+	}
+	return backend;
+}
+
+static struct wlr_backend *attempt_replay_backend(struct wl_display *display,
+		struct wlr_backend *headless, const char *path) {
+	double speed = 1;
+	const char *_speed = getenv("WLR_INPUT_REPLAY_SPEED");
+	if (_speed) {
+		char *end;
+		speed = strtod(_speed, &end);
+		if (*end || speed < 0) {
+			wlr_log(L_ERROR, "WLR_INPUT_REPLAY_SPEED specified with invalid number, ignoring");
+			speed = 1;
+		}
+	}
+
+	struct wlr_backend *replay = wlr_replay_backend_create(display, path, speed);
+	if (!replay) {
+		return NULL;
+	}
+	struct wlr_backend *backend = wlr_multi_backend_create(NULL, NULL);
+	if (!backend) {
+		wlr_backend_destroy(replay);
+		return NULL;
+	}
+	wlr_multi_backend_add(backend, headless);
+	wlr_multi_backend_add(backend, replay);
+	return backend;
+}
+
 struct wlr_backend *wlr_backend_autocreate(struct wl_display *display) {
 	struct wlr_backend *backend;
+	const char *headless_outputs = getenv("WLR_HEADLESS_OUTPUTS");
+	if (headless_outputs) {
+		backend = attempt_headless_backend(display, headless_outputs);
+		const char *replay_path = getenv("WLR_INPUT_REPLAY");
+		if (backend && replay_path) {
+			struct wlr_backend *multi =
+				attempt_replay_backend(display, backend, replay_path);
+			if (!multi) {
+				wlr_backend_destroy(backend);
+			}
+			return multi;
+		}
+		return backend;
+	}
+
 	if (getenv("WAYLAND_DISPLAY") || getenv("_WAYLAND_DISPLAY")) {
 		backend = attempt_wl_backend(display);
 		if (backend) {
@@ -97,11 +159,14 @@ struct wlr_backend *wlr_backend_autocreate(struct wl_display *display) {
 		goto error_session;
 	}
 
-	int gpu = wlr_udev_find_gpu(udev, session);
-	if (gpu == -1) {
+	int gpus[8];
+	size_t num_gpus = wlr_udev_find_gpus(udev, session,
+		sizeof(gpus) / sizeof(gpus[0]), gpus);
+	if (num_gpus == 0) {
 		wlr_log(L_ERROR, "Failed to open DRM device");
 		goto error_udev;
 	}
+	wlr_log(L_INFO, "Found %zu GPUs", num_gpus);
 
 	backend = wlr_multi_backend_create(session, udev);
 	if (!backend) {
@@ -113,13 +178,29 @@ struct wlr_backend *wlr_backend_autocreate(struct wl_display *display) {
 		goto error_multi;
 	}
 
-	struct wlr_backend *drm = wlr_drm_backend_create(display, session, udev, gpu);
-	if (!drm) {
+	// The first GPU renders everything, the others only scan out
+	struct wlr_backend *primary_drm =
+		wlr_drm_backend_create(display, session, udev, gpus[0], NULL);
+	if (!primary_drm) {
 		goto error_libinput;
 	}
 
 	wlr_multi_backend_add(backend, libinput);
-	wlr_multi_backend_add(backend, drm);
+	wlr_multi_backend_add(backend, primary_drm);
+
+	for (size_t i = 1; i < num_gpus; ++i) {
+		struct wlr_backend *drm =
+			wlr_drm_backend_create(display, session, udev, gpus[i], primary_drm);
+		if (!drm) {
+			wlr_log(L_ERROR, "Failed to create secondary DRM backend");
+			// Also stops the session from handing master on it around
+			wlr_session_close_file(session, gpus[i]);
+			continue;
+		}
+
+		wlr_multi_backend_add(backend, drm);
+	}
+
 	return backend;
 
 error_libinput:
@@ -127,7 +208,9 @@ error_libinput:
 error_multi:
 	wlr_backend_destroy(backend);
 error_gpu:
-	wlr_session_close_file(session, gpu);
+	for (size_t i = 0; i < num_gpus; ++i) {
+		wlr_session_close_file(session, gpus[i]);
+	}
 error_udev:
 	wlr_udev_destroy(udev);
 error_session:
@@ -95,12 +95,15 @@ static void drm_invalidated(struct wl_listener *listener, void *data) {
 }
 
 struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
-		struct wlr_session *session, struct wlr_udev *udev, int gpu_fd) {
+		struct wlr_session *session, struct wlr_udev *udev, int gpu_fd,
+		struct wlr_backend *parent) {
 	assert(display && session && gpu_fd >= 0);
+	assert(!parent || wlr_backend_is_drm(parent));
 
 	char *name = drmGetDeviceNameFromFd2(gpu_fd);
 	drmVersion *version = drmGetVersion(gpu_fd);
-	wlr_log(L_INFO, "Initalizing DRM backend for %s (%s)", name, version->name);
+	wlr_log(L_INFO, "Initalizing DRM backend for %s (%s)%s", name, version->name,
+		parent ? " as a secondary GPU" : "");
 	free(name);
 	drmFreeVersion(version);
 
@@ -113,6 +116,7 @@ struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
 
 	backend->session = session;
 	backend->udev = udev;
+	backend->parent = (struct wlr_drm_backend *)parent;
 	backend->outputs = list_create();
 	if (!backend->outputs) {
 		wlr_log(L_ERROR, "Failed to allocate list");
@@ -156,16 +160,18 @@ struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
 		goto error_event;
 	}
 
-	if (!wlr_egl_bind_display(&backend->renderer.egl, display)) {
+	// Clients only ever see the render GPU
+	if (!backend->parent && !wlr_egl_bind_display(&backend->renderer.egl, display)) {
 		wlr_log(L_INFO, "Failed to bind egl/wl display: %s", egl_error());
 	}
 
 	return &backend->backend;
 
 error_event:
+	wl_list_remove(&backend->session_signal.link);
 	wl_event_source_remove(backend->drm_event);
 error_fd:
-	wlr_session_close_file(backend->session, backend->fd);
+	// The caller still owns gpu_fd on failure
 	list_free(backend->outputs);
 error_backend:
 	free(backend);
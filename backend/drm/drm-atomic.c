@@ -72,13 +72,22 @@ static void set_plane_props(struct atomic *atom, struct wlr_drm_plane *plane,
 	uint32_t id = plane->id;
 	const union wlr_drm_plane_props *props = &plane->props;
 
+	const struct wlr_drm_surface *surf =
+		plane->mgpu_surf.gbm ? &plane->mgpu_surf : &plane->surf;
+	// The display engine scales the buffer if these differ
+	uint32_t src_width = plane->src_width ? plane->src_width : surf->width;
+	uint32_t src_height = plane->src_height ? plane->src_height : surf->height;
+	uint32_t crtc_width = plane->crtc_width ? plane->crtc_width : surf->width;
+	uint32_t crtc_height =
+		plane->crtc_height ? plane->crtc_height : surf->height;
+
 	// The src_* properties are in 16.16 fixed point
 	atomic_add(atom, id, props->src_x, 0);
 	atomic_add(atom, id, props->src_y, 0);
-	atomic_add(atom, id, props->src_w, plane->width << 16);
-	atomic_add(atom, id, props->src_h, plane->height << 16);
-	atomic_add(atom, id, props->crtc_w, plane->width);
-	atomic_add(atom, id, props->crtc_h, plane->height);
+	atomic_add(atom, id, props->src_w, (uint64_t)src_width << 16);
+	atomic_add(atom, id, props->src_h, (uint64_t)src_height << 16);
+	atomic_add(atom, id, props->crtc_w, crtc_width);
+	atomic_add(atom, id, props->crtc_h, crtc_height);
 	atomic_add(atom, id, props->fb_id, fb_id);
 	atomic_add(atom, id, props->crtc_id, crtc_id);
 	if (set_crtc_xy) {
@@ -113,6 +122,40 @@ static bool atomic_crtc_pageflip(struct wlr_drm_backend *backend,
 			output, mode ? DRM_MODE_ATOMIC_ALLOW_MODESET : 0);
 }
 
+static bool atomic_crtc_test(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *output, struct wlr_drm_crtc *crtc,
+		uint32_t fb_id, drmModeModeInfo *mode) {
+	uint32_t mode_id = crtc->mode_id;
+	if (mode && drmModeCreatePropertyBlob(backend->fd, mode,
+			sizeof(*mode), &mode_id)) {
+		wlr_log_errno(L_ERROR, "Unable to create property blob");
+		return false;
+	}
+
+	struct atomic atom;
+	bool ok = false;
+
+	atomic_begin(crtc, &atom);
+	if (!atom.failed) {
+		atomic_add(&atom, output->connector, output->props.crtc_id, crtc->id);
+		atomic_add(&atom, crtc->id, crtc->props.mode_id, mode_id);
+		atomic_add(&atom, crtc->id, crtc->props.active, 1);
+		set_plane_props(&atom, crtc->primary, crtc->id, fb_id, true);
+
+		uint32_t flags = DRM_MODE_ATOMIC_TEST_ONLY | DRM_MODE_ATOMIC_ALLOW_MODESET;
+		ok = !atom.failed &&
+			drmModeAtomicCommit(backend->fd, atom.req, flags, NULL) == 0;
+
+		// Only a test, don't leave anything behind for the next commit
+		drmModeAtomicSetCursor(atom.req, atom.cursor);
+	}
+
+	if (mode) {
+		drmModeDestroyPropertyBlob(backend->fd, mode_id);
+	}
+	return ok;
+}
+
 static void atomic_conn_enable(struct wlr_drm_backend *backend,
 		struct wlr_drm_output *output, bool enable) {
 	struct wlr_drm_crtc *crtc = output->crtc;
@@ -174,6 +217,7 @@ static bool atomic_crtc_move_cursor(struct wlr_drm_backend *backend,
 const struct wlr_drm_interface atomic_iface = {
 	.conn_enable = atomic_conn_enable,
 	.crtc_pageflip = atomic_crtc_pageflip,
+	.crtc_test = atomic_crtc_test,
 	.crtc_set_cursor = atomic_crtc_set_cursor,
 	.crtc_move_cursor = atomic_crtc_move_cursor,
 };
@@ -5,15 +5,39 @@
 #include "backend/drm.h"
 #include "backend/drm-util.h"
 
+// The legacy interface can't scale, the buffer has to match the CRTC
+static bool legacy_crtc_test(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *output, struct wlr_drm_crtc *crtc,
+		uint32_t fb_id, drmModeModeInfo *mode) {
+	struct wlr_drm_plane *plane = crtc->primary;
+	const struct wlr_drm_surface *surf =
+		plane->mgpu_surf.gbm ? &plane->mgpu_surf : &plane->surf;
+	uint32_t src_width = plane->src_width ? plane->src_width : surf->width;
+	uint32_t src_height = plane->src_height ? plane->src_height : surf->height;
+	uint32_t crtc_width = plane->crtc_width ? plane->crtc_width : surf->width;
+	uint32_t crtc_height =
+		plane->crtc_height ? plane->crtc_height : surf->height;
+
+	return src_width == crtc_width && src_height == crtc_height;
+}
+
 static bool legacy_crtc_pageflip(struct wlr_drm_backend *backend,
 		struct wlr_drm_output *output, struct wlr_drm_crtc *crtc,
 		uint32_t fb_id, drmModeModeInfo *mode) {
+	if (!legacy_crtc_test(backend, output, crtc, fb_id, mode)) {
+		return false;
+	}
+
 	if (mode) {
 		drmModeSetCrtc(backend->fd, crtc->id, fb_id, 0, 0,
 			&output->connector, 1, mode);
 	}
 
-	drmModePageFlip(backend->fd, crtc->id, fb_id, DRM_MODE_PAGE_FLIP_EVENT, output);
+	if (drmModePageFlip(backend->fd, crtc->id, fb_id,
+			DRM_MODE_PAGE_FLIP_EVENT, output)) {
+		wlr_log_errno(L_ERROR, "Page flip failed");
+		return false;
+	}
 
 	return true;
 }
@@ -38,7 +62,7 @@ bool legacy_crtc_set_cursor(struct wlr_drm_backend *backend,
 	struct wlr_drm_plane *plane = crtc->cursor;
 
 	if (drmModeSetCursor(backend->fd, crtc->id, gbm_bo_get_handle(bo).u32,
-			plane->width, plane->height)) {
+			plane->surf.width, plane->surf.height)) {
 		wlr_log_errno(L_ERROR, "Failed to set hardware cursor");
 		return false;
 	}
@@ -54,6 +78,7 @@ bool legacy_crtc_move_cursor(struct wlr_drm_backend *backend,
 const struct wlr_drm_interface legacy_iface = {
 	.conn_enable = legacy_conn_enable,
 	.crtc_pageflip = legacy_crtc_pageflip,
+	.crtc_test = legacy_crtc_test,
 	.crtc_set_cursor = legacy_crtc_set_cursor,
 	.crtc_move_cursor = legacy_crtc_move_cursor,
 };
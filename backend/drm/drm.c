@@ -1,9 +1,11 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <unistd.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 #include <drm_mode.h>
@@ -39,6 +41,15 @@ bool wlr_drm_check_features(struct wlr_drm_backend *backend) {
 		backend->iface = &atomic_iface;
 	}
 
+	uint64_t cap;
+	if (drmGetCap(backend->fd, DRM_CAP_TIMESTAMP_MONOTONIC, &cap) || !cap) {
+		wlr_log(L_INFO, "DRM timestamps are not CLOCK_MONOTONIC, "
+			"presentation times will be less accurate");
+		backend->monotonic_timestamps = false;
+	} else {
+		backend->monotonic_timestamps = true;
+	}
+
 	return true;
 }
 
@@ -183,6 +194,13 @@ bool wlr_drm_renderer_init(struct wlr_drm_renderer *renderer, int fd) {
 		return false;
 	}
 
+	if (strstr(renderer->egl.gl_exts, "GL_OES_EGL_image")) {
+		renderer->glEGLImageTargetTexture2DOES = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)
+			eglGetProcAddress("glEGLImageTargetTexture2DOES");
+	}
+	renderer->has_bgra =
+		strstr(renderer->egl.gl_exts, "GL_EXT_texture_format_BGRA8888");
+
 	renderer->fd = fd;
 	return true;
 }
@@ -192,57 +210,448 @@ void wlr_drm_renderer_free(struct wlr_drm_renderer *renderer) {
 		return;
 	}
 
+	if (renderer->blit_prog) {
+		eglMakeCurrent(renderer->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			renderer->egl.context);
+		glDeleteProgram(renderer->blit_prog);
+	}
+
 	wlr_egl_free(&renderer->egl);
 	gbm_device_destroy(renderer->gbm);
 }
 
-static bool wlr_drm_plane_renderer_init(struct wlr_drm_renderer *renderer,
-		struct wlr_drm_plane *plane, uint32_t width, uint32_t height, uint32_t format, uint32_t flags) {
-	if (plane->width == width && plane->height == height) {
+static void wlr_drm_surface_finish(struct wlr_drm_surface *surf);
+
+static bool wlr_drm_surface_init(struct wlr_drm_surface *surf,
+		struct wlr_drm_renderer *renderer, uint32_t width, uint32_t height,
+		uint32_t format, uint32_t flags) {
+	if (surf->width == width && surf->height == height) {
 		return true;
 	}
 
-	plane->width = width;
-	plane->height = height;
+	wlr_drm_surface_finish(surf);
 
-	plane->gbm = gbm_surface_create(renderer->gbm, width, height,
+	surf->renderer = renderer;
+	surf->width = width;
+	surf->height = height;
+
+	surf->gbm = gbm_surface_create(renderer->gbm, width, height,
 		format, GBM_BO_USE_RENDERING | flags);
-	if (!plane->gbm) {
-		wlr_log_errno(L_ERROR, "Failed to create GBM surface for plane");
+	if (!surf->gbm) {
+		wlr_log_errno(L_ERROR, "Failed to create GBM surface");
 		return false;
 	}
 
-	plane->egl = wlr_egl_create_surface(&renderer->egl, plane->gbm);
-	if (plane->egl == EGL_NO_SURFACE) {
-		wlr_log(L_ERROR, "Failed to create EGL surface for plane");
+	surf->egl = wlr_egl_create_surface(&renderer->egl, surf->gbm);
+	if (surf->egl == EGL_NO_SURFACE) {
+		wlr_log(L_ERROR, "Failed to create EGL surface");
 		return false;
 	}
 
 	return true;
 }
 
-static void wlr_drm_plane_renderer_free(struct wlr_drm_renderer *renderer,
-		struct wlr_drm_plane *plane) {
-	if (!renderer || !plane) {
+static void wlr_drm_mgpu_image_finish(struct wlr_drm_renderer *renderer,
+		struct wlr_drm_mgpu_image *img) {
+	if (img->tex) {
+		glDeleteTextures(1, &img->tex);
+	}
+	if (img->image) {
+		wlr_egl_destroy_image(&renderer->egl, img->image);
+	}
+
+	img->bo = NULL;
+	img->image = EGL_NO_IMAGE_KHR;
+	img->tex = 0;
+	img->swizzled = false;
+}
+
+static void wlr_drm_surface_finish(struct wlr_drm_surface *surf) {
+	if (!surf || !surf->renderer) {
 		return;
 	}
 
+	struct wlr_drm_renderer *renderer = surf->renderer;
+	size_t num_images = sizeof(surf->mgpu_images) / sizeof(surf->mgpu_images[0]);
+
+	eglMakeCurrent(renderer->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		renderer->egl.context);
+	for (size_t i = 0; i < num_images; ++i) {
+		wlr_drm_mgpu_image_finish(renderer, &surf->mgpu_images[i]);
+	}
 	eglMakeCurrent(renderer->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 
-	if (plane->front) {
-		gbm_surface_release_buffer(plane->gbm, plane->front);
+	if (surf->front) {
+		gbm_surface_release_buffer(surf->gbm, surf->front);
+	}
+	if (surf->back) {
+		gbm_surface_release_buffer(surf->gbm, surf->back);
+	}
+
+	if (surf->egl) {
+		eglDestroySurface(renderer->egl.display, surf->egl);
+	}
+	if (surf->gbm) {
+		gbm_surface_destroy(surf->gbm);
+	}
+
+	memset(surf, 0, sizeof(*surf));
+}
+
+static void wlr_drm_surface_make_current(struct wlr_drm_surface *surf) {
+	eglMakeCurrent(surf->renderer->egl.display, surf->egl, surf->egl,
+		surf->renderer->egl.context);
+}
+
+// Gives bo back to the surface, unless a mirror still scans it out
+static void wlr_drm_surface_release(struct wlr_drm_surface *surf,
+		struct gbm_bo *bo) {
+	size_t num_mirrored = sizeof(surf->mirrored) / sizeof(surf->mirrored[0]);
+	for (size_t i = 0; i < num_mirrored; ++i) {
+		if (surf->mirrored[i].bo == bo && surf->mirrored[i].refs > 0) {
+			surf->mirrored[i].released = true;
+			return;
+		}
+	}
+
+	gbm_surface_release_buffer(surf->gbm, bo);
+}
+
+static bool wlr_drm_surface_mirror_ref(struct wlr_drm_surface *surf,
+		struct gbm_bo *bo) {
+	size_t num_mirrored = sizeof(surf->mirrored) / sizeof(surf->mirrored[0]);
+	for (size_t i = 0; i < num_mirrored; ++i) {
+		if (surf->mirrored[i].bo == bo && surf->mirrored[i].refs > 0) {
+			++surf->mirrored[i].refs;
+			return true;
+		}
+	}
+
+	for (size_t i = 0; i < num_mirrored; ++i) {
+		if (surf->mirrored[i].refs == 0) {
+			surf->mirrored[i].bo = bo;
+			surf->mirrored[i].refs = 1;
+			surf->mirrored[i].released = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void wlr_drm_surface_mirror_unref(struct wlr_drm_surface *surf,
+		struct gbm_bo *bo) {
+	size_t num_mirrored = sizeof(surf->mirrored) / sizeof(surf->mirrored[0]);
+	for (size_t i = 0; i < num_mirrored; ++i) {
+		if (surf->mirrored[i].bo != bo || surf->mirrored[i].refs == 0) {
+			continue;
+		}
+
+		if (--surf->mirrored[i].refs == 0) {
+			if (surf->mirrored[i].released) {
+				gbm_surface_release_buffer(surf->gbm, bo);
+			}
+			surf->mirrored[i].bo = NULL;
+		}
+		return;
+	}
+}
+
+static struct gbm_bo *wlr_drm_surface_swap_buffers(struct wlr_drm_surface *surf) {
+	if (surf->front) {
+		wlr_drm_surface_release(surf, surf->front);
+	}
+
+	eglSwapBuffers(surf->renderer->egl.display, surf->egl);
+
+	surf->front = surf->back;
+	surf->back = gbm_surface_lock_front_buffer(surf->gbm);
+	return surf->back;
+}
+
+static const GLchar blit_vertex_src[] =
+	"attribute vec2 pos;\n"
+	"varying vec2 v_texcoord;\n"
+	"void main() {\n"
+	"	gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);\n"
+	"	v_texcoord = pos;\n"
+	"}\n";
+
+static const GLchar blit_fragment_src[] =
+	"precision mediump float;\n"
+	"varying vec2 v_texcoord;\n"
+	"uniform sampler2D tex;\n"
+	"uniform bool swizzle;\n"
+	"void main() {\n"
+	"	vec3 rgb = texture2D(tex, v_texcoord).rgb;\n"
+	"	gl_FragColor = vec4(swizzle ? rgb.bgr : rgb, 1.0);\n"
+	"}\n";
+
+static GLuint compile_blit_shader(GLenum type, const GLchar *src) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, NULL);
+	glCompileShader(shader);
+
+	GLint ok;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (ok == GL_FALSE) {
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+// Needs the context of renderer to be current
+static bool init_blit_prog(struct wlr_drm_renderer *renderer) {
+	GLuint vert = compile_blit_shader(GL_VERTEX_SHADER, blit_vertex_src);
+	GLuint frag = compile_blit_shader(GL_FRAGMENT_SHADER, blit_fragment_src);
+	if (!vert || !frag) {
+		wlr_log(L_ERROR, "Failed to compile multi-GPU copy shaders");
+		glDeleteShader(vert);
+		glDeleteShader(frag);
+		return false;
+	}
+
+	GLuint prog = glCreateProgram();
+	glAttachShader(prog, vert);
+	glAttachShader(prog, frag);
+	glBindAttribLocation(prog, 0, "pos");
+	glLinkProgram(prog);
+	glDetachShader(prog, vert);
+	glDetachShader(prog, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+
+	GLint ok;
+	glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+	if (ok == GL_FALSE) {
+		wlr_log(L_ERROR, "Failed to link multi-GPU copy program");
+		glDeleteProgram(prog);
+		return false;
+	}
+
+	renderer->blit_prog = prog;
+	renderer->blit_swizzle = glGetUniformLocation(prog, "swizzle");
+	return true;
+}
+
+// Imports a buffer from the render GPU into renderer using its dmabuf
+static EGLImageKHR import_bo(struct wlr_drm_renderer *renderer,
+		struct gbm_bo *bo) {
+	if (!renderer->glEGLImageTargetTexture2DOES ||
+			!strstr(renderer->egl.egl_exts, "EGL_EXT_image_dma_buf_import")) {
+		return EGL_NO_IMAGE_KHR;
 	}
-	if (plane->back) {
-		gbm_surface_release_buffer(plane->gbm, plane->back);
+
+	int fd = gbm_bo_get_fd(bo);
+	if (fd < 0) {
+		wlr_log(L_ERROR, "Failed to export buffer as dmabuf");
+		return EGL_NO_IMAGE_KHR;
+	}
+
+	EGLint attribs[] = {
+		EGL_WIDTH, gbm_bo_get_width(bo),
+		EGL_HEIGHT, gbm_bo_get_height(bo),
+		EGL_LINUX_DRM_FOURCC_EXT, gbm_bo_get_format(bo),
+		EGL_DMA_BUF_PLANE0_FD_EXT, fd,
+		EGL_DMA_BUF_PLANE0_OFFSET_EXT, gbm_bo_get_offset(bo, 0),
+		EGL_DMA_BUF_PLANE0_PITCH_EXT, gbm_bo_get_stride(bo),
+		EGL_NONE,
+	};
+
+	// dmabuf imports must not be given a context
+	EGLImageKHR image = renderer->egl.eglCreateImageKHR(renderer->egl.display,
+		EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+	close(fd);
+
+	if (image == EGL_NO_IMAGE_KHR) {
+		wlr_log(L_INFO, "Failed to import buffer from render GPU (%s), "
+			"falling back to CPU copies", egl_error());
+	}
+
+	return image;
+}
+
+static struct wlr_drm_mgpu_image *get_mgpu_image(struct wlr_drm_surface *dest,
+		struct gbm_bo *bo) {
+	size_t num_images = sizeof(dest->mgpu_images) / sizeof(dest->mgpu_images[0]);
+
+	for (size_t i = 0; i < num_images; ++i) {
+		if (dest->mgpu_images[i].bo == bo) {
+			return &dest->mgpu_images[i];
+		}
 	}
 
-	if (plane->egl) {
-		eglDestroySurface(renderer->egl.display, plane->egl);
+	struct wlr_drm_mgpu_image *img = &dest->mgpu_images[dest->mgpu_next];
+	dest->mgpu_next = (dest->mgpu_next + 1) % num_images;
+	wlr_drm_mgpu_image_finish(dest->renderer, img);
+
+	img->bo = bo;
+	glGenTextures(1, &img->tex);
+	glBindTexture(GL_TEXTURE_2D, img->tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	img->image = import_bo(dest->renderer, bo);
+	if (img->image != EGL_NO_IMAGE_KHR) {
+		dest->renderer->glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, img->image);
 	}
-	if (plane->gbm) {
-		gbm_surface_destroy(plane->gbm);
+
+	return img;
+}
+
+// Slow path for when the GPUs can't share buffers: read the frame back
+// through a linear mapping and upload it to the texture
+static bool cpu_copy(struct wlr_drm_renderer *renderer,
+		struct wlr_drm_mgpu_image *img, struct gbm_bo *bo) {
+	uint32_t width = gbm_bo_get_width(bo);
+	uint32_t height = gbm_bo_get_height(bo);
+	uint32_t stride;
+	void *map_data = NULL;
+
+	void *data = gbm_bo_map(bo, 0, 0, width, height,
+		GBM_BO_TRANSFER_READ, &stride, &map_data);
+	if (!data) {
+		wlr_log_errno(L_ERROR, "Failed to map buffer from render GPU");
+		return false;
 	}
 
+	// Without the extension, the blit swaps red and blue back
+	GLenum format = renderer->has_bgra ? GL_BGRA_EXT : GL_RGBA;
+	img->swizzled = !renderer->has_bgra;
+	glBindTexture(GL_TEXTURE_2D, img->tex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride / 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+		format, GL_UNSIGNED_BYTE, data);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+
+	gbm_bo_unmap(bo, map_data);
+	return true;
+}
+
+/*
+ * Copies bo, which was rendered on another GPU or into another output's
+ * surface, into dest and swaps it. The copy is scaled to dest's size.
+ * The copy is only queued here; the source buffer has to stay locked
+ * until the result has been scanned out.
+ */
+static struct gbm_bo *wlr_drm_surface_mgpu_copy(struct wlr_drm_surface *dest,
+		struct gbm_bo *bo) {
+	struct wlr_drm_renderer *renderer = dest->renderer;
+
+	wlr_drm_surface_make_current(dest);
+
+	if (!renderer->blit_prog && !init_blit_prog(renderer)) {
+		return NULL;
+	}
+
+	struct wlr_drm_mgpu_image *img = get_mgpu_image(dest, bo);
+	if (img->image == EGL_NO_IMAGE_KHR && !cpu_copy(renderer, img, bo)) {
+		return NULL;
+	}
+
+	static const GLfloat verts[] = {
+		0, 0,
+		1, 0,
+		0, 1,
+		1, 1,
+	};
+
+	glViewport(0, 0, dest->width, dest->height);
+	glDisable(GL_BLEND);
+	glUseProgram(renderer->blit_prog);
+	glUniform1i(renderer->blit_swizzle, img->swizzled);
+	glBindTexture(GL_TEXTURE_2D, img->tex);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, verts);
+	glEnableVertexAttribArray(0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glDisableVertexAttribArray(0);
+
+	return wlr_drm_surface_swap_buffers(dest);
+}
+
+/*
+ * Sets up plane to be rendered at width x height. If the scanout size
+ * differs, every frame is scaled into a separate surface with a blit.
+ */
+static bool wlr_drm_plane_surfaces_init(struct wlr_drm_backend *backend,
+		struct wlr_drm_plane *plane, uint32_t width, uint32_t height,
+		uint32_t scanout_width, uint32_t scanout_height, uint32_t format) {
+	if (backend->parent) {
+		// Render on the render GPU into a linear buffer both GPUs understand,
+		// then copy it into a buffer this GPU can scan out
+		if (!wlr_drm_surface_init(&plane->surf, &backend->parent->renderer,
+				width, height, format, GBM_BO_USE_LINEAR)) {
+			return false;
+		}
+	} else {
+		if (!wlr_drm_surface_init(&plane->surf, &backend->renderer,
+				width, height, format, GBM_BO_USE_SCANOUT)) {
+			return false;
+		}
+
+		if (width == scanout_width && height == scanout_height) {
+			wlr_drm_surface_finish(&plane->mgpu_surf);
+			return true;
+		}
+	}
+
+	return wlr_drm_surface_init(&plane->mgpu_surf, &backend->renderer,
+		scanout_width, scanout_height, format, GBM_BO_USE_SCANOUT);
+}
+
+/*
+ * (Re)creates the primary plane surfaces of output for its mode and render
+ * scale, and updates the output's resolution to the size rendered at.
+ */
+static bool wlr_drm_output_init_renderer(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *output) {
+	struct wlr_output_mode *mode = output->output.current_mode;
+	struct wlr_drm_plane *plane = output->crtc->primary;
+
+	uint32_t width = mode->width * output->render_scale + 0.5f;
+	uint32_t height = mode->height * output->render_scale + 0.5f;
+	if (width == 0 || height == 0) {
+		width = height = 1;
+	}
+
+	uint32_t scanout_width = width;
+	uint32_t scanout_height = height;
+	if (output->gl_upscale) {
+		scanout_width = mode->width;
+		scanout_height = mode->height;
+	}
+
+	if (!wlr_drm_plane_surfaces_init(backend, plane, width, height,
+			scanout_width, scanout_height, GBM_FORMAT_XRGB8888)) {
+		return false;
+	}
+
+	plane->crtc_width = mode->width;
+	plane->crtc_height = mode->height;
+
+	if (output->output.width != (int32_t)width ||
+			output->output.height != (int32_t)height) {
+		output->output.width = width;
+		output->output.height = height;
+		wlr_output_update_matrix(&output->output);
+		wl_signal_emit(&output->output.events.resolution, &output->output);
+	}
+	return true;
+}
+
+static void wlr_drm_plane_renderer_free(struct wlr_drm_plane *plane) {
+	if (!plane) {
+		return;
+	}
+
+	wlr_drm_surface_finish(&plane->surf);
+	wlr_drm_surface_finish(&plane->mgpu_surf);
+
 	if (plane->wlr_tex) {
 		wlr_texture_destroy(plane->wlr_tex);
 	}
@@ -253,52 +662,109 @@ static void wlr_drm_plane_renderer_free(struct wlr_drm_renderer *renderer,
 		gbm_bo_destroy(plane->cursor_bo);
 	}
 
-	plane->width = 0;
-	plane->height = 0;
-	plane->egl = EGL_NO_SURFACE;
-	plane->gbm = NULL;
-	plane->front = NULL;
-	plane->back = NULL;
 	plane->wlr_rend = NULL;
 	plane->wlr_tex = NULL;
 	plane->cursor_bo = NULL;
 }
 
-static void wlr_drm_plane_make_current(struct wlr_drm_renderer *renderer,
-		struct wlr_drm_plane *plane) {
-	eglMakeCurrent(renderer->egl.display, plane->egl, plane->egl,
-		renderer->egl.context);
+// Returns the buffer to scan out for the frame just drawn on plane
+static struct gbm_bo *wlr_drm_plane_swap_buffers(struct wlr_drm_plane *plane) {
+	struct gbm_bo *bo = wlr_drm_surface_swap_buffers(&plane->surf);
+	if (bo && plane->mgpu_surf.gbm) {
+		bo = wlr_drm_surface_mgpu_copy(&plane->mgpu_surf, bo);
+	}
+	return bo;
 }
 
-static void wlr_drm_plane_swap_buffers(struct wlr_drm_renderer *renderer,
+// The surface whose buffers end up on the CRTC
+static struct wlr_drm_surface *wlr_drm_plane_scanout_surf(
 		struct wlr_drm_plane *plane) {
-	if (plane->front) {
-		gbm_surface_release_buffer(plane->gbm, plane->front);
+	return plane->mgpu_surf.gbm ? &plane->mgpu_surf : &plane->surf;
+}
+
+static void mirror_show_frame(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *mirror, struct wlr_drm_surface *surf,
+		struct gbm_bo *bo) {
+	struct wlr_drm_crtc *crtc = mirror->crtc;
+	struct wlr_drm_plane *plane = crtc->primary;
+
+	if (!mirror->mirror_blit && wlr_drm_surface_mirror_ref(surf, bo)) {
+		plane->src_width = gbm_bo_get_width(bo);
+		plane->src_height = gbm_bo_get_height(bo);
+		if (backend->iface->crtc_pageflip(backend, mirror, crtc,
+				get_fb_for_bo(bo), NULL)) {
+			mirror->mirror_surf = surf;
+			mirror->mirror_back = bo;
+			mirror->pageflip_pending = true;
+			return;
+		}
+
+		wlr_drm_surface_mirror_unref(surf, bo);
+		wlr_log(L_INFO, "Cannot scan out '%s' on '%s', copying frames instead",
+			mirror->mirror_source->output.name, mirror->output.name);
+		mirror->mirror_blit = true;
+	}
+
+	plane->src_width = plane->src_height = 0;
+	struct gbm_bo *copy = wlr_drm_surface_mgpu_copy(
+		wlr_drm_plane_scanout_surf(plane), bo);
+	if (!copy) {
+		wlr_log(L_ERROR, "Failed to copy frame to '%s'", mirror->output.name);
+		return;
+	}
+
+	if (backend->iface->crtc_pageflip(backend, mirror, crtc,
+			get_fb_for_bo(copy), NULL)) {
+		mirror->pageflip_pending = true;
 	}
+}
+
+static void update_mirrors(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *source, struct gbm_bo *bo) {
+	struct wlr_drm_surface *surf =
+		wlr_drm_plane_scanout_surf(source->crtc->primary);
 
-	eglSwapBuffers(renderer->egl.display, plane->egl);
+	for (size_t i = 0; i < backend->outputs->length; ++i) {
+		struct wlr_drm_output *mirror = backend->outputs->items[i];
+		// Mirrors still busy with the previous frame skip this one
+		if (mirror->mirror_source != source ||
+				mirror->state != WLR_DRM_OUTPUT_CONNECTED ||
+				mirror->pageflip_pending) {
+			continue;
+		}
 
-	plane->front = plane->back;
-	plane->back = gbm_surface_lock_front_buffer(plane->gbm);
+		mirror_show_frame(backend, mirror, surf, bo);
+	}
 }
 
 static void wlr_drm_output_make_current(struct wlr_output *_output) {
 	struct wlr_drm_output *output = (struct wlr_drm_output *)_output;
-	wlr_drm_plane_make_current(output->renderer, output->crtc->primary);
+	wlr_drm_surface_make_current(&output->crtc->primary->surf);
 }
 
 static void wlr_drm_output_swap_buffers(struct wlr_output *_output) {
 	struct wlr_drm_output *output = (struct wlr_drm_output *)_output;
 	struct wlr_drm_backend *backend =
 		wl_container_of(output->renderer, backend, renderer);
-	struct wlr_drm_renderer *renderer = output->renderer;
 	struct wlr_drm_crtc *crtc = output->crtc;
 	struct wlr_drm_plane *plane = crtc->primary;
 
-	wlr_drm_plane_swap_buffers(renderer, plane);
+	if (output->mirror_source) {
+		wlr_log(L_DEBUG, "'%s' is mirroring, not presenting its own frame",
+			output->output.name);
+		return;
+	}
+
+	struct gbm_bo *bo = wlr_drm_plane_swap_buffers(plane);
+	if (!bo) {
+		wlr_log(L_ERROR, "Failed to get buffer for '%s'", output->output.name);
+		return;
+	}
 
-	backend->iface->crtc_pageflip(backend, output, crtc, get_fb_for_bo(plane->back), NULL);
+	backend->iface->crtc_pageflip(backend, output, crtc, get_fb_for_bo(bo), NULL);
 	output->pageflip_pending = true;
+
+	update_mirrors(backend, output, bo);
 }
 
 void wlr_drm_output_start_renderer(struct wlr_drm_output *output) {
@@ -308,27 +774,50 @@ void wlr_drm_output_start_renderer(struct wlr_drm_output *output) {
 
 	struct wlr_drm_backend *backend =
 		wl_container_of(output->renderer, backend, renderer);
-	struct wlr_drm_renderer *renderer = output->renderer;
 	struct wlr_drm_crtc *crtc = output->crtc;
 	struct wlr_drm_plane *plane = crtc->primary;
 
-	struct gbm_bo *bo = plane->front;
+	struct gbm_bo *bo = plane->mgpu_surf.gbm ?
+		plane->mgpu_surf.front : plane->surf.front;
 	if (!bo) {
 		// Render a black frame to start the rendering loop
-		wlr_drm_plane_make_current(renderer, plane);
-		glViewport(0, 0, plane->width, plane->height);
+		wlr_drm_surface_make_current(&plane->surf);
+		glViewport(0, 0, plane->surf.width, plane->surf.height);
 		glClearColor(0.0, 0.0, 0.0, 1.0);
 		glClear(GL_COLOR_BUFFER_BIT);
-		wlr_drm_plane_swap_buffers(renderer, plane);
 
-		bo = plane->back;
+		bo = wlr_drm_plane_swap_buffers(plane);
+		if (!bo) {
+			wlr_log(L_ERROR, "Failed to get buffer for '%s'", output->output.name);
+			return;
+		}
 	}
 
 	struct wlr_drm_output_mode *_mode =
 		(struct wlr_drm_output_mode *)output->output.current_mode;
 	drmModeModeInfo *mode = &_mode->mode;
-	backend->iface->crtc_pageflip(backend, output, crtc, get_fb_for_bo(bo), mode);
-	output->pageflip_pending = true;
+	plane->src_width = plane->src_height = 0;
+
+	// Make sure the display engine can do the upscaling before relying on it
+	if (output->render_scale < 1.0f && !output->gl_upscale &&
+			!backend->iface->crtc_test(backend, output, crtc,
+				get_fb_for_bo(bo), mode)) {
+		wlr_log(L_INFO, "Display engine can't scale '%s', "
+			"upscaling with GL instead", output->output.name);
+		output->gl_upscale = true;
+		if (!wlr_drm_output_init_renderer(backend, output)) {
+			wlr_log(L_ERROR, "Failed to initialize renderer for '%s'",
+				output->output.name);
+			return;
+		}
+		wlr_drm_output_start_renderer(output);
+		return;
+	}
+
+	if (backend->iface->crtc_pageflip(backend, output, crtc,
+			get_fb_for_bo(bo), mode)) {
+		output->pageflip_pending = true;
+	}
 }
 
 static void wlr_drm_output_enable(struct wlr_output *_output, bool enable) {
@@ -385,8 +874,8 @@ static void realloc_planes(struct wlr_drm_backend *backend, const uint32_t *crtc
 			struct wlr_drm_plane *new = &backend->type_planes[type][crtc_res[i]];
 
 			if (*old != new) {
-				wlr_drm_plane_renderer_free(&backend->renderer, *old);
-				wlr_drm_plane_renderer_free(&backend->renderer, new);
+				wlr_drm_plane_renderer_free(*old);
+				wlr_drm_plane_renderer_free(new);
 				*old = new;
 			}
 		}
@@ -500,25 +989,22 @@ static bool wlr_drm_output_set_mode(struct wlr_output *_output,
 		crtc->cursor ? crtc->cursor - backend->cursor_planes : -1);
 
 	output->state = WLR_DRM_OUTPUT_CONNECTED;
-	output->width = output->output.width = mode->width;
-	output->height = output->output.height = mode->height;
+	output->width = mode->width;
+	output->height = mode->height;
 	output->output.current_mode = mode;
-	wl_signal_emit(&output->output.events.resolution, &output->output);
+	// Scaling support depends on the mode, find out again
+	output->gl_upscale = false;
 
 	// Since realloc_crtcs can deallocate planes on OTHER outputs,
 	// we actually need to reinitalise all of them
 	for (size_t i = 0; i < backend->outputs->length; ++i) {
 		struct wlr_drm_output *output = backend->outputs->items[i];
-		struct wlr_output_mode *mode = output->output.current_mode;
-		struct wlr_drm_crtc *crtc = output->crtc;
 
 		if (output->state != WLR_DRM_OUTPUT_CONNECTED) {
 			continue;
 		}
 
-		if (!wlr_drm_plane_renderer_init(&backend->renderer, crtc->primary,
-				mode->width, mode->height, GBM_FORMAT_XRGB8888,
-				GBM_BO_USE_SCANOUT)) {
+		if (!wlr_drm_output_init_renderer(backend, output)) {
 			wlr_log(L_ERROR, "Failed to initalise renderer for plane");
 			goto error_enc;
 		}
@@ -567,7 +1053,7 @@ static bool wlr_drm_output_set_cursor(struct wlr_output *_output,
 		crtc->cursor = plane;
 	}
 
-	if (!plane->gbm) {
+	if (!plane->surf.gbm) {
 		int ret;
 		uint64_t w, h;
 		ret = drmGetCap(backend->fd, DRM_CAP_CURSOR_WIDTH, &w);
@@ -580,7 +1066,11 @@ static bool wlr_drm_output_set_cursor(struct wlr_output *_output,
 			return false;
 		}
 
-		if (!wlr_drm_plane_renderer_init(renderer, plane, w, h, GBM_FORMAT_ARGB8888, 0)) {
+		// The cursor is drawn on the render GPU and read back into cursor_bo
+		struct wlr_drm_backend *render_backend =
+			backend->parent ? backend->parent : backend;
+		if (!wlr_drm_surface_init(&plane->surf, &render_backend->renderer,
+				w, h, GBM_FORMAT_ARGB8888, 0)) {
 			wlr_log(L_ERROR, "Cannot allocate cursor resources");
 			return false;
 		}
@@ -594,10 +1084,10 @@ static bool wlr_drm_output_set_cursor(struct wlr_output *_output,
 
 		// OpenGL will read the pixels out upside down,
 		// so we need to flip the image vertically
-		wlr_matrix_texture(plane->matrix, plane->width, plane->height,
+		wlr_matrix_texture(plane->matrix, plane->surf.width, plane->surf.height,
 			output->output.transform ^ WL_OUTPUT_TRANSFORM_FLIPPED_180);
 
-		plane->wlr_rend = wlr_gles2_renderer_init(&backend->backend);
+		plane->wlr_rend = wlr_gles2_renderer_init(&render_backend->backend);
 		if (!plane->wlr_rend) {
 			return false;
 		}
@@ -620,12 +1110,12 @@ static bool wlr_drm_output_set_cursor(struct wlr_output *_output,
 		return false;
 	}
 
-	wlr_drm_plane_make_current(renderer, plane);
+	wlr_drm_surface_make_current(&plane->surf);
 
 	wlr_texture_upload_pixels(plane->wlr_tex, WL_SHM_FORMAT_ARGB8888,
 		stride, width, height, buf);
 
-	glViewport(0, 0, plane->width, plane->height);
+	glViewport(0, 0, plane->surf.width, plane->surf.height);
 	glClearColor(0.0, 0.0, 0.0, 0.0);
 	glClear(GL_COLOR_BUFFER_BIT);
 
@@ -635,10 +1125,10 @@ static bool wlr_drm_output_set_cursor(struct wlr_output *_output,
 
 	glFinish();
 	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, bo_stride);
-	glReadPixels(0, 0, plane->width, plane->height, GL_BGRA_EXT, GL_UNSIGNED_BYTE, bo_data);
+	glReadPixels(0, 0, plane->surf.width, plane->surf.height, GL_BGRA_EXT, GL_UNSIGNED_BYTE, bo_data);
 	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
 
-	wlr_drm_plane_swap_buffers(renderer, plane);
+	wlr_drm_surface_swap_buffers(&plane->surf);
 
 	gbm_bo_unmap(bo, bo_data);
 
@@ -650,6 +1140,9 @@ static bool wlr_drm_output_move_cursor(struct wlr_output *_output,
 	struct wlr_drm_output *output = (struct wlr_drm_output *)_output;
 	struct wlr_drm_backend *backend =
 		wl_container_of(output->renderer, backend, renderer);
+	// The cursor plane isn't scaled with the primary plane
+	x /= output->render_scale;
+	y /= output->render_scale;
 	return backend->iface->crtc_move_cursor(backend, output->crtc, x, y);
 }
 
@@ -723,6 +1216,7 @@ void wlr_drm_scan_connectors(struct wlr_drm_backend *backend) {
 
 			output->renderer = &backend->renderer;
 			output->state = WLR_DRM_OUTPUT_DISCONNECTED;
+			output->render_scale = 1.0f;
 			output->connector = conn->connector_id;
 
 			drmModeEncoder *curr_enc = drmModeGetEncoder(backend->fd,
@@ -792,6 +1286,9 @@ void wlr_drm_scan_connectors(struct wlr_drm_backend *backend) {
 	drmModeFreeResources(res);
 }
 
+static bool wlr_drm_output_rescale(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *output);
+
 static void page_flip_handler(int fd, unsigned seq,
 		unsigned tv_sec, unsigned tv_usec, void *user) {
 	struct wlr_drm_output *output = user;
@@ -804,12 +1301,49 @@ static void page_flip_handler(int fd, unsigned seq,
 	}
 
 	struct wlr_drm_plane *plane = output->crtc->primary;
-	if (plane->front) {
-		gbm_surface_release_buffer(plane->gbm, plane->front);
-		plane->front = NULL;
+	if (plane->surf.front) {
+		wlr_drm_surface_release(&plane->surf, plane->surf.front);
+		plane->surf.front = NULL;
 	}
+	if (plane->mgpu_surf.front) {
+		wlr_drm_surface_release(&plane->mgpu_surf, plane->mgpu_surf.front);
+		plane->mgpu_surf.front = NULL;
+	}
+
+	// Whatever was on screen before this flip isn't any more
+	if (output->mirror_front) {
+		wlr_drm_surface_mirror_unref(output->mirror_surf, output->mirror_front);
+	}
+	output->mirror_front = output->mirror_back;
+	output->mirror_back = NULL;
 
-	if (backend->session->active) {
+	struct timespec present_time = {
+		.tv_sec = tv_sec,
+		.tv_nsec = tv_usec * 1000,
+	};
+	if (!backend->monotonic_timestamps) {
+		// Old kernels report CLOCK_REALTIME, translate it
+		struct timespec mono, real;
+		clock_gettime(CLOCK_MONOTONIC, &mono);
+		clock_gettime(CLOCK_REALTIME, &real);
+		int64_t nsec = (int64_t)(present_time.tv_sec - real.tv_sec +
+			mono.tv_sec) * 1000000000 +
+			present_time.tv_nsec - real.tv_nsec + mono.tv_nsec;
+		present_time.tv_sec = nsec / 1000000000;
+		present_time.tv_nsec = nsec % 1000000000;
+	}
+	wlr_output_send_present(&output->output, &present_time, seq,
+		WLR_OUTPUT_PRESENT_VSYNC | WLR_OUTPUT_PRESENT_HW_CLOCK |
+		WLR_OUTPUT_PRESENT_HW_COMPLETION);
+
+	if (output->rescale_pending) {
+		// Frame events resume once the new surfaces are on screen
+		output->rescale_pending = false;
+		wlr_drm_output_rescale(backend, output);
+		return;
+	}
+
+	if (backend->session->active && !output->mirror_source) {
 		wl_signal_emit(&output->output.events.frame, &output->output);
 	}
 }
@@ -824,11 +1358,15 @@ int wlr_drm_event(int fd, uint32_t mask, void *data) {
 	return 1;
 }
 
-static void restore_output(struct wlr_drm_output *output, int fd) {
-	// Wait for any pending pageflips to finish
+static void wait_pageflip(struct wlr_drm_output *output) {
 	while (output->pageflip_pending) {
-		wlr_drm_event(fd, 0, NULL);
+		wlr_drm_event(output->renderer->fd, 0, NULL);
 	}
+}
+
+static void restore_output(struct wlr_drm_output *output, int fd) {
+	// Wait for any pending pageflips to finish
+	wait_pageflip(output);
 
 	drmModeCrtc *crtc = output->old_crtc;
 	if (!crtc) {
@@ -840,6 +1378,30 @@ static void restore_output(struct wlr_drm_output *output, int fd) {
 	drmModeFreeCrtc(crtc);
 }
 
+/*
+ * Takes the buffers of mirror's source off its CRTC and gives them back, so
+ * the source's surfaces can be finished. The CRTC shows a frame of mirror's
+ * own instead until the source's next frame.
+ */
+static void mirror_drop_source_buffers(struct wlr_drm_output *mirror) {
+	wait_pageflip(mirror);
+	// page_flip_handler unrefs the source's buffer once this replaced it
+	wlr_drm_output_start_renderer(mirror);
+	if (mirror->mirror_front) {
+		wait_pageflip(mirror);
+	}
+
+	// Not flipped away, e.g. because the session is inactive
+	if (mirror->mirror_front) {
+		wlr_drm_surface_mirror_unref(mirror->mirror_surf, mirror->mirror_front);
+	}
+	if (mirror->mirror_back) {
+		wlr_drm_surface_mirror_unref(mirror->mirror_surf, mirror->mirror_back);
+	}
+	mirror->mirror_front = mirror->mirror_back = NULL;
+	mirror->mirror_surf = NULL;
+}
+
 void wlr_drm_output_cleanup(struct wlr_drm_output *output, bool restore) {
 	if (!output) {
 		return;
@@ -851,6 +1413,22 @@ void wlr_drm_output_cleanup(struct wlr_drm_output *output, bool restore) {
 
 	switch (output->state) {
 	case WLR_DRM_OUTPUT_CONNECTED:
+		for (size_t i = 0; i < backend->outputs->length; ++i) {
+			struct wlr_drm_output *mirror = backend->outputs->items[i];
+			if (mirror->mirror_source == output) {
+				wlr_drm_output_set_mirror(&mirror->output, NULL);
+			}
+		}
+		output->mirror_source = NULL;
+		if (output->mirror_front) {
+			wlr_drm_surface_mirror_unref(output->mirror_surf, output->mirror_front);
+		}
+		if (output->mirror_back) {
+			wlr_drm_surface_mirror_unref(output->mirror_surf, output->mirror_back);
+		}
+		output->mirror_front = output->mirror_back = NULL;
+		output->mirror_surf = NULL;
+
 		output->state = WLR_DRM_OUTPUT_DISCONNECTED;
 		if (restore) {
 			restore_output(output, renderer->fd);
@@ -859,7 +1437,7 @@ void wlr_drm_output_cleanup(struct wlr_drm_output *output, bool restore) {
 
 		struct wlr_drm_crtc *crtc = output->crtc;
 		for (int i = 0; i < 3; ++i) {
-			wlr_drm_plane_renderer_free(renderer, crtc->planes[i]);
+			wlr_drm_plane_renderer_free(crtc->planes[i]);
 			if (crtc->planes[i] && crtc->planes[i]->id == 0) {
 				free(crtc->planes[i]);
 				crtc->planes[i] = NULL;
@@ -882,3 +1460,110 @@ void wlr_drm_output_cleanup(struct wlr_drm_output *output, bool restore) {
 		break;
 	}
 }
+
+bool wlr_drm_output_set_mirror(struct wlr_output *_mirror,
+		struct wlr_output *_source) {
+	if (_mirror->impl != &output_impl ||
+			(_source && _source->impl != &output_impl)) {
+		wlr_log(L_ERROR, "Only DRM outputs can be mirrored");
+		return false;
+	}
+
+	struct wlr_drm_output *mirror = (struct wlr_drm_output *)_mirror;
+	struct wlr_drm_output *source = (struct wlr_drm_output *)_source;
+
+	if (source) {
+		if (source == mirror || source->renderer != mirror->renderer) {
+			wlr_log(L_ERROR, "Cannot mirror '%s' on '%s'",
+				source->output.name, mirror->output.name);
+			return false;
+		}
+		if (source->mirror_source) {
+			wlr_log(L_ERROR, "'%s' is a mirror itself", source->output.name);
+			return false;
+		}
+
+		struct wlr_drm_backend *backend =
+			wl_container_of(mirror->renderer, backend, renderer);
+		for (size_t i = 0; i < backend->outputs->length; ++i) {
+			struct wlr_drm_output *output = backend->outputs->items[i];
+			if (output->mirror_source == mirror) {
+				wlr_log(L_ERROR, "'%s' is being mirrored itself",
+					mirror->output.name);
+				return false;
+			}
+		}
+
+		wlr_log(L_INFO, "Mirroring '%s' on '%s'", source->output.name,
+			mirror->output.name);
+	} else if (mirror->mirror_source) {
+		wlr_log(L_INFO, "Stopping mirroring on '%s'", mirror->output.name);
+	}
+
+	if (mirror->mirror_source) {
+		// Frames of the old source mustn't outlive its surfaces, and
+		// mirror_surf only tracks one source
+		mirror->mirror_source = NULL;
+		mirror_drop_source_buffers(mirror);
+	}
+
+	mirror->mirror_source = source;
+	mirror->mirror_blit = false;
+
+	return true;
+}
+
+bool wlr_drm_output_set_render_scale(struct wlr_output *_output, float scale) {
+	if (_output->impl != &output_impl) {
+		wlr_log(L_ERROR, "Render scale is only supported on DRM outputs");
+		return false;
+	}
+	if (!(scale > 0.0f && scale <= 1.0f)) {
+		wlr_log(L_ERROR, "Invalid render scale %f", scale);
+		return false;
+	}
+
+	struct wlr_drm_output *output = (struct wlr_drm_output *)_output;
+	struct wlr_drm_backend *backend =
+		wl_container_of(output->renderer, backend, renderer);
+
+	wlr_log(L_INFO, "Rendering '%s' at %.0f%% of its resolution",
+		output->output.name, scale * 100.0f);
+	output->render_scale = scale;
+	output->gl_upscale = false;
+
+	if (output->state != WLR_DRM_OUTPUT_CONNECTED) {
+		return true;
+	}
+
+	// The surfaces hold the buffer being flipped to, page_flip_handler
+	// recreates them once it is on screen
+	if (output->pageflip_pending) {
+		output->rescale_pending = true;
+		return true;
+	}
+	return wlr_drm_output_rescale(backend, output);
+}
+
+/*
+ * Recreates the surfaces of output for its render scale and starts rendering
+ * on them. Only call this without a flip pending, the old surfaces' buffers
+ * are destroyed.
+ */
+static bool wlr_drm_output_rescale(struct wlr_drm_backend *backend,
+		struct wlr_drm_output *output) {
+	for (size_t i = 0; i < backend->outputs->length; ++i) {
+		struct wlr_drm_output *mirror = backend->outputs->items[i];
+		if (mirror->mirror_source == output) {
+			mirror_drop_source_buffers(mirror);
+		}
+	}
+
+	if (!wlr_drm_output_init_renderer(backend, output)) {
+		wlr_log(L_ERROR, "Failed to initialize renderer for '%s'",
+			output->output.name);
+		return false;
+	}
+	wlr_drm_output_start_renderer(output);
+	return true;
+}
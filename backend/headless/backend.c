@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <wayland-server.h>
+#include <wlr/egl.h>
+#include <wlr/backend/interface.h>
+#include <wlr/util/log.h>
+#include "backend/headless.h"
+
+static bool wlr_headless_backend_start(struct wlr_backend *_backend) {
+	struct wlr_headless_backend *backend = (struct wlr_headless_backend *)_backend;
+	wlr_log(L_INFO, "Starting headless backend");
+
+	backend->started = true;
+	for (size_t i = 0; i < backend->outputs->length; ++i) {
+		wlr_headless_output_start(backend->outputs->items[i]);
+	}
+
+	return true;
+}
+
+static void wlr_headless_backend_destroy(struct wlr_backend *_backend) {
+	struct wlr_headless_backend *backend = (struct wlr_headless_backend *)_backend;
+	if (!_backend) {
+		return;
+	}
+
+	// Destroying an output removes it from the list
+	while (backend->outputs->length > 0) {
+		wlr_output_destroy(backend->outputs->items[0]);
+	}
+
+	list_free(backend->outputs);
+	wlr_egl_free(&backend->egl);
+	free(backend);
+}
+
+static struct wlr_egl *wlr_headless_backend_get_egl(struct wlr_backend *_backend) {
+	struct wlr_headless_backend *backend = (struct wlr_headless_backend *)_backend;
+	return &backend->egl;
+}
+
+static struct wlr_backend_impl backend_impl = {
+	.start = wlr_headless_backend_start,
+	.destroy = wlr_headless_backend_destroy,
+	.get_egl = wlr_headless_backend_get_egl,
+};
+
+bool wlr_backend_is_headless(struct wlr_backend *b) {
+	return b->impl == &backend_impl;
+}
+
+struct wlr_backend *wlr_headless_backend_create(struct wl_display *display) {
+	wlr_log(L_INFO, "Creating headless backend");
+
+	struct wlr_headless_backend *backend =
+		calloc(1, sizeof(struct wlr_headless_backend));
+	if (!backend) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_backend_init(&backend->backend, &backend_impl);
+
+	backend->display = display;
+	backend->outputs = list_create();
+	if (!backend->outputs) {
+		wlr_log(L_ERROR, "Could not allocate outputs list");
+		goto error_backend;
+	}
+
+	if (!wlr_egl_init(&backend->egl, EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY)) {
+		wlr_log(L_ERROR, "Failed to initialize surfaceless EGL");
+		goto error_outputs;
+	}
+
+	if (!wlr_egl_bind_display(&backend->egl, display)) {
+		wlr_log(L_INFO, "Failed to bind egl/wl display: %s", egl_error());
+	}
+
+	return &backend->backend;
+
+error_outputs:
+	list_free(backend->outputs);
+error_backend:
+	free(backend);
+	return NULL;
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <wayland-server.h>
+#include <wlr/interfaces/wlr_output.h>
+#include <wlr/util/log.h>
+#include "backend/headless.h"
+
+static EGLSurface create_surface(struct wlr_headless_backend *backend,
+		int32_t width, int32_t height) {
+	EGLint attribs[] = {
+		EGL_WIDTH, width,
+		EGL_HEIGHT, height,
+		EGL_NONE,
+	};
+
+	EGLSurface surf = eglCreatePbufferSurface(backend->egl.display,
+		backend->egl.config, attribs);
+	if (surf == EGL_NO_SURFACE) {
+		wlr_log(L_ERROR, "Failed to create offscreen surface: %s", egl_error());
+	}
+	return surf;
+}
+
+static int signal_frame(void *data) {
+	struct wlr_headless_output *output = data;
+	wlr_output_send_present(&output->wlr_output, NULL, 0, 0);
+	wl_signal_emit(&output->wlr_output.events.frame, &output->wlr_output);
+	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+	return 0;
+}
+
+static void wlr_headless_output_enable(struct wlr_output *_output, bool enable) {
+	struct wlr_headless_output *output = (struct wlr_headless_output *)_output;
+	wl_event_source_timer_update(output->frame_timer,
+		enable ? output->frame_delay : 0);
+}
+
+static bool wlr_headless_output_set_mode(struct wlr_output *_output,
+		struct wlr_output_mode *mode) {
+	struct wlr_headless_output *output = (struct wlr_headless_output *)_output;
+	struct wlr_headless_backend *backend = output->backend;
+
+	if (mode->width <= 0 || mode->height <= 0) {
+		wlr_log(L_ERROR, "Invalid mode %"PRId32"x%"PRId32,
+			mode->width, mode->height);
+		return false;
+	}
+
+	EGLSurface surf = create_surface(backend, mode->width, mode->height);
+	if (surf == EGL_NO_SURFACE) {
+		return false;
+	}
+
+	if (output->egl_surface != EGL_NO_SURFACE) {
+		eglDestroySurface(backend->egl.display, output->egl_surface);
+	}
+	output->egl_surface = surf;
+
+	int32_t refresh = mode->refresh > 0 ? mode->refresh : HEADLESS_DEFAULT_REFRESH;
+	output->frame_delay = 1000000 / refresh;
+
+	output->wlr_output.width = mode->width;
+	output->wlr_output.height = mode->height;
+	output->wlr_output.current_mode = mode;
+	wl_signal_emit(&output->wlr_output.events.resolution, &output->wlr_output);
+
+	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+	return true;
+}
+
+static void wlr_headless_output_transform(struct wlr_output *output,
+		enum wl_output_transform transform) {
+	output->transform = transform;
+}
+
+static void wlr_headless_output_make_current(struct wlr_output *_output) {
+	struct wlr_headless_output *output = (struct wlr_headless_output *)_output;
+	struct wlr_egl *egl = &output->backend->egl;
+	if (!eglMakeCurrent(egl->display, output->egl_surface,
+			output->egl_surface, egl->context)) {
+		wlr_log(L_ERROR, "eglMakeCurrent failed: %s", egl_error());
+	}
+}
+
+static void wlr_headless_output_swap_buffers(struct wlr_output *_output) {
+	// Nothing is displayed, but the frame still needs to be rendered for
+	// the next one to be timed realistically
+	glFlush();
+}
+
+static void wlr_headless_output_destroy(struct wlr_output *_output) {
+	struct wlr_headless_output *output = (struct wlr_headless_output *)_output;
+	struct wlr_headless_backend *backend = output->backend;
+
+	for (size_t i = 0; i < backend->outputs->length; ++i) {
+		if (backend->outputs->items[i] == output) {
+			list_del(backend->outputs, i);
+			break;
+		}
+	}
+
+	if (backend->started) {
+		wl_signal_emit(&backend->backend.events.output_remove, &output->wlr_output);
+	}
+
+	wl_event_source_remove(output->frame_timer);
+	wl_global_destroy(output->wlr_output.wl_global);
+	eglMakeCurrent(backend->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		EGL_NO_CONTEXT);
+	eglDestroySurface(backend->egl.display, output->egl_surface);
+	free(output);
+}
+
+static struct wlr_output_impl output_impl = {
+	.enable = wlr_headless_output_enable,
+	.set_mode = wlr_headless_output_set_mode,
+	.transform = wlr_headless_output_transform,
+	.destroy = wlr_headless_output_destroy,
+	.make_current = wlr_headless_output_make_current,
+	.swap_buffers = wlr_headless_output_swap_buffers,
+};
+
+void wlr_headless_output_start(struct wlr_headless_output *output) {
+	wl_signal_emit(&output->backend->backend.events.output_add,
+		&output->wlr_output);
+	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+}
+
+struct wlr_output *wlr_headless_add_output(struct wlr_backend *_backend,
+		int32_t width, int32_t height) {
+	assert(wlr_backend_is_headless(_backend));
+	struct wlr_headless_backend *backend = (struct wlr_headless_backend *)_backend;
+
+	struct wlr_headless_output *output =
+		calloc(1, sizeof(struct wlr_headless_output));
+	if (!output) {
+		wlr_log(L_ERROR, "Failed to allocate wlr_headless_output");
+		return NULL;
+	}
+	output->backend = backend;
+	wlr_output_init(&output->wlr_output, &output_impl);
+	struct wlr_output *wlr_output = &output->wlr_output;
+
+	struct wlr_output_mode *mode = calloc(1, sizeof(struct wlr_output_mode));
+	if (!mode) {
+		wlr_log(L_ERROR, "Failed to allocate wlr_output_mode");
+		goto error;
+	}
+	mode->flags = WL_OUTPUT_MODE_PREFERRED;
+	mode->width = width;
+	mode->height = height;
+	mode->refresh = HEADLESS_DEFAULT_REFRESH;
+	list_add(wlr_output->modes, mode);
+
+	output->egl_surface = create_surface(backend, width, height);
+	if (output->egl_surface == EGL_NO_SURFACE) {
+		goto error;
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(backend->display);
+	output->frame_timer = wl_event_loop_add_timer(loop, signal_frame, output);
+	if (!output->frame_timer) {
+		wlr_log(L_ERROR, "Failed to create frame timer");
+		eglDestroySurface(backend->egl.display, output->egl_surface);
+		goto error;
+	}
+	output->frame_delay = 1000000 / mode->refresh;
+
+	wlr_output->width = width;
+	wlr_output->height = height;
+	wlr_output->current_mode = mode;
+	wlr_output->scale = 1;
+	strncpy(wlr_output->make, "headless", sizeof(wlr_output->make));
+	strncpy(wlr_output->model, "headless", sizeof(wlr_output->model));
+	snprintf(wlr_output->name, sizeof(wlr_output->name), "HEADLESS-%zd",
+		backend->outputs->length + 1);
+	wlr_output_update_matrix(wlr_output);
+
+	wlr_output_create_global(wlr_output, backend->display);
+	list_add(backend->outputs, output);
+
+	if (backend->started) {
+		wlr_headless_output_start(output);
+	}
+
+	return wlr_output;
+
+error:
+	// Frees the modes and the output itself
+	wlr_output->impl = NULL;
+	wlr_output_destroy(wlr_output);
+	return NULL;
+}
@@ -1,5 +1,9 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
 #include <libinput.h>
 #include <wlr/backend/session.h>
 #include <wlr/backend/interface.h>
@@ -7,14 +11,32 @@
 #include "backend/udev.h"
 #include "backend/libinput.h"
 
+#define WLR_LIBINPUT_SEAT "seat0"
+
 static int wlr_libinput_open_restricted(const char *path,
 		int flags, void *_backend) {
 	struct wlr_libinput_backend *backend = _backend;
+	struct wlr_libinput_preopened *preopened;
+	wl_array_for_each(preopened, &backend->preopened) {
+		if (preopened->fd >= 0 && strcmp(preopened->path, path) == 0) {
+			int fd = preopened->fd;
+			preopened->fd = -1;
+			return fd;
+		}
+	}
+	// Hotplug on the input thread
+	if (backend->thread && wlr_libinput_thread_is_current(backend->thread)) {
+		return wlr_libinput_thread_open_file(backend->thread, path);
+	}
 	return wlr_session_open_file(backend->session, path);
 }
 
 static void wlr_libinput_close_restricted(int fd, void *_backend) {
 	struct wlr_libinput_backend *backend = _backend;
+	if (backend->thread && wlr_libinput_thread_is_current(backend->thread)) {
+		wlr_libinput_thread_close_file(backend->thread, fd);
+		return;
+	}
 	wlr_session_close_file(backend->session, fd);
 }
 
@@ -31,13 +53,96 @@ static int wlr_libinput_readable(int fd, uint32_t mask, void *_backend) {
 		return 0;
 	}
 	struct libinput_event *event;
+	struct wlr_libinput_input_event input_event;
 	while ((event = libinput_get_event(backend->libinput_context))) {
-		wlr_libinput_event(backend, event);
+		bool emit = wlr_libinput_event_convert(event, &input_event);
+		if (emit) {
+			wlr_libinput_event_emit(backend, &input_event);
+		}
 		libinput_event_destroy(event);
 	}
 	return 0;
 }
 
+/**
+ * Opens the evdev nodes of the seat in one go, so libinput doesn't pay a
+ * session round trip for each of them when it probes the devices.
+ */
+static void preopen_devices(struct wlr_libinput_backend *backend) {
+	struct udev_enumerate *en = udev_enumerate_new(backend->udev->udev);
+	if (!en) {
+		wlr_log(L_ERROR, "Failed to create udev enumeration");
+		return;
+	}
+	udev_enumerate_add_match_subsystem(en, "input");
+	udev_enumerate_add_match_sysname(en, "event[0-9]*");
+	udev_enumerate_scan_devices(en);
+
+	struct udev_list_entry *entry;
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(en)) {
+		struct udev_device *dev = udev_device_new_from_syspath(
+			backend->udev->udev, udev_list_entry_get_name(entry));
+		if (!dev) {
+			continue;
+		}
+		const char *seat = udev_device_get_property_value(dev, "ID_SEAT");
+		const char *devnode = udev_device_get_devnode(dev);
+		if (devnode && strcmp(seat ? seat : "seat0", WLR_LIBINPUT_SEAT) == 0) {
+			struct wlr_libinput_preopened *preopened =
+				wl_array_add(&backend->preopened, sizeof(*preopened));
+			if (preopened) {
+				preopened->path = strdup(devnode);
+				preopened->fd = -1;
+				if (!preopened->path) {
+					backend->preopened.size -= sizeof(*preopened);
+				}
+			}
+		}
+		udev_device_unref(dev);
+	}
+	udev_enumerate_unref(en);
+
+	size_t n = backend->preopened.size / sizeof(struct wlr_libinput_preopened);
+	if (n == 0) {
+		return;
+	}
+	const char **paths = calloc(n, sizeof(const char *));
+	int *fds = calloc(n, sizeof(int));
+	if (!paths || !fds) {
+		wlr_log(L_ERROR, "Allocation failed, opening input devices one by one");
+		goto out;
+	}
+	struct wlr_libinput_preopened *preopened = backend->preopened.data;
+	for (size_t i = 0; i < n; ++i) {
+		paths[i] = preopened[i].path;
+	}
+	wlr_session_open_files(backend->session, n, paths, fds);
+	for (size_t i = 0; i < n; ++i) {
+		// libinput opens failed ones again itself and reports the error
+		preopened[i].fd = fds[i] >= 0 ? fds[i] : -1;
+	}
+	wlr_log(L_DEBUG, "Pre-opened %zu input devices", n);
+
+out:
+	free(paths);
+	free(fds);
+}
+
+/**
+ * Closes whatever libinput didn't take, e.g. devices it ignored.
+ */
+static void close_preopened(struct wlr_libinput_backend *backend) {
+	struct wlr_libinput_preopened *preopened;
+	wl_array_for_each(preopened, &backend->preopened) {
+		if (preopened->fd >= 0) {
+			wlr_session_close_file(backend->session, preopened->fd);
+		}
+		free(preopened->path);
+	}
+	wl_array_release(&backend->preopened);
+	wl_array_init(&backend->preopened);
+}
+
 static void wlr_libinput_log(struct libinput *libinput_context,
 		enum libinput_log_priority priority, const char *fmt, va_list args) {
 	_wlr_vlog(L_ERROR, fmt, args);
@@ -54,7 +159,11 @@ static bool wlr_libinput_backend_start(struct wlr_backend *_backend) {
 	}
 
 	// TODO: Let user customize seat used
-	if (libinput_udev_assign_seat(backend->libinput_context, "seat0") != 0) {
+	preopen_devices(backend);
+	int ret = libinput_udev_assign_seat(backend->libinput_context,
+		WLR_LIBINPUT_SEAT);
+	close_preopened(backend);
+	if (ret != 0) {
 		wlr_log(L_ERROR, "Failed to assign libinput seat");
 		return false;
 	}
@@ -63,6 +172,16 @@ static bool wlr_libinput_backend_start(struct wlr_backend *_backend) {
 	libinput_log_set_handler(backend->libinput_context, wlr_libinput_log);
 	libinput_log_set_priority(backend->libinput_context, LIBINPUT_LOG_PRIORITY_ERROR);
 
+	if (backend->use_thread) {
+		wlr_libinput_thread_destroy(backend->thread);
+		if (!wlr_libinput_thread_create(backend)) {
+			wlr_log(L_ERROR, "Failed to start input thread");
+			return false;
+		}
+		wlr_log(L_DEBUG, "libinput sucessfully initialized on input thread");
+		return true;
+	}
+
 	struct wl_event_loop *event_loop =
 		wl_display_get_event_loop(backend->display);
 	if (backend->input_event) {
@@ -79,22 +198,43 @@ static bool wlr_libinput_backend_start(struct wlr_backend *_backend) {
 	return true;
 }
 
+static void log_latency_histogram(struct wlr_libinput_backend *backend) {
+	uint64_t total = 0;
+	for (size_t i = 0; i < WLR_LIBINPUT_LATENCY_BUCKETS; ++i) {
+		total += backend->latency_histogram[i];
+	}
+	if (total == 0) {
+		return;
+	}
+	wlr_log(L_INFO, "Age of %" PRIu64 " input events when emitted:", total);
+	for (size_t i = 0; i < WLR_LIBINPUT_LATENCY_BUCKETS; ++i) {
+		uint64_t count = backend->latency_histogram[i];
+		if (count == 0) {
+			continue;
+		}
+		unsigned long min = i == 0 ? 0 : 1ul << i;
+		if (i == WLR_LIBINPUT_LATENCY_BUCKETS - 1) {
+			wlr_log(L_INFO, "  >= %lu us: %" PRIu64, min, count);
+		} else {
+			wlr_log(L_INFO, "  %lu-%lu us: %" PRIu64,
+				min, 1ul << (i + 1), count);
+		}
+	}
+}
+
 static void wlr_libinput_backend_destroy(struct wlr_backend *_backend) {
 	if (!_backend) {
 		return;
 	}
 	struct wlr_libinput_backend *backend = (struct wlr_libinput_backend *)_backend;
-	for (size_t i = 0; i < backend->wlr_device_lists->length; i++) {
-		list_t *wlr_devices = backend->wlr_device_lists->items[i];
-		for (size_t j = 0; j < wlr_devices->length; j++) {
-			struct wlr_input_device *wlr_dev = wlr_devices->items[j];
-			wl_signal_emit(&backend->backend.events.input_remove, wlr_dev);
-			wlr_input_device_destroy(wlr_dev);
-		}
-		list_free(wlr_devices);
+	wlr_libinput_thread_destroy(backend->thread);
+	log_latency_histogram(backend);
+	struct wlr_libinput_device_set *set, *tmp;
+	wl_list_for_each_safe(set, tmp, &backend->devices, link) {
+		wlr_libinput_device_set_destroy(backend, set);
 	}
-	list_free(backend->wlr_device_lists);
 	libinput_unref(backend->libinput_context);
+	pthread_mutex_destroy(&backend->libinput_lock);
 	free(backend);
 }
 
@@ -115,11 +255,13 @@ static void session_signal(struct wl_listener *listener, void *data) {
 		return;
 	}
 
+	wlr_libinput_backend_lock(backend);
 	if (session->active) {
 		libinput_resume(backend->libinput_context);
 	} else {
 		libinput_suspend(backend->libinput_context);
 	}
+	wlr_libinput_backend_unlock(backend);
 }
 
 struct wlr_backend *wlr_libinput_backend_create(struct wl_display *display,
@@ -133,25 +275,46 @@ struct wlr_backend *wlr_libinput_backend_create(struct wl_display *display,
 	}
 	wlr_backend_init(&backend->backend, &backend_impl);
 
-	if (!(backend->wlr_device_lists = list_create())) {
-		wlr_log(L_ERROR, "Allocation failed: %s", strerror(errno));
-		goto error_backend;
-	}
+	wl_list_init(&backend->devices);
+	wl_array_init(&backend->preopened);
 
 	backend->session = session;
 	backend->udev = udev;
 	backend->display = display;
 
+	const char *use_thread = getenv("WLR_LIBINPUT_THREAD");
+	backend->use_thread = use_thread && strcmp(use_thread, "1") == 0;
+
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&backend->libinput_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
 	backend->session_signal.notify = session_signal;
 	wl_signal_add(&session->session_signal, &backend->session_signal);
 
 	return &backend->backend;
-error_backend:
-	free(backend);
-	return NULL;
 }
 
 struct libinput_device *wlr_libinput_get_device_handle(struct wlr_input_device *_dev) {
 	struct wlr_libinput_input_device *dev = (struct wlr_libinput_input_device *)_dev;
 	return dev->handle;
 }
+
+struct wlr_libinput_backend *wlr_libinput_backend_from_device(
+		struct libinput_device *device) {
+	return libinput_get_user_data(libinput_device_get_context(device));
+}
+
+void wlr_libinput_backend_lock(struct wlr_libinput_backend *backend) {
+	if (backend->thread && !wlr_libinput_thread_is_current(backend->thread)) {
+		wlr_libinput_thread_lock_backend(backend->thread);
+		return;
+	}
+	pthread_mutex_lock(&backend->libinput_lock);
+}
+
+void wlr_libinput_backend_unlock(struct wlr_libinput_backend *backend) {
+	pthread_mutex_unlock(&backend->libinput_lock);
+}
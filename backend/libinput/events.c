@@ -1,31 +1,21 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <time.h>
 #include <libinput.h>
 #include <wlr/backend/session.h>
 #include <wlr/interfaces/wlr_input_device.h>
-#include <wlr/util/list.h>
 #include <wlr/util/log.h>
 #include "backend/libinput.h"
 
-struct wlr_input_device *get_appropriate_device(
-		enum wlr_input_device_type desired_type,
-		struct libinput_device *libinput_dev) {
-	list_t *wlr_devices = libinput_device_get_user_data(libinput_dev);
-	if (!wlr_devices) {
-		return NULL;
-	}
-	for (size_t i = 0; i < wlr_devices->length; ++i) {
-		struct wlr_input_device *dev = wlr_devices->items[i];
-		if (dev->type == desired_type) {
-			return dev;
-		}
-	}
-	return NULL;
-}
-
 static void wlr_libinput_device_destroy(struct wlr_input_device *_dev) {
 	struct wlr_libinput_input_device *dev = (struct wlr_libinput_input_device *)_dev;
+	struct wlr_libinput_backend *backend =
+		wlr_libinput_backend_from_device(dev->handle);
+	wlr_libinput_backend_lock(backend);
 	libinput_device_unref(dev->handle);
+	wlr_libinput_backend_unlock(backend);
 	free(dev);
 }
 
@@ -34,8 +24,9 @@ static struct wlr_input_device_impl input_device_impl = {
 };
 
 static struct wlr_input_device *allocate_device(
-		struct wlr_libinput_backend *backend, struct libinput_device *libinput_dev,
-		list_t *wlr_devices, enum wlr_input_device_type type) {
+		struct wlr_libinput_backend *backend,
+		struct wlr_libinput_device_set *set, enum wlr_input_device_type type) {
+	struct libinput_device *libinput_dev = set->handle;
 	int vendor = libinput_device_get_id_vendor(libinput_dev);
 	int product = libinput_device_get_id_product(libinput_dev);
 	const char *name = libinput_device_get_name(libinput_dev);
@@ -46,7 +37,7 @@ static struct wlr_input_device *allocate_device(
 	libinput_device_ref(libinput_dev);
 	wlr_input_device_init(wlr_dev, type, &input_device_impl,
 			name, vendor, product);
-	list_add(wlr_devices, wlr_dev);
+	set->devices[type] = wlr_dev;
 	return wlr_dev;
 }
 
@@ -62,36 +53,45 @@ static void handle_device_added(struct wlr_libinput_backend *backend,
 	int vendor = libinput_device_get_id_vendor(libinput_dev);
 	int product = libinput_device_get_id_product(libinput_dev);
 	const char *name = libinput_device_get_name(libinput_dev);
-	list_t *wlr_devices = list_create();
 	wlr_log(L_DEBUG, "Added %s [%d:%d]", name, vendor, product);
+	struct wlr_libinput_device_set *set =
+		calloc(1, sizeof(struct wlr_libinput_device_set));
+	if (!set) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return;
+	}
+	set->handle = libinput_dev;
+	// Set first, listeners of input_add may already look the devices up
+	libinput_device_set_user_data(libinput_dev, set);
+	wl_list_insert(backend->devices.prev, &set->link);
 
 	if (libinput_device_has_capability(libinput_dev, LIBINPUT_DEVICE_CAP_KEYBOARD)) {
 		struct wlr_input_device *wlr_dev = allocate_device(backend,
-				libinput_dev, wlr_devices, WLR_INPUT_DEVICE_KEYBOARD);
+				set, WLR_INPUT_DEVICE_KEYBOARD);
 		wlr_dev->keyboard = wlr_libinput_keyboard_create(libinput_dev);
 		wl_signal_emit(&backend->backend.events.input_add, wlr_dev);
 	}
 	if (libinput_device_has_capability(libinput_dev, LIBINPUT_DEVICE_CAP_POINTER)) {
 		struct wlr_input_device *wlr_dev = allocate_device(backend,
-				libinput_dev, wlr_devices, WLR_INPUT_DEVICE_POINTER);
+				set, WLR_INPUT_DEVICE_POINTER);
 		wlr_dev->pointer = wlr_libinput_pointer_create(libinput_dev);
 		wl_signal_emit(&backend->backend.events.input_add, wlr_dev);
 	}
 	if (libinput_device_has_capability(libinput_dev, LIBINPUT_DEVICE_CAP_TOUCH)) {
 		struct wlr_input_device *wlr_dev = allocate_device(backend,
-				libinput_dev, wlr_devices, WLR_INPUT_DEVICE_TOUCH);
+				set, WLR_INPUT_DEVICE_TOUCH);
 		wlr_dev->touch = wlr_libinput_touch_create(libinput_dev);
 		wl_signal_emit(&backend->backend.events.input_add, wlr_dev);
 	}
 	if (libinput_device_has_capability(libinput_dev, LIBINPUT_DEVICE_CAP_TABLET_TOOL)) {
 		struct wlr_input_device *wlr_dev = allocate_device(backend,
-				libinput_dev, wlr_devices, WLR_INPUT_DEVICE_TABLET_TOOL);
+				set, WLR_INPUT_DEVICE_TABLET_TOOL);
 		wlr_dev->tablet_tool = wlr_libinput_tablet_tool_create(libinput_dev);
 		wl_signal_emit(&backend->backend.events.input_add, wlr_dev);
 	}
 	if (libinput_device_has_capability(libinput_dev, LIBINPUT_DEVICE_CAP_TABLET_PAD)) {
 		struct wlr_input_device *wlr_dev = allocate_device(backend,
-				libinput_dev, wlr_devices, WLR_INPUT_DEVICE_TABLET_PAD);
+				set, WLR_INPUT_DEVICE_TABLET_PAD);
 		wlr_dev->tablet_pad = wlr_libinput_tablet_pad_create(libinput_dev);
 		wl_signal_emit(&backend->backend.events.input_add, wlr_dev);
 	}
@@ -101,104 +101,201 @@ static void handle_device_added(struct wlr_libinput_backend *backend,
 	if (libinput_device_has_capability(libinput_dev, LIBINPUT_DEVICE_CAP_SWITCH)) {
 		// TODO
 	}
+}
 
-	if (wlr_devices->length > 0) {
-		libinput_device_set_user_data(libinput_dev, wlr_devices);
-		list_add(backend->wlr_device_lists, wlr_devices);
-	} else {
-		list_free(wlr_devices);
+void wlr_libinput_device_set_destroy(struct wlr_libinput_backend *backend,
+		struct wlr_libinput_device_set *set) {
+	for (size_t i = 0; i < WLR_LIBINPUT_DEVICE_TYPES; ++i) {
+		struct wlr_input_device *wlr_dev = set->devices[i];
+		if (!wlr_dev) {
+			continue;
+		}
+		wl_signal_emit(&backend->backend.events.input_remove, wlr_dev);
+		set->devices[i] = NULL;
+		wlr_input_device_destroy(wlr_dev);
 	}
+	libinput_device_set_user_data(set->handle, NULL);
+	wl_list_remove(&set->link);
+	free(set);
 }
 
 static void handle_device_removed(struct wlr_libinput_backend *backend,
 		struct libinput_device *libinput_dev) {
-	list_t *wlr_devices = libinput_device_get_user_data(libinput_dev);
+	struct wlr_libinput_device_set *set =
+		libinput_device_get_user_data(libinput_dev);
 	int vendor = libinput_device_get_id_vendor(libinput_dev);
 	int product = libinput_device_get_id_product(libinput_dev);
 	const char *name = libinput_device_get_name(libinput_dev);
 	wlr_log(L_DEBUG, "Removing %s [%d:%d]", name, vendor, product);
-	if (!wlr_devices) {
+	if (!set) {
 		return;
 	}
-	for (size_t i = 0; i < wlr_devices->length; i++) {
-		struct wlr_input_device *wlr_dev = wlr_devices->items[i];
-		wl_signal_emit(&backend->backend.events.input_remove, wlr_dev);
-		wlr_input_device_destroy(wlr_dev);
+	wlr_libinput_device_set_destroy(backend, set);
+}
+
+struct event_handler {
+	enum wlr_input_device_type device_type;
+	void (*convert)(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+	void (*handle)(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event);
+};
+
+/*
+ * libinput numbers its event types in groups of a hundred per device
+ * capability, the table is indexed by group and position in the group.
+ * Device added and removed events aren't in it.
+ */
+#define HANDLER_GROUPS 8
+#define HANDLER_GROUP_SIZE 8
+
+static const struct event_handler handlers[HANDLER_GROUPS][HANDLER_GROUP_SIZE] = {
+	[LIBINPUT_EVENT_KEYBOARD_KEY / 100] = {
+		[LIBINPUT_EVENT_KEYBOARD_KEY % 100] = {
+			WLR_INPUT_DEVICE_KEYBOARD, convert_keyboard_key,
+			handle_keyboard_event },
+	},
+	[LIBINPUT_EVENT_POINTER_MOTION / 100] = {
+		[LIBINPUT_EVENT_POINTER_MOTION % 100] = {
+			WLR_INPUT_DEVICE_POINTER, convert_pointer_motion,
+			handle_pointer_event },
+		[LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE % 100] = {
+			WLR_INPUT_DEVICE_POINTER, convert_pointer_motion_abs,
+			handle_pointer_event },
+		[LIBINPUT_EVENT_POINTER_BUTTON % 100] = {
+			WLR_INPUT_DEVICE_POINTER, convert_pointer_button,
+			handle_pointer_event },
+		[LIBINPUT_EVENT_POINTER_AXIS % 100] = {
+			WLR_INPUT_DEVICE_POINTER, convert_pointer_axis,
+			handle_pointer_event },
+	},
+	[LIBINPUT_EVENT_TOUCH_DOWN / 100] = {
+		[LIBINPUT_EVENT_TOUCH_DOWN % 100] = {
+			WLR_INPUT_DEVICE_TOUCH, convert_touch_down,
+			handle_touch_event },
+		[LIBINPUT_EVENT_TOUCH_UP % 100] = {
+			WLR_INPUT_DEVICE_TOUCH, convert_touch_up,
+			handle_touch_event },
+		[LIBINPUT_EVENT_TOUCH_MOTION % 100] = {
+			WLR_INPUT_DEVICE_TOUCH, convert_touch_motion,
+			handle_touch_event },
+		[LIBINPUT_EVENT_TOUCH_CANCEL % 100] = {
+			WLR_INPUT_DEVICE_TOUCH, convert_touch_cancel,
+			handle_touch_event },
+		[LIBINPUT_EVENT_TOUCH_FRAME % 100] = {
+			WLR_INPUT_DEVICE_TOUCH, convert_touch_frame,
+			handle_touch_event },
+	},
+	[LIBINPUT_EVENT_TABLET_TOOL_AXIS / 100] = {
+		[LIBINPUT_EVENT_TABLET_TOOL_AXIS % 100] = {
+			WLR_INPUT_DEVICE_TABLET_TOOL, convert_tablet_tool_axis,
+			handle_tablet_tool_event },
+		[LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY % 100] = {
+			WLR_INPUT_DEVICE_TABLET_TOOL, convert_tablet_tool_proximity,
+			handle_tablet_tool_event },
+		[LIBINPUT_EVENT_TABLET_TOOL_TIP % 100] = {
+			WLR_INPUT_DEVICE_TABLET_TOOL, convert_tablet_tool_tip,
+			handle_tablet_tool_event },
+		[LIBINPUT_EVENT_TABLET_TOOL_BUTTON % 100] = {
+			WLR_INPUT_DEVICE_TABLET_TOOL, convert_tablet_tool_button,
+			handle_tablet_tool_event },
+	},
+	[LIBINPUT_EVENT_TABLET_PAD_BUTTON / 100] = {
+		[LIBINPUT_EVENT_TABLET_PAD_BUTTON % 100] = {
+			WLR_INPUT_DEVICE_TABLET_PAD, convert_tablet_pad_button,
+			handle_tablet_pad_event },
+		[LIBINPUT_EVENT_TABLET_PAD_RING % 100] = {
+			WLR_INPUT_DEVICE_TABLET_PAD, convert_tablet_pad_ring,
+			handle_tablet_pad_event },
+		[LIBINPUT_EVENT_TABLET_PAD_STRIP % 100] = {
+			WLR_INPUT_DEVICE_TABLET_PAD, convert_tablet_pad_strip,
+			handle_tablet_pad_event },
+	},
+};
+
+static const struct event_handler *get_handler(enum libinput_event_type type) {
+	unsigned int group = type / 100, index = type % 100;
+	if (group >= HANDLER_GROUPS || index >= HANDLER_GROUP_SIZE) {
+		return NULL;
 	}
-	for (size_t i = 0; i < backend->wlr_device_lists->length; i++) {
-		if (backend->wlr_device_lists->items[i] == wlr_devices) {
-			list_del(backend->wlr_device_lists, i);
-			break;
-		}
+	const struct event_handler *handler = &handlers[group][index];
+	return handler->convert ? handler : NULL;
+}
+
+static bool is_device_event(enum libinput_event_type type) {
+	return type == LIBINPUT_EVENT_DEVICE_ADDED ||
+		type == LIBINPUT_EVENT_DEVICE_REMOVED;
+}
+
+bool wlr_libinput_event_convert(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
+	assert(event && out);
+	memset(out, 0, sizeof(*out));
+	out->type = libinput_event_get_type(event);
+	out->device = libinput_event_get_device(event);
+	if (is_device_event(out->type)) {
+		return true;
 	}
-	list_free(wlr_devices);
+	const struct event_handler *handler = get_handler(out->type);
+	if (!handler) {
+		wlr_log(L_DEBUG, "Unknown libinput event %d", out->type);
+		return false;
+	}
+	handler->convert(event, out);
+	return true;
 }
 
-void wlr_libinput_event(struct wlr_libinput_backend *backend,
-		struct libinput_event *event) {
+void wlr_libinput_event_dispatch(struct wlr_libinput_device_set *set,
+		struct wlr_libinput_input_event *event) {
+	const struct event_handler *handler = get_handler(event->type);
+	if (!handler) {
+		return;
+	}
+	struct wlr_input_device *wlr_dev = set->devices[handler->device_type];
+	if (!wlr_dev) {
+		wlr_log(L_DEBUG, "Got libinput event %d for a device without "
+			"that capability", event->type);
+		return;
+	}
+	handler->handle(wlr_dev, event);
+}
+
+static void record_latency(struct wlr_libinput_backend *backend,
+		struct wlr_libinput_input_event *event) {
+	if (event->time_usec == 0) {
+		return;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t now_usec = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+	uint64_t age = now_usec > event->time_usec ?
+		now_usec - event->time_usec : 0;
+	size_t bucket = 0;
+	while (age > 1 && bucket < WLR_LIBINPUT_LATENCY_BUCKETS - 1) {
+		age >>= 1;
+		++bucket;
+	}
+	++backend->latency_histogram[bucket];
+}
+
+void wlr_libinput_event_emit(struct wlr_libinput_backend *backend,
+		struct wlr_libinput_input_event *event) {
 	assert(backend && event);
-	struct libinput_device *libinput_dev = libinput_event_get_device(event);
-	enum libinput_event_type event_type = libinput_event_get_type(event);
-	switch (event_type) {
+	record_latency(backend, event);
+	switch (event->type) {
 	case LIBINPUT_EVENT_DEVICE_ADDED:
-		handle_device_added(backend, libinput_dev);
-		break;
+		handle_device_added(backend, event->device);
+		return;
 	case LIBINPUT_EVENT_DEVICE_REMOVED:
-		handle_device_removed(backend, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_KEYBOARD_KEY:
-		handle_keyboard_key(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_POINTER_MOTION:
-		handle_pointer_motion(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-		handle_pointer_motion_abs(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_POINTER_BUTTON:
-		handle_pointer_button(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_POINTER_AXIS:
-		handle_pointer_axis(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TOUCH_DOWN:
-		handle_touch_down(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TOUCH_UP:
-		handle_touch_up(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TOUCH_MOTION:
-		handle_touch_motion(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TOUCH_CANCEL:
-		handle_touch_cancel(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TOUCH_FRAME:
-		// no-op (at least for now)
-		break;
-	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
-		handle_tablet_tool_axis(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
-		handle_tablet_tool_proximity(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
-		handle_tablet_tool_tip(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
-		handle_tablet_tool_button(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
-		handle_tablet_pad_button(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TABLET_PAD_RING:
-		handle_tablet_pad_ring(event, libinput_dev);
-		break;
-	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
-		handle_tablet_pad_strip(event, libinput_dev);
-		break;
+		handle_device_removed(backend, event->device);
+		return;
 	default:
-		wlr_log(L_DEBUG, "Unknown libinput event %d", event_type);
 		break;
 	}
+
+	struct wlr_libinput_device_set *set =
+		libinput_device_get_user_data(event->device);
+	if (set) {
+		wlr_libinput_event_dispatch(set, event);
+	}
 }
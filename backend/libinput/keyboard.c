@@ -14,13 +14,21 @@ struct wlr_libinput_keyboard {
 
 static void wlr_libinput_keyboard_set_leds(struct wlr_keyboard *wlr_kb, uint32_t leds) {
 	struct wlr_libinput_keyboard *wlr_libinput_kb = (struct wlr_libinput_keyboard *)wlr_kb;
+	struct wlr_libinput_backend *backend =
+		wlr_libinput_backend_from_device(wlr_libinput_kb->libinput_dev);
+	wlr_libinput_backend_lock(backend);
 	libinput_device_led_update(wlr_libinput_kb->libinput_dev, leds);
+	wlr_libinput_backend_unlock(backend);
 }
 
 static void wlr_libinput_keyboard_destroy(struct wlr_keyboard *wlr_kb) {
 	struct wlr_libinput_keyboard *wlr_libinput_kb =
 		(struct wlr_libinput_keyboard *)wlr_kb;
+	struct wlr_libinput_backend *backend =
+		wlr_libinput_backend_from_device(wlr_libinput_kb->libinput_dev);
+	wlr_libinput_backend_lock(backend);
 	libinput_device_unref(wlr_libinput_kb->libinput_dev);
+	wlr_libinput_backend_unlock(backend);
 	free(wlr_libinput_kb);
 }
 
@@ -42,29 +50,28 @@ struct wlr_keyboard *wlr_libinput_keyboard_create(
 	return wlr_kb;
 }
 
-void handle_keyboard_key(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_KEYBOARD, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a keyboard event for a device with no keyboards?");
-		return;
-	}
+void convert_keyboard_key(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_keyboard *kbevent =
 		libinput_event_get_keyboard_event(event);
-	struct wlr_event_keyboard_key wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_keyboard_get_time(kbevent);
-	wlr_event.time_usec = libinput_event_keyboard_get_time_usec(kbevent);
-	wlr_event.keycode = libinput_event_keyboard_get_key(kbevent);
-	enum libinput_key_state state = 
+	struct wlr_event_keyboard_key *wlr_event = &out->keyboard_key;
+	wlr_event->time_sec = libinput_event_keyboard_get_time(kbevent);
+	wlr_event->time_usec = libinput_event_keyboard_get_time_usec(kbevent);
+	wlr_event->keycode = libinput_event_keyboard_get_key(kbevent);
+	enum libinput_key_state state =
 		libinput_event_keyboard_get_key_state(kbevent);
 	switch (state) {
 	case LIBINPUT_KEY_STATE_RELEASED:
-		wlr_event.state = WLR_KEY_RELEASED;
+		wlr_event->state = WLR_KEY_RELEASED;
 		break;
 	case LIBINPUT_KEY_STATE_PRESSED:
-		wlr_event.state = WLR_KEY_PRESSED;
+		wlr_event->state = WLR_KEY_PRESSED;
 		break;
 	}
-	wl_signal_emit(&wlr_dev->keyboard->events.key, &wlr_event);
+	out->time_usec = wlr_event->time_usec;
+}
+
+void handle_keyboard_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event) {
+	wl_signal_emit(&wlr_dev->keyboard->events.key, &event->keyboard_key);
 }
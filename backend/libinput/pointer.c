@@ -19,76 +19,58 @@ struct wlr_pointer *wlr_libinput_pointer_create(
 	return wlr_pointer;
 }
 
-void handle_pointer_motion(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_POINTER, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a pointer event for a device with no pointers?");
-		return;
-	}
+void convert_pointer_motion(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_pointer *pevent =
 		libinput_event_get_pointer_event(event);
-	struct wlr_event_pointer_motion wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_pointer_get_time(pevent);
-	wlr_event.time_usec = libinput_event_pointer_get_time_usec(pevent);
-	wlr_event.delta_x = libinput_event_pointer_get_dx(pevent);
-	wlr_event.delta_y = libinput_event_pointer_get_dy(pevent);
-	wl_signal_emit(&wlr_dev->pointer->events.motion, &wlr_event);
+	struct wlr_event_pointer_motion *wlr_event = &out->pointer_motion;
+	wlr_event->time_sec = libinput_event_pointer_get_time(pevent);
+	wlr_event->time_usec = libinput_event_pointer_get_time_usec(pevent);
+	wlr_event->delta_x = libinput_event_pointer_get_dx(pevent);
+	wlr_event->delta_y = libinput_event_pointer_get_dy(pevent);
+	wlr_event->unaccel_dx =
+		libinput_event_pointer_get_dx_unaccelerated(pevent);
+	wlr_event->unaccel_dy =
+		libinput_event_pointer_get_dy_unaccelerated(pevent);
+	out->time_usec = wlr_event->time_usec;
 }
 
-void handle_pointer_motion_abs(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_POINTER, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a pointer event for a device with no pointers?");
-		return;
-	}
+void convert_pointer_motion_abs(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_pointer *pevent =
 		libinput_event_get_pointer_event(event);
-	struct wlr_event_pointer_motion_absolute wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_pointer_get_time(pevent);
-	wlr_event.time_usec = libinput_event_pointer_get_time_usec(pevent);
-	wlr_event.x_mm = libinput_event_pointer_get_absolute_x(pevent);
-	wlr_event.y_mm = libinput_event_pointer_get_absolute_y(pevent);
-	libinput_device_get_size(libinput_dev, &wlr_event.width_mm, &wlr_event.height_mm);
-	wl_signal_emit(&wlr_dev->pointer->events.motion_absolute, &wlr_event);
+	struct wlr_event_pointer_motion_absolute *wlr_event =
+		&out->pointer_motion_abs;
+	wlr_event->time_sec = libinput_event_pointer_get_time(pevent);
+	wlr_event->time_usec = libinput_event_pointer_get_time_usec(pevent);
+	wlr_event->x_mm = libinput_event_pointer_get_absolute_x(pevent);
+	wlr_event->y_mm = libinput_event_pointer_get_absolute_y(pevent);
+	libinput_device_get_size(out->device,
+		&wlr_event->width_mm, &wlr_event->height_mm);
+	out->time_usec = wlr_event->time_usec;
 }
 
-void handle_pointer_button(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_POINTER, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a pointer event for a device with no pointers?");
-		return;
-	}
+void convert_pointer_button(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_pointer *pevent =
 		libinput_event_get_pointer_event(event);
-	struct wlr_event_pointer_button wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_pointer_get_time(pevent);
-	wlr_event.time_usec = libinput_event_pointer_get_time_usec(pevent);
-	wlr_event.button = libinput_event_pointer_get_button(pevent);
+	struct wlr_event_pointer_button *wlr_event = &out->pointer_button;
+	wlr_event->time_sec = libinput_event_pointer_get_time(pevent);
+	wlr_event->time_usec = libinput_event_pointer_get_time_usec(pevent);
+	wlr_event->button = libinput_event_pointer_get_button(pevent);
 	switch (libinput_event_pointer_get_button_state(pevent)) {
 	case LIBINPUT_BUTTON_STATE_PRESSED:
-		wlr_event.state = WLR_BUTTON_PRESSED;
+		wlr_event->state = WLR_BUTTON_PRESSED;
 		break;
 	case LIBINPUT_BUTTON_STATE_RELEASED:
-		wlr_event.state = WLR_BUTTON_RELEASED;
+		wlr_event->state = WLR_BUTTON_RELEASED;
 		break;
 	}
-	wl_signal_emit(&wlr_dev->pointer->events.button, &wlr_event);
+	out->time_usec = wlr_event->time_usec;
 }
 
-void handle_pointer_axis(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_POINTER, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a pointer event for a device with no pointers?");
-		return;
-	}
+void convert_pointer_axis(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_pointer *pevent =
 		libinput_event_get_pointer_event(event);
 	struct wlr_event_pointer_axis wlr_event = { 0 };
@@ -112,19 +94,47 @@ void handle_pointer_axis(struct libinput_event *event,
 		LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
 		LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL,
 	};
+	out->pointer_axis.n_axes = 0;
 	for (size_t i = 0; i < sizeof(axies) / sizeof(axies[0]); ++i) {
-		if (libinput_event_pointer_has_axis(pevent, axies[i])) {
-			switch (axies[i]) {
-			case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
-				wlr_event.orientation = WLR_AXIS_ORIENTATION_VERTICAL;
-				break;
-			case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
-				wlr_event.orientation = WLR_AXIS_ORIENTATION_HORIZONTAL;
-				break;
-			}
-			wlr_event.delta = libinput_event_pointer_get_axis_value(
-					pevent, axies[i]);
+		if (!libinput_event_pointer_has_axis(pevent, axies[i])) {
+			continue;
+		}
+		switch (axies[i]) {
+		case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
+			wlr_event.orientation = WLR_AXIS_ORIENTATION_VERTICAL;
+			break;
+		case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
+			wlr_event.orientation = WLR_AXIS_ORIENTATION_HORIZONTAL;
+			break;
+		}
+		wlr_event.delta = libinput_event_pointer_get_axis_value(
+				pevent, axies[i]);
+		out->pointer_axis.axes[out->pointer_axis.n_axes++] = wlr_event;
+	}
+	out->time_usec = wlr_event.time_usec;
+}
+
+void handle_pointer_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event) {
+	struct wlr_pointer *pointer = wlr_dev->pointer;
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		wlr_pointer_notify_motion(pointer, &event->pointer_motion);
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		wlr_pointer_notify_motion_absolute(pointer,
+			&event->pointer_motion_abs);
+		break;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		wlr_pointer_notify_button(pointer, &event->pointer_button);
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		for (size_t i = 0; i < event->pointer_axis.n_axes; ++i) {
+			wlr_pointer_notify_axis(pointer,
+				&event->pointer_axis.axes[i]);
 		}
-		wl_signal_emit(&wlr_dev->pointer->events.axis, &wlr_event);
+		break;
+	default:
+		break;
 	}
 }
@@ -0,0 +1,399 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <libinput.h>
+#include <wayland-server.h>
+#include <wlr/backend/session.h>
+#include <wlr/util/log.h>
+#include "backend/libinput.h"
+
+// Must be a power of two
+#define RING_SIZE 512
+
+struct wlr_libinput_session_request {
+	const char *path; // opens path if set, closes fd otherwise
+	int fd;
+	bool done;
+};
+
+/*
+ * The input thread is the only one calling libinput_dispatch and reading
+ * events, always with the backend's libinput lock held. The main loop takes
+ * the same lock for everything else it does with libinput. Converted events
+ * are handed over through a single producer, single consumer ring, which
+ * doesn't need the lock.
+ */
+struct wlr_libinput_thread {
+	struct wlr_libinput_backend *backend;
+	pthread_t thread;
+
+	int notify_fd; // input thread -> main loop, events were queued
+	int control_fd; // main loop -> input thread, stop or ring drained
+	struct wl_event_source *notify_source;
+
+	// Sessions aren't thread safe, so when libinput_dispatch opens or closes
+	// devices on the input thread it hands the call to the main loop and
+	// waits for it
+	int request_fd; // input thread -> main loop, a session request waits
+	struct wl_event_source *request_source;
+	pthread_mutex_t request_lock;
+	pthread_cond_t request_cond;
+	struct wlr_libinput_session_request *request; // under request_lock
+
+	atomic_bool stop;
+	// Set by the input thread while it waits for space in the ring
+	atomic_bool waiting;
+
+	// Only written by the input thread
+	alignas(64) atomic_size_t head;
+	// Only written by the main loop
+	alignas(64) atomic_size_t tail;
+	alignas(64) struct wlr_libinput_input_event ring[RING_SIZE];
+};
+
+static bool ring_push(struct wlr_libinput_thread *thread,
+		const struct wlr_libinput_input_event *event) {
+	size_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_acquire);
+	if (head - tail == RING_SIZE) {
+		return false;
+	}
+	thread->ring[head & (RING_SIZE - 1)] = *event;
+	atomic_store_explicit(&thread->head, head + 1, memory_order_release);
+	return true;
+}
+
+static bool ring_pop(struct wlr_libinput_thread *thread,
+		struct wlr_libinput_input_event *event) {
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+	if (head == tail) {
+		return false;
+	}
+	*event = thread->ring[tail & (RING_SIZE - 1)];
+	atomic_store_explicit(&thread->tail, tail + 1, memory_order_release);
+	return true;
+}
+
+static bool is_device_event(struct wlr_libinput_input_event *event) {
+	return event->type == LIBINPUT_EVENT_DEVICE_ADDED ||
+		event->type == LIBINPUT_EVENT_DEVICE_REMOVED;
+}
+
+static void signal_fd(int fd) {
+	uint64_t one = 1;
+	if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		wlr_log(L_ERROR, "Failed to signal eventfd: %s", strerror(errno));
+	}
+}
+
+static void clear_fd(int fd) {
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+		wlr_log(L_ERROR, "Failed to read eventfd: %s", strerror(errno));
+	}
+}
+
+static void serve_session_request(struct wlr_libinput_thread *thread) {
+	clear_fd(thread->request_fd);
+	pthread_mutex_lock(&thread->request_lock);
+	struct wlr_libinput_session_request *request = thread->request;
+	if (request) {
+		struct wlr_session *session = thread->backend->session;
+		if (request->path) {
+			request->fd = wlr_session_open_file(session, request->path);
+		} else {
+			wlr_session_close_file(session, request->fd);
+		}
+		request->done = true;
+		thread->request = NULL;
+		pthread_cond_signal(&thread->request_cond);
+	}
+	pthread_mutex_unlock(&thread->request_lock);
+}
+
+static int handle_request(int fd, uint32_t mask, void *data) {
+	serve_session_request(data);
+	return 0;
+}
+
+/**
+ * Runs request on the main loop and waits for it. Fails once the thread is
+ * being stopped, the main loop might not serve it any more then.
+ */
+static bool session_request(struct wlr_libinput_thread *thread,
+		struct wlr_libinput_session_request *request) {
+	pthread_mutex_lock(&thread->request_lock);
+	if (atomic_load(&thread->stop)) {
+		pthread_mutex_unlock(&thread->request_lock);
+		return false;
+	}
+	thread->request = request;
+	signal_fd(thread->request_fd);
+	while (!request->done) {
+		pthread_cond_wait(&thread->request_cond, &thread->request_lock);
+	}
+	pthread_mutex_unlock(&thread->request_lock);
+	return true;
+}
+
+bool wlr_libinput_thread_is_current(struct wlr_libinput_thread *thread) {
+	return pthread_equal(pthread_self(), thread->thread);
+}
+
+int wlr_libinput_thread_open_file(struct wlr_libinput_thread *thread,
+		const char *path) {
+	struct wlr_libinput_session_request request = {
+		.path = path,
+		.fd = -1,
+	};
+	if (!session_request(thread, &request)) {
+		return -1;
+	}
+	return request.fd;
+}
+
+void wlr_libinput_thread_close_file(struct wlr_libinput_thread *thread,
+		int fd) {
+	struct wlr_libinput_session_request request = { .fd = fd };
+	if (!session_request(thread, &request)) {
+		// Better leak the fd than use the session from here
+		wlr_log(L_ERROR, "Not closing device fd %d while stopping", fd);
+	}
+}
+
+void wlr_libinput_thread_lock_backend(struct wlr_libinput_thread *thread) {
+	pthread_mutex_t *lock = &thread->backend->libinput_lock;
+	// The input thread may hold the lock while it waits for a session
+	// request, serve it instead of deadlocking
+	while (pthread_mutex_trylock(lock) != 0) {
+		serve_session_request(thread);
+		struct pollfd pfd = { .fd = thread->request_fd, .events = POLLIN };
+		poll(&pfd, 1, 1);
+	}
+}
+
+/**
+ * Reads events from libinput into the ring until either runs out. Returns
+ * false if an event is left in pending because the ring is full.
+ */
+static bool input_thread_dispatch(struct wlr_libinput_thread *thread,
+		struct wlr_libinput_input_event *pending) {
+	struct wlr_libinput_backend *backend = thread->backend;
+	bool queued = false, full = false;
+
+	wlr_libinput_backend_lock(backend);
+	if (libinput_dispatch(backend->libinput_context) != 0) {
+		wlr_log(L_ERROR, "Failed to dispatch libinput");
+	}
+	struct libinput_event *event;
+	while (!full && (event = libinput_get_event(backend->libinput_context))) {
+		if (wlr_libinput_event_convert(event, pending)) {
+			if (is_device_event(pending)) {
+				// Kept alive until the main loop has handled it
+				libinput_device_ref(pending->device);
+			}
+			if (ring_push(thread, pending)) {
+				queued = true;
+			} else {
+				full = true;
+			}
+		}
+		libinput_event_destroy(event);
+	}
+	wlr_libinput_backend_unlock(backend);
+
+	if (queued || full) {
+		signal_fd(thread->notify_fd);
+	}
+	return !full;
+}
+
+static void *input_thread_run(void *data) {
+	struct wlr_libinput_thread *thread = data;
+	struct wlr_libinput_input_event pending;
+	bool has_pending = !input_thread_dispatch(thread, &pending);
+
+	struct pollfd fds[] = {
+		{ .fd = libinput_get_fd(thread->backend->libinput_context) },
+		{ .fd = thread->control_fd, .events = POLLIN },
+	};
+	while (!atomic_load(&thread->stop)) {
+		if (has_pending) {
+			atomic_store(&thread->waiting, true);
+			// Pairs with the fence in handle_notify, one of us sees the
+			// other's write
+			atomic_thread_fence(memory_order_seq_cst);
+			if (ring_push(thread, &pending)) {
+				atomic_store(&thread->waiting, false);
+				signal_fd(thread->notify_fd);
+				has_pending = !input_thread_dispatch(thread, &pending);
+				continue;
+			}
+		}
+
+		// Leave events in the kernel while the main loop is behind
+		fds[0].events = has_pending ? 0 : POLLIN;
+		if (poll(fds, sizeof(fds) / sizeof(fds[0]), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			wlr_log(L_ERROR, "Failed to poll input: %s", strerror(errno));
+			break;
+		}
+		if (fds[1].revents & POLLIN) {
+			clear_fd(thread->control_fd);
+		}
+		if (!has_pending && (fds[0].revents & POLLIN)) {
+			has_pending = !input_thread_dispatch(thread, &pending);
+		}
+	}
+
+	if (has_pending && is_device_event(&pending)) {
+		wlr_libinput_backend_lock(thread->backend);
+		libinput_device_unref(pending.device);
+		wlr_libinput_backend_unlock(thread->backend);
+	}
+	return NULL;
+}
+
+static void emit_queued_event(struct wlr_libinput_thread *thread,
+		struct wlr_libinput_input_event *event) {
+	struct wlr_libinput_backend *backend = thread->backend;
+	if (!is_device_event(event)) {
+		wlr_libinput_event_emit(backend, event);
+		return;
+	}
+
+	// Hotplug creates and destroys devices, which uses libinput
+	wlr_libinput_backend_lock(backend);
+	wlr_libinput_event_emit(backend, event);
+	libinput_device_unref(event->device);
+	wlr_libinput_backend_unlock(backend);
+}
+
+static int handle_notify(int fd, uint32_t mask, void *data) {
+	struct wlr_libinput_thread *thread = data;
+	clear_fd(fd);
+
+	struct wlr_libinput_input_event event;
+	while (ring_pop(thread, &event)) {
+		emit_queued_event(thread, &event);
+	}
+
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_exchange(&thread->waiting, false)) {
+		signal_fd(thread->control_fd);
+	}
+	return 0;
+}
+
+struct wlr_libinput_thread *wlr_libinput_thread_create(
+		struct wlr_libinput_backend *backend) {
+	struct wlr_libinput_thread *thread =
+		calloc(1, sizeof(struct wlr_libinput_thread));
+	if (!thread) {
+		wlr_log(L_ERROR, "Allocation failed: %s", strerror(errno));
+		return NULL;
+	}
+	thread->backend = backend;
+	atomic_init(&thread->stop, false);
+	atomic_init(&thread->waiting, false);
+	atomic_init(&thread->head, 0);
+	atomic_init(&thread->tail, 0);
+	pthread_mutex_init(&thread->request_lock, NULL);
+	pthread_cond_init(&thread->request_cond, NULL);
+
+	thread->notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	thread->control_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	thread->request_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (thread->notify_fd < 0 || thread->control_fd < 0 ||
+			thread->request_fd < 0) {
+		wlr_log(L_ERROR, "Failed to create eventfd: %s", strerror(errno));
+		goto error_fds;
+	}
+
+	struct wl_event_loop *event_loop =
+		wl_display_get_event_loop(backend->display);
+	thread->notify_source = wl_event_loop_add_fd(event_loop,
+		thread->notify_fd, WL_EVENT_READABLE, handle_notify, thread);
+	if (!thread->notify_source) {
+		wlr_log(L_ERROR, "Failed to add input thread to event loop");
+		goto error_fds;
+	}
+	thread->request_source = wl_event_loop_add_fd(event_loop,
+		thread->request_fd, WL_EVENT_READABLE, handle_request, thread);
+	if (!thread->request_source) {
+		wlr_log(L_ERROR, "Failed to add input thread to event loop");
+		goto error_source;
+	}
+
+	// Set before the thread starts, it reads it without synchronization
+	backend->thread = thread;
+	int ret = pthread_create(&thread->thread, NULL, input_thread_run, thread);
+	if (ret != 0) {
+		wlr_log(L_ERROR, "Failed to create input thread: %s", strerror(ret));
+		backend->thread = NULL;
+		goto error_request_source;
+	}
+	return thread;
+
+error_request_source:
+	wl_event_source_remove(thread->request_source);
+error_source:
+	wl_event_source_remove(thread->notify_source);
+error_fds:
+	if (thread->notify_fd >= 0) {
+		close(thread->notify_fd);
+	}
+	if (thread->control_fd >= 0) {
+		close(thread->control_fd);
+	}
+	if (thread->request_fd >= 0) {
+		close(thread->request_fd);
+	}
+	pthread_cond_destroy(&thread->request_cond);
+	pthread_mutex_destroy(&thread->request_lock);
+	free(thread);
+	return NULL;
+}
+
+void wlr_libinput_thread_destroy(struct wlr_libinput_thread *thread) {
+	if (!thread) {
+		return;
+	}
+	// Set under request_lock, so no request can be posted after the one
+	// served here
+	pthread_mutex_lock(&thread->request_lock);
+	atomic_store(&thread->stop, true);
+	pthread_mutex_unlock(&thread->request_lock);
+	serve_session_request(thread);
+	signal_fd(thread->control_fd);
+	pthread_join(thread->thread, NULL);
+	thread->backend->thread = NULL;
+
+	// Nobody is left to emit these, only drop the device references
+	struct wlr_libinput_input_event event;
+	while (ring_pop(thread, &event)) {
+		if (is_device_event(&event)) {
+			libinput_device_unref(event.device);
+		}
+	}
+
+	wl_event_source_remove(thread->notify_source);
+	wl_event_source_remove(thread->request_source);
+	close(thread->notify_fd);
+	close(thread->control_fd);
+	close(thread->request_fd);
+	pthread_cond_destroy(&thread->request_cond);
+	pthread_mutex_destroy(&thread->request_lock);
+	free(thread);
+}
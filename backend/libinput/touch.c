@@ -19,76 +19,88 @@ struct wlr_touch *wlr_libinput_touch_create(
 	return wlr_touch;
 }
 
-void handle_touch_down(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_TOUCH, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a touch event for a device with no touch?");
-		return;
-	}
+void convert_touch_down(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_touch *tevent =
 		libinput_event_get_touch_event(event);
-	struct wlr_event_touch_down wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_touch_get_time(tevent);
-	wlr_event.time_usec = libinput_event_touch_get_time_usec(tevent);
-	wlr_event.slot = libinput_event_touch_get_slot(tevent);
-	wlr_event.x_mm = libinput_event_touch_get_x(tevent);
-	wlr_event.y_mm = libinput_event_touch_get_y(tevent);
-	libinput_device_get_size(libinput_dev, &wlr_event.width_mm, &wlr_event.height_mm);
-	wl_signal_emit(&wlr_dev->touch->events.down, &wlr_event);
+	struct wlr_event_touch_down *wlr_event = &out->touch_down;
+	wlr_event->time_sec = libinput_event_touch_get_time(tevent);
+	wlr_event->time_usec = libinput_event_touch_get_time_usec(tevent);
+	wlr_event->slot = libinput_event_touch_get_slot(tevent);
+	wlr_event->x_mm = libinput_event_touch_get_x(tevent);
+	wlr_event->y_mm = libinput_event_touch_get_y(tevent);
+	libinput_device_get_size(out->device,
+		&wlr_event->width_mm, &wlr_event->height_mm);
+	out->time_usec = wlr_event->time_usec;
 }
 
-void handle_touch_up(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_TOUCH, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a touch event for a device with no touch?");
-		return;
-	}
+void convert_touch_up(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_touch *tevent =
 		libinput_event_get_touch_event(event);
-	struct wlr_event_touch_up wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_touch_get_time(tevent);
-	wlr_event.time_usec = libinput_event_touch_get_time_usec(tevent);
-	wlr_event.slot = libinput_event_touch_get_slot(tevent);
-	wl_signal_emit(&wlr_dev->touch->events.up, &wlr_event);
+	struct wlr_event_touch_up *wlr_event = &out->touch_up;
+	wlr_event->time_sec = libinput_event_touch_get_time(tevent);
+	wlr_event->time_usec = libinput_event_touch_get_time_usec(tevent);
+	wlr_event->slot = libinput_event_touch_get_slot(tevent);
+	out->time_usec = wlr_event->time_usec;
 }
 
-void handle_touch_motion(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_TOUCH, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a touch event for a device with no touch?");
-		return;
-	}
+void convert_touch_motion(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_touch *tevent =
 		libinput_event_get_touch_event(event);
-	struct wlr_event_touch_motion wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_touch_get_time(tevent);
-	wlr_event.time_usec = libinput_event_touch_get_time_usec(tevent);
-	wlr_event.slot = libinput_event_touch_get_slot(tevent);
-	wlr_event.x_mm = libinput_event_touch_get_x(tevent);
-	wlr_event.y_mm = libinput_event_touch_get_y(tevent);
-	libinput_device_get_size(libinput_dev, &wlr_event.width_mm, &wlr_event.height_mm);
-	wl_signal_emit(&wlr_dev->touch->events.motion, &wlr_event);
+	struct wlr_event_touch_motion *wlr_event = &out->touch_motion;
+	wlr_event->time_sec = libinput_event_touch_get_time(tevent);
+	wlr_event->time_usec = libinput_event_touch_get_time_usec(tevent);
+	wlr_event->slot = libinput_event_touch_get_slot(tevent);
+	wlr_event->x_mm = libinput_event_touch_get_x(tevent);
+	wlr_event->y_mm = libinput_event_touch_get_y(tevent);
+	libinput_device_get_size(out->device,
+		&wlr_event->width_mm, &wlr_event->height_mm);
+	out->time_usec = wlr_event->time_usec;
 }
 
-void handle_touch_cancel(struct libinput_event *event,
-		struct libinput_device *libinput_dev) {
-	struct wlr_input_device *wlr_dev =
-		get_appropriate_device(WLR_INPUT_DEVICE_TOUCH, libinput_dev);
-	if (!wlr_dev) {
-		wlr_log(L_DEBUG, "Got a touch event for a device with no touch?");
-		return;
-	}
+void convert_touch_cancel(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
 	struct libinput_event_touch *tevent =
 		libinput_event_get_touch_event(event);
-	struct wlr_event_touch_cancel wlr_event = { 0 };
-	wlr_event.time_sec = libinput_event_touch_get_time(tevent);
-	wlr_event.time_usec = libinput_event_touch_get_time_usec(tevent);
-	wlr_event.slot = libinput_event_touch_get_slot(tevent);
-	wl_signal_emit(&wlr_dev->touch->events.cancel, &wlr_event);
+	struct wlr_event_touch_cancel *wlr_event = &out->touch_cancel;
+	wlr_event->time_sec = libinput_event_touch_get_time(tevent);
+	wlr_event->time_usec = libinput_event_touch_get_time_usec(tevent);
+	wlr_event->slot = libinput_event_touch_get_slot(tevent);
+	out->time_usec = wlr_event->time_usec;
+}
+
+void convert_touch_frame(struct libinput_event *event,
+		struct wlr_libinput_input_event *out) {
+	struct libinput_event_touch *tevent =
+		libinput_event_get_touch_event(event);
+	struct wlr_event_touch_frame *wlr_event = &out->touch_frame;
+	wlr_event->time_sec = libinput_event_touch_get_time(tevent);
+	wlr_event->time_usec = libinput_event_touch_get_time_usec(tevent);
+	out->time_usec = wlr_event->time_usec;
+}
+
+void handle_touch_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event) {
+	struct wlr_touch *touch = wlr_dev->touch;
+	switch (event->type) {
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+		wlr_touch_notify_down(touch, &event->touch_down);
+		break;
+	case LIBINPUT_EVENT_TOUCH_UP:
+		wlr_touch_notify_up(touch, &event->touch_up);
+		break;
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+		wlr_touch_notify_motion(touch, &event->touch_motion);
+		break;
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+		wlr_touch_notify_cancel(touch, &event->touch_cancel);
+		break;
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		wlr_touch_notify_frame(touch, &event->touch_frame);
+		break;
+	default:
+		break;
+	}
 }
@@ -30,7 +30,9 @@ static bool multi_backend_start(struct wlr_backend *_backend) {
 
 static void multi_backend_destroy(struct wlr_backend *_backend) {
 	struct wlr_multi_backend *backend = (struct wlr_multi_backend *)_backend;
-	for (size_t i = 0; i < backend->backends->length; ++i) {
+	// Backends can depend on the ones added before them (e.g. secondary GPUs
+	// on the render GPU), so destroy them in reverse order
+	for (size_t i = backend->backends->length; i-- > 0;) {
 		struct subbackend_state *sub = backend->backends->items[i];
 		wlr_backend_destroy(sub->backend);
 		free(sub);
@@ -0,0 +1,473 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server.h>
+#include <wlr/interfaces/wlr_input_device.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/interfaces/wlr_pointer.h>
+#include <wlr/interfaces/wlr_touch.h>
+#include <wlr/interfaces/wlr_tablet_tool.h>
+#include <wlr/interfaces/wlr_tablet_pad.h>
+#include <wlr/util/log.h>
+#include "backend/replay.h"
+
+// Records replayed per event loop iteration when they are all due, so a
+// fast replay doesn't starve clients
+#define REPLAY_BATCH 64
+
+// Every wlr_event_* struct starts with these
+struct replay_event_time {
+	uint32_t time_sec;
+	uint64_t time_usec;
+};
+
+static const struct {
+	enum wlr_input_device_type device_type;
+	size_t size;
+} record_types[WLR_REPLAY_RECORD_TYPES] = {
+	[WLR_REPLAY_KEYBOARD_KEY] = { WLR_INPUT_DEVICE_KEYBOARD,
+		sizeof(struct wlr_event_keyboard_key) },
+	[WLR_REPLAY_POINTER_MOTION] = { WLR_INPUT_DEVICE_POINTER,
+		sizeof(struct wlr_event_pointer_motion) },
+	[WLR_REPLAY_POINTER_MOTION_ABSOLUTE] = { WLR_INPUT_DEVICE_POINTER,
+		sizeof(struct wlr_event_pointer_motion_absolute) },
+	[WLR_REPLAY_POINTER_BUTTON] = { WLR_INPUT_DEVICE_POINTER,
+		sizeof(struct wlr_event_pointer_button) },
+	[WLR_REPLAY_POINTER_AXIS] = { WLR_INPUT_DEVICE_POINTER,
+		sizeof(struct wlr_event_pointer_axis) },
+	[WLR_REPLAY_TOUCH_DOWN] = { WLR_INPUT_DEVICE_TOUCH,
+		sizeof(struct wlr_event_touch_down) },
+	[WLR_REPLAY_TOUCH_UP] = { WLR_INPUT_DEVICE_TOUCH,
+		sizeof(struct wlr_event_touch_up) },
+	[WLR_REPLAY_TOUCH_MOTION] = { WLR_INPUT_DEVICE_TOUCH,
+		sizeof(struct wlr_event_touch_motion) },
+	[WLR_REPLAY_TOUCH_CANCEL] = { WLR_INPUT_DEVICE_TOUCH,
+		sizeof(struct wlr_event_touch_cancel) },
+	// Followed by the points, see record_size_valid
+	[WLR_REPLAY_TOUCH_FRAME] = { WLR_INPUT_DEVICE_TOUCH,
+		sizeof(struct wlr_replay_touch_frame) },
+	[WLR_REPLAY_TABLET_TOOL_AXIS] = { WLR_INPUT_DEVICE_TABLET_TOOL,
+		sizeof(struct wlr_event_tablet_tool_axis) },
+	[WLR_REPLAY_TABLET_TOOL_PROXIMITY] = { WLR_INPUT_DEVICE_TABLET_TOOL,
+		sizeof(struct wlr_event_tablet_tool_proximity) },
+	[WLR_REPLAY_TABLET_TOOL_TIP] = { WLR_INPUT_DEVICE_TABLET_TOOL,
+		sizeof(struct wlr_event_tablet_tool_tip) },
+	[WLR_REPLAY_TABLET_TOOL_BUTTON] = { WLR_INPUT_DEVICE_TABLET_TOOL,
+		sizeof(struct wlr_event_tablet_tool_button) },
+	[WLR_REPLAY_TABLET_PAD_BUTTON] = { WLR_INPUT_DEVICE_TABLET_PAD,
+		sizeof(struct wlr_event_tablet_pad_button) },
+	[WLR_REPLAY_TABLET_PAD_RING] = { WLR_INPUT_DEVICE_TABLET_PAD,
+		sizeof(struct wlr_event_tablet_pad_ring) },
+	[WLR_REPLAY_TABLET_PAD_STRIP] = { WLR_INPUT_DEVICE_TABLET_PAD,
+		sizeof(struct wlr_event_tablet_pad_strip) },
+};
+
+/**
+ * Reads the next record into backend->record. Stops the replay at the end of
+ * the file or at anything that doesn't look like a record.
+ */
+static void read_record(struct wlr_replay_backend *backend) {
+	backend->has_record = false;
+	struct wlr_replay_record *record = &backend->record;
+	if (fread(record, sizeof(*record), 1, backend->file) != 1) {
+		if (ferror(backend->file)) {
+			wlr_log_errno(L_ERROR, "Failed to read input recording");
+		}
+		return;
+	}
+	if (record->type >= WLR_REPLAY_RECORD_TYPES ||
+			record->size > WLR_REPLAY_MAX_PAYLOAD) {
+		wlr_log(L_ERROR, "Invalid record in input recording, stopping");
+		return;
+	}
+	if (record->size > 0 &&
+			fread(backend->payload, record->size, 1, backend->file) != 1) {
+		wlr_log(L_ERROR, "Truncated input recording, stopping");
+		return;
+	}
+	backend->has_record = true;
+}
+
+static uint64_t record_due_nsec(struct wlr_replay_backend *backend) {
+	if (backend->speed <= 0) {
+		return backend->start_nsec;
+	}
+	return backend->start_nsec +
+		(uint64_t)(backend->record.time_nsec / backend->speed);
+}
+
+static struct wlr_replay_device *get_device(
+		struct wlr_replay_backend *backend, uint32_t id) {
+	struct wlr_replay_device *device;
+	wl_list_for_each(device, &backend->devices, link) {
+		if (device->id == id) {
+			return device;
+		}
+	}
+	return NULL;
+}
+
+static bool init_typed_device(struct wlr_input_device *dev) {
+	switch (dev->type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		if (!(dev->keyboard = calloc(1, sizeof(struct wlr_keyboard)))) {
+			return false;
+		}
+		wlr_keyboard_init(dev->keyboard, NULL);
+		return true;
+	case WLR_INPUT_DEVICE_POINTER:
+		if (!(dev->pointer = calloc(1, sizeof(struct wlr_pointer)))) {
+			return false;
+		}
+		wlr_pointer_init(dev->pointer, NULL);
+		return true;
+	case WLR_INPUT_DEVICE_TOUCH:
+		if (!(dev->touch = calloc(1, sizeof(struct wlr_touch)))) {
+			return false;
+		}
+		wlr_touch_init(dev->touch, NULL);
+		return true;
+	case WLR_INPUT_DEVICE_TABLET_TOOL:
+		if (!(dev->tablet_tool = calloc(1, sizeof(struct wlr_tablet_tool)))) {
+			return false;
+		}
+		wlr_tablet_tool_init(dev->tablet_tool, NULL);
+		return true;
+	case WLR_INPUT_DEVICE_TABLET_PAD:
+		if (!(dev->tablet_pad = calloc(1, sizeof(struct wlr_tablet_pad)))) {
+			return false;
+		}
+		wlr_tablet_pad_init(dev->tablet_pad, NULL);
+		return true;
+	}
+	return false;
+}
+
+static void replay_device_add(struct wlr_replay_backend *backend) {
+	struct wlr_replay_record *record = &backend->record;
+	struct wlr_replay_device_info info;
+	if (record->size < sizeof(info)) {
+		wlr_log(L_ERROR, "Invalid device in input recording");
+		return;
+	}
+	memcpy(&info, backend->payload, sizeof(info));
+	if (info.name_len > record->size - sizeof(info) ||
+			info.type > WLR_INPUT_DEVICE_TABLET_PAD) {
+		wlr_log(L_ERROR, "Invalid device in input recording");
+		return;
+	}
+	char name[WLR_REPLAY_MAX_PAYLOAD];
+	memcpy(name, backend->payload + sizeof(info), info.name_len);
+	name[info.name_len] = '\0';
+
+	struct wlr_replay_device *device =
+		calloc(1, sizeof(struct wlr_replay_device));
+	if (!device) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return;
+	}
+	struct wlr_input_device *dev = calloc(1, sizeof(struct wlr_input_device));
+	if (!dev) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		free(device);
+		return;
+	}
+	wlr_input_device_init(dev, info.type, NULL, name, info.vendor,
+		info.product);
+	if (!init_typed_device(dev)) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		wlr_input_device_destroy(dev);
+		free(device);
+		return;
+	}
+
+	device->wlr_device = dev;
+	device->id = record->device;
+	wl_list_insert(&backend->devices, &device->link);
+	wlr_log(L_DEBUG, "Replaying input device '%s' (%d:%d)", name,
+		info.vendor, info.product);
+	wl_signal_emit(&backend->backend.events.input_add, dev);
+}
+
+static void replay_device_destroy(struct wlr_replay_backend *backend,
+		struct wlr_replay_device *device) {
+	wl_signal_emit(&backend->backend.events.input_remove, device->wlr_device);
+	wlr_input_device_destroy(device->wlr_device);
+	wl_list_remove(&device->link);
+	free(device);
+}
+
+static bool record_size_valid(struct wlr_replay_backend *backend) {
+	struct wlr_replay_record *record = &backend->record;
+	if (record->type != WLR_REPLAY_TOUCH_FRAME) {
+		return record->size == record_types[record->type].size;
+	}
+	struct wlr_replay_touch_frame frame;
+	if (record->size < sizeof(frame)) {
+		return false;
+	}
+	memcpy(&frame, backend->payload, sizeof(frame));
+	return frame.n_points <= WLR_TOUCH_FRAME_MAX_POINTS &&
+		record->size == sizeof(frame) +
+			frame.n_points * sizeof(struct wlr_touch_point);
+}
+
+/**
+ * Emits a recorded touch frame. Its points replace the ones gathered from the
+ * replayed touch events, so the frame is the one that was recorded.
+ */
+static void replay_touch_frame(struct wlr_touch *touch,
+		const uint8_t *payload) {
+	struct wlr_replay_touch_frame frame;
+	memcpy(&frame, payload, sizeof(frame));
+	memcpy(touch->pending.points, payload + sizeof(frame),
+		frame.n_points * sizeof(struct wlr_touch_point));
+	touch->pending.n_points = frame.n_points;
+	touch->pending.width_mm = frame.width_mm;
+	touch->pending.height_mm = frame.height_mm;
+
+	struct wlr_event_touch_frame event = {
+		.time_sec = frame.time_sec,
+		.time_usec = frame.time_usec,
+	};
+	wlr_touch_notify_frame(touch, &event);
+}
+
+static void replay_event(struct wlr_replay_backend *backend,
+		struct wlr_input_device *dev, uint64_t now_nsec) {
+	struct wlr_replay_record *record = &backend->record;
+	if (dev->type != record_types[record->type].device_type ||
+			!record_size_valid(backend)) {
+		wlr_log(L_DEBUG, "Skipping mismatched record of type %d",
+			record->type);
+		return;
+	}
+
+	// Moved to the replay clock, at the time the event was due unless we are
+	// replaying as fast as possible
+	uint64_t stamp_nsec = backend->speed > 0 ? record_due_nsec(backend) :
+		now_nsec;
+	void *event = backend->payload;
+	struct replay_event_time *time = event;
+	time->time_sec = stamp_nsec / 1000000;
+	time->time_usec = stamp_nsec / 1000;
+
+	switch (record->type) {
+	case WLR_REPLAY_KEYBOARD_KEY:
+		wl_signal_emit(&dev->keyboard->events.key, event);
+		break;
+	case WLR_REPLAY_POINTER_MOTION:
+		wlr_pointer_notify_motion(dev->pointer, event);
+		break;
+	case WLR_REPLAY_POINTER_MOTION_ABSOLUTE:
+		wlr_pointer_notify_motion_absolute(dev->pointer, event);
+		break;
+	case WLR_REPLAY_POINTER_BUTTON:
+		wlr_pointer_notify_button(dev->pointer, event);
+		break;
+	case WLR_REPLAY_POINTER_AXIS:
+		wlr_pointer_notify_axis(dev->pointer, event);
+		break;
+	case WLR_REPLAY_TOUCH_DOWN:
+		wlr_touch_notify_down(dev->touch, event);
+		break;
+	case WLR_REPLAY_TOUCH_UP:
+		wlr_touch_notify_up(dev->touch, event);
+		break;
+	case WLR_REPLAY_TOUCH_MOTION:
+		wlr_touch_notify_motion(dev->touch, event);
+		break;
+	case WLR_REPLAY_TOUCH_CANCEL:
+		wlr_touch_notify_cancel(dev->touch, event);
+		break;
+	case WLR_REPLAY_TOUCH_FRAME:
+		replay_touch_frame(dev->touch, event);
+		break;
+	case WLR_REPLAY_TABLET_TOOL_AXIS:
+		wlr_tablet_tool_notify_axis(dev->tablet_tool, event);
+		break;
+	case WLR_REPLAY_TABLET_TOOL_PROXIMITY:
+		wlr_tablet_tool_notify_proximity(dev->tablet_tool, event);
+		break;
+	case WLR_REPLAY_TABLET_TOOL_TIP:
+		wlr_tablet_tool_notify_tip(dev->tablet_tool, event);
+		break;
+	case WLR_REPLAY_TABLET_TOOL_BUTTON:
+		wlr_tablet_tool_notify_button(dev->tablet_tool, event);
+		break;
+	case WLR_REPLAY_TABLET_PAD_BUTTON:
+		wl_signal_emit(&dev->tablet_pad->events.button, event);
+		break;
+	case WLR_REPLAY_TABLET_PAD_RING:
+		wl_signal_emit(&dev->tablet_pad->events.ring, event);
+		break;
+	case WLR_REPLAY_TABLET_PAD_STRIP:
+		wl_signal_emit(&dev->tablet_pad->events.strip, event);
+		break;
+	}
+}
+
+static void replay_record(struct wlr_replay_backend *backend,
+		uint64_t now_nsec) {
+	struct wlr_replay_record *record = &backend->record;
+	if (record->type == WLR_REPLAY_DEVICE_ADD) {
+		replay_device_add(backend);
+		return;
+	}
+
+	struct wlr_replay_device *device = get_device(backend, record->device);
+	if (!device) {
+		wlr_log(L_DEBUG, "Skipping record for unknown device %d",
+			record->device);
+		return;
+	}
+	if (record->type == WLR_REPLAY_DEVICE_REMOVE) {
+		replay_device_destroy(backend, device);
+	} else {
+		replay_event(backend, device->wlr_device, now_nsec);
+	}
+}
+
+static void replay_dispatch(struct wlr_replay_backend *backend);
+
+static void handle_idle(void *data) {
+	struct wlr_replay_backend *backend = data;
+	backend->idle = NULL;
+	replay_dispatch(backend);
+}
+
+static int handle_timer(void *data) {
+	struct wlr_replay_backend *backend = data;
+	replay_dispatch(backend);
+	return 0;
+}
+
+static void replay_schedule(struct wlr_replay_backend *backend,
+		uint64_t now_nsec) {
+	if (!backend->has_record) {
+		if (!backend->finished) {
+			backend->finished = true;
+			wlr_log(L_INFO, "Input replay finished");
+			wl_signal_emit(&backend->done, backend);
+		}
+		return;
+	}
+
+	uint64_t due = record_due_nsec(backend);
+	if (due <= now_nsec) {
+		if (!backend->idle) {
+			struct wl_event_loop *loop =
+				wl_display_get_event_loop(backend->display);
+			backend->idle = wl_event_loop_add_idle(loop, handle_idle, backend);
+		}
+		return;
+	}
+	// Rounded up, the timer must not fire before the record is due
+	int ms = (due - now_nsec + 999999) / 1000000;
+	wl_event_source_timer_update(backend->timer, ms);
+}
+
+static void replay_dispatch(struct wlr_replay_backend *backend) {
+	uint64_t now = wlr_replay_get_time_nsec();
+	for (int i = 0; backend->has_record && i < REPLAY_BATCH; ++i) {
+		if (record_due_nsec(backend) > now) {
+			break;
+		}
+		replay_record(backend, now);
+		read_record(backend);
+	}
+	replay_schedule(backend, now);
+}
+
+static bool wlr_replay_backend_start(struct wlr_backend *_backend) {
+	struct wlr_replay_backend *backend = (struct wlr_replay_backend *)_backend;
+	wlr_log(L_INFO, "Starting input replay");
+
+	backend->start_nsec = wlr_replay_get_time_nsec();
+	read_record(backend);
+	replay_dispatch(backend);
+	return true;
+}
+
+static void wlr_replay_backend_destroy(struct wlr_backend *_backend) {
+	struct wlr_replay_backend *backend = (struct wlr_replay_backend *)_backend;
+	if (!_backend) {
+		return;
+	}
+
+	struct wlr_replay_device *device, *tmp;
+	wl_list_for_each_safe(device, tmp, &backend->devices, link) {
+		replay_device_destroy(backend, device);
+	}
+	if (backend->idle) {
+		wl_event_source_remove(backend->idle);
+	}
+	wl_event_source_remove(backend->timer);
+	fclose(backend->file);
+	free(backend);
+}
+
+static struct wlr_backend_impl backend_impl = {
+	.start = wlr_replay_backend_start,
+	.destroy = wlr_replay_backend_destroy,
+};
+
+bool wlr_backend_is_replay(struct wlr_backend *b) {
+	return b->impl == &backend_impl;
+}
+
+struct wl_signal *wlr_replay_backend_get_done_signal(
+		struct wlr_backend *_backend) {
+	struct wlr_replay_backend *backend = (struct wlr_replay_backend *)_backend;
+	return &backend->done;
+}
+
+struct wlr_backend *wlr_replay_backend_create(struct wl_display *display,
+		const char *path, double speed) {
+	wlr_log(L_INFO, "Creating replay backend for %s", path);
+
+	struct wlr_replay_backend *backend =
+		calloc(1, sizeof(struct wlr_replay_backend));
+	if (!backend) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_backend_init(&backend->backend, &backend_impl);
+	backend->display = display;
+	backend->speed = speed;
+	wl_list_init(&backend->devices);
+	wl_signal_init(&backend->done);
+
+	backend->file = fopen(path, "rbe");
+	if (!backend->file) {
+		wlr_log_errno(L_ERROR, "Failed to open %s", path);
+		goto error_backend;
+	}
+
+	struct wlr_replay_file_header header;
+	if (fread(&header, sizeof(header), 1, backend->file) != 1 ||
+			memcmp(header.magic, WLR_REPLAY_MAGIC, sizeof(header.magic)) != 0) {
+		wlr_log(L_ERROR, "%s is not an input recording", path);
+		goto error_file;
+	}
+	if (header.version != WLR_REPLAY_VERSION) {
+		wlr_log(L_ERROR, "%s is an input recording of version %d, "
+			"expected %d", path, header.version, WLR_REPLAY_VERSION);
+		goto error_file;
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(display);
+	backend->timer = wl_event_loop_add_timer(loop, handle_timer, backend);
+	if (!backend->timer) {
+		wlr_log(L_ERROR, "Failed to create replay timer");
+		goto error_file;
+	}
+
+	return &backend->backend;
+
+error_file:
+	fclose(backend->file);
+error_backend:
+	free(backend);
+	return NULL;
+}
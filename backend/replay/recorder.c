@@ -0,0 +1,256 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_input_device.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_touch.h>
+#include <wlr/types/wlr_tablet_tool.h>
+#include <wlr/types/wlr_tablet_pad.h>
+#include <wlr/util/log.h>
+#include "backend/replay.h"
+
+uint64_t wlr_replay_get_time_nsec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void write_record(struct wlr_input_recorder *recorder, uint32_t device,
+		uint16_t type, const void *payload, uint16_t size) {
+	if (!recorder->file) {
+		return;
+	}
+	struct wlr_replay_record record = {
+		.time_nsec = wlr_replay_get_time_nsec() - recorder->start_nsec,
+		.device = device,
+		.type = type,
+		.size = size,
+	};
+	if (fwrite(&record, sizeof(record), 1, recorder->file) != 1 ||
+			(size > 0 && fwrite(payload, size, 1, recorder->file) != 1)) {
+		wlr_log_errno(L_ERROR, "Failed to write input recording, stopping");
+		fclose(recorder->file);
+		recorder->file = NULL;
+	}
+}
+
+// The points are written out after the frame, the pointer to them is useless
+// in a recording
+static void write_touch_frame(struct wlr_recorder_device *device,
+		struct wlr_event_touch_frame *event) {
+	struct wlr_replay_touch_frame frame = {
+		.time_sec = event->time_sec,
+		.time_usec = event->time_usec,
+		.width_mm = event->width_mm,
+		.height_mm = event->height_mm,
+		.n_points = event->n_points,
+	};
+	if (frame.n_points > WLR_TOUCH_FRAME_MAX_POINTS) {
+		frame.n_points = WLR_TOUCH_FRAME_MAX_POINTS;
+	}
+	uint8_t payload[WLR_REPLAY_MAX_PAYLOAD];
+	size_t points_size = frame.n_points * sizeof(struct wlr_touch_point);
+	memcpy(payload, &frame, sizeof(frame));
+	memcpy(payload + sizeof(frame), event->points, points_size);
+	write_record(device->recorder, device->id, WLR_REPLAY_TOUCH_FRAME,
+		payload, sizeof(frame) + points_size);
+}
+
+static void handle_device_event(struct wl_listener *listener, void *data) {
+	struct wlr_recorder_listener *recorder_listener =
+		wl_container_of(listener, recorder_listener, listener);
+	struct wlr_recorder_device *device = recorder_listener->device;
+	if (recorder_listener->type == WLR_REPLAY_TOUCH_FRAME) {
+		write_touch_frame(device, data);
+		return;
+	}
+	write_record(device->recorder, device->id, recorder_listener->type, data,
+		recorder_listener->size);
+}
+
+static void listen(struct wlr_recorder_device *device,
+		struct wl_signal *signal, uint16_t type, uint16_t size) {
+	struct wlr_recorder_listener *recorder_listener =
+		&device->listeners[device->n_listeners++];
+	recorder_listener->device = device;
+	recorder_listener->type = type;
+	recorder_listener->size = size;
+	recorder_listener->listener.notify = handle_device_event;
+	wl_signal_add(signal, &recorder_listener->listener);
+}
+
+static void listen_device(struct wlr_recorder_device *device) {
+	struct wlr_input_device *dev = device->wlr_device;
+	switch (dev->type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		listen(device, &dev->keyboard->events.key, WLR_REPLAY_KEYBOARD_KEY,
+			sizeof(struct wlr_event_keyboard_key));
+		break;
+	case WLR_INPUT_DEVICE_POINTER:
+		listen(device, &dev->pointer->events.motion, WLR_REPLAY_POINTER_MOTION,
+			sizeof(struct wlr_event_pointer_motion));
+		listen(device, &dev->pointer->events.motion_absolute,
+			WLR_REPLAY_POINTER_MOTION_ABSOLUTE,
+			sizeof(struct wlr_event_pointer_motion_absolute));
+		listen(device, &dev->pointer->events.button, WLR_REPLAY_POINTER_BUTTON,
+			sizeof(struct wlr_event_pointer_button));
+		listen(device, &dev->pointer->events.axis, WLR_REPLAY_POINTER_AXIS,
+			sizeof(struct wlr_event_pointer_axis));
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		listen(device, &dev->touch->events.down, WLR_REPLAY_TOUCH_DOWN,
+			sizeof(struct wlr_event_touch_down));
+		listen(device, &dev->touch->events.up, WLR_REPLAY_TOUCH_UP,
+			sizeof(struct wlr_event_touch_up));
+		listen(device, &dev->touch->events.motion, WLR_REPLAY_TOUCH_MOTION,
+			sizeof(struct wlr_event_touch_motion));
+		listen(device, &dev->touch->events.cancel, WLR_REPLAY_TOUCH_CANCEL,
+			sizeof(struct wlr_event_touch_cancel));
+		listen(device, &dev->touch->events.frame, WLR_REPLAY_TOUCH_FRAME, 0);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_TOOL:
+		// Every sample, the replaying compositor coalesces them as it likes
+		listen(device, &dev->tablet_tool->events.axis_sample,
+			WLR_REPLAY_TABLET_TOOL_AXIS,
+			sizeof(struct wlr_event_tablet_tool_axis));
+		listen(device, &dev->tablet_tool->events.proximity,
+			WLR_REPLAY_TABLET_TOOL_PROXIMITY,
+			sizeof(struct wlr_event_tablet_tool_proximity));
+		listen(device, &dev->tablet_tool->events.tip,
+			WLR_REPLAY_TABLET_TOOL_TIP,
+			sizeof(struct wlr_event_tablet_tool_tip));
+		listen(device, &dev->tablet_tool->events.button,
+			WLR_REPLAY_TABLET_TOOL_BUTTON,
+			sizeof(struct wlr_event_tablet_tool_button));
+		break;
+	case WLR_INPUT_DEVICE_TABLET_PAD:
+		listen(device, &dev->tablet_pad->events.button,
+			WLR_REPLAY_TABLET_PAD_BUTTON,
+			sizeof(struct wlr_event_tablet_pad_button));
+		listen(device, &dev->tablet_pad->events.ring, WLR_REPLAY_TABLET_PAD_RING,
+			sizeof(struct wlr_event_tablet_pad_ring));
+		listen(device, &dev->tablet_pad->events.strip,
+			WLR_REPLAY_TABLET_PAD_STRIP,
+			sizeof(struct wlr_event_tablet_pad_strip));
+		break;
+	}
+}
+
+static void recorder_device_destroy(struct wlr_recorder_device *device) {
+	for (size_t i = 0; i < device->n_listeners; ++i) {
+		wl_list_remove(&device->listeners[i].listener.link);
+	}
+	wl_list_remove(&device->link);
+	free(device);
+}
+
+static void handle_input_add(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder *recorder =
+		wl_container_of(listener, recorder, input_add);
+	struct wlr_input_device *dev = data;
+
+	struct wlr_recorder_device *device =
+		calloc(1, sizeof(struct wlr_recorder_device));
+	if (!device) {
+		wlr_log(L_ERROR, "Allocation failed, not recording %s", dev->name);
+		return;
+	}
+	device->recorder = recorder;
+	device->wlr_device = dev;
+	device->id = recorder->next_id++;
+	wl_list_insert(&recorder->devices, &device->link);
+
+	struct {
+		struct wlr_replay_device_info info;
+		char name[WLR_REPLAY_MAX_PAYLOAD - sizeof(struct wlr_replay_device_info)];
+	} payload = {
+		.info = {
+			.type = dev->type,
+			.vendor = dev->vendor,
+			.product = dev->product,
+		},
+	};
+	if (dev->name) {
+		size_t len = strlen(dev->name);
+		if (len > sizeof(payload.name)) {
+			len = sizeof(payload.name);
+		}
+		memcpy(payload.name, dev->name, len);
+		payload.info.name_len = len;
+	}
+	write_record(recorder, device->id, WLR_REPLAY_DEVICE_ADD, &payload,
+		sizeof(payload.info) + payload.info.name_len);
+
+	listen_device(device);
+}
+
+static void handle_input_remove(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder *recorder =
+		wl_container_of(listener, recorder, input_remove);
+	struct wlr_input_device *dev = data;
+
+	struct wlr_recorder_device *device;
+	wl_list_for_each(device, &recorder->devices, link) {
+		if (device->wlr_device == dev) {
+			write_record(recorder, device->id, WLR_REPLAY_DEVICE_REMOVE,
+				NULL, 0);
+			recorder_device_destroy(device);
+			return;
+		}
+	}
+}
+
+struct wlr_input_recorder *wlr_input_recorder_create(
+		struct wlr_backend *backend, const char *path) {
+	struct wlr_input_recorder *recorder =
+		calloc(1, sizeof(struct wlr_input_recorder));
+	if (!recorder) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	recorder->file = fopen(path, "wbe");
+	if (!recorder->file) {
+		wlr_log_errno(L_ERROR, "Failed to open %s", path);
+		free(recorder);
+		return NULL;
+	}
+
+	struct wlr_replay_file_header header = { .version = WLR_REPLAY_VERSION };
+	memcpy(header.magic, WLR_REPLAY_MAGIC, sizeof(header.magic));
+	if (fwrite(&header, sizeof(header), 1, recorder->file) != 1) {
+		wlr_log_errno(L_ERROR, "Failed to write %s", path);
+		fclose(recorder->file);
+		free(recorder);
+		return NULL;
+	}
+
+	recorder->start_nsec = wlr_replay_get_time_nsec();
+	wl_list_init(&recorder->devices);
+	recorder->input_add.notify = handle_input_add;
+	wl_signal_add(&backend->events.input_add, &recorder->input_add);
+	recorder->input_remove.notify = handle_input_remove;
+	wl_signal_add(&backend->events.input_remove, &recorder->input_remove);
+
+	wlr_log(L_INFO, "Recording input to %s", path);
+	return recorder;
+}
+
+void wlr_input_recorder_destroy(struct wlr_input_recorder *recorder) {
+	if (!recorder) {
+		return;
+	}
+	struct wlr_recorder_device *device, *tmp;
+	wl_list_for_each_safe(device, tmp, &recorder->devices, link) {
+		recorder_device_destroy(device);
+	}
+	wl_list_remove(&recorder->input_add.link);
+	wl_list_remove(&recorder->input_remove.link);
+	if (recorder->file && fclose(recorder->file) != 0) {
+		wlr_log_errno(L_ERROR, "Failed to write input recording");
+	}
+	free(recorder);
+}
@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,7 +45,7 @@ static bool have_permissions(void) {
 }
 #endif
 
-static void send_msg(int sock, int fd, void *buf, size_t buf_len) {
+static ssize_t send_msg(int sock, int fd, void *buf, size_t buf_len) {
 	char control[CMSG_SPACE(sizeof(fd))] = {0};
 	struct iovec iovec = { .iov_base = buf, .iov_len = buf_len };
 	struct msghdr msghdr = {0};
@@ -69,8 +70,11 @@ static void send_msg(int sock, int fd, void *buf, size_t buf_len) {
 
 	ssize_t ret;
 	do {
-		ret = sendmsg(sock, &msghdr, 0);
+		// A dead peer shows up as an error, not as SIGPIPE
+		ret = sendmsg(sock, &msghdr, MSG_NOSIGNAL);
 	} while (ret < 0 && errno == EINTR);
+
+	return ret;
 }
 
 static ssize_t recv_msg(int sock, int *fd_out, void *buf, size_t buf_len) {
@@ -94,7 +98,7 @@ static ssize_t recv_msg(int sock, int *fd_out, void *buf, size_t buf_len) {
 	} while (ret < 0 && errno == EINTR);
 
 	if (fd_out) {
-		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+		struct cmsghdr *cmsg = ret >= 0 ? CMSG_FIRSTHDR(&msghdr) : NULL;
 		if (cmsg) {
 			memcpy(fd_out, CMSG_DATA(cmsg), sizeof(*fd_out));
 		} else {
@@ -177,16 +181,79 @@ error:
 	close(sock);
 }
 
-int direct_ipc_open(int sock, const char *path) {
+static bool send_open(int sock, const char *path) {
 	struct msg msg = { .type = MSG_OPEN };
 	snprintf(msg.path, sizeof(msg.path), "%s", path);
+	return send_msg(sock, -1, &msg, sizeof(msg)) >= 0;
+}
 
-	send_msg(sock, -1, &msg, sizeof(msg));
-
+/*
+ * Receives the reply to an open request, the fd or -errno. A failed or short
+ * read means the child is gone or out of step with us, and sets *broken.
+ */
+static int recv_open(int sock, bool *broken) {
 	int fd, err;
-	recv_msg(sock, &fd, &err, sizeof(err));
+	ssize_t ret = recv_msg(sock, &fd, &err, sizeof(err));
+	if (ret != sizeof(err)) {
+		err = ret < 0 ? errno : EPIPE;
+		*broken = true;
+	}
+	if (err) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -err;
+	}
+	return fd;
+}
+
+int direct_ipc_open(int sock, const char *path) {
+	if (!send_open(sock, path)) {
+		return -errno;
+	}
+
+	bool broken = false;
+	return recv_open(sock, &broken);
+}
+
+bool direct_ipc_open_batch(int sock, size_t n, const char *const paths[],
+		int fds[]) {
+	// Requests are sent ahead of the replies they wait for, so the child
+	// opens the next file while we receive the previous one. The window
+	// keeps the fds in flight below the kernel's limit.
+	size_t sent = 0, received = 0;
+	bool broken = false;
+	while (received < n && !broken) {
+		while (sent < n && sent - received < DIRECT_IPC_BATCH_WINDOW) {
+			if (!send_open(sock, paths[sent])) {
+				broken = true;
+				break;
+			}
+			++sent;
+		}
+		if (received == sent) {
+			break;
+		}
+		fds[received++] = recv_open(sock, &broken);
+	}
+	if (!broken) {
+		return true;
+	}
 
-	return err ? -err : fd;
+	// Replies that still come in would be taken for the answers to later
+	// requests, read them and close what they carry
+	bool drained = false;
+	for (; received < sent && !drained; ++received) {
+		int fd = recv_open(sock, &drained);
+		if (fd >= 0) {
+			close(fd);
+		}
+		fds[received] = -EPIPE;
+	}
+	for (; received < n; ++received) {
+		fds[received] = -EPIPE;
+	}
+	return false;
 }
 
 void direct_ipc_setmaster(int sock, int fd) {
@@ -27,14 +27,14 @@ struct direct_session {
 	int old_kbmode;
 	int sock;
 	pid_t child;
+	bool dead; // the socket to the child broke, nothing can be opened
 
 	struct wl_event_source *vt_source;
 };
 
-static int direct_session_open(struct wlr_session *base, const char *path) {
-	struct direct_session *session = wl_container_of(base, session, base);
-
-	int fd = direct_ipc_open(session->sock, path);
+static int handle_opened(struct direct_session *session, const char *path,
+		int fd) {
+	struct wlr_session *base = &session->base;
 	if (fd < 0) {
 		wlr_log(L_ERROR, "Failed to open %s: %s%s", path, strerror(-fd),
 			fd == -EINVAL ? "; is another display server running?" : "");
@@ -47,13 +47,39 @@ static int direct_session_open(struct wlr_session *base, const char *path) {
 		return -errno;
 	}
 
-	if (major(st.st_rdev) == DRM_MAJOR) {
-		session->base.drm_fd = fd;
+	if (major(st.st_rdev) == DRM_MAJOR && !session_add_drm_fd(base, fd)) {
+		direct_ipc_dropmaster(session->sock, fd);
+		close(fd);
+		return -EMFILE;
 	}
 
 	return fd;
 }
 
+static int direct_session_open(struct wlr_session *base, const char *path) {
+	struct direct_session *session = wl_container_of(base, session, base);
+	if (session->dead) {
+		return handle_opened(session, path, -EPIPE);
+	}
+	return handle_opened(session, path, direct_ipc_open(session->sock, path));
+}
+
+static void direct_session_open_files(struct wlr_session *base, size_t n,
+		const char *const paths[], int fds[]) {
+	struct direct_session *session = wl_container_of(base, session, base);
+	if (session->dead) {
+		for (size_t i = 0; i < n; ++i) {
+			fds[i] = -EPIPE;
+		}
+	} else if (!direct_ipc_open_batch(session->sock, n, paths, fds)) {
+		wlr_log(L_ERROR, "Lost the connection to the session child");
+		session->dead = true;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		fds[i] = handle_opened(session, paths[i], fds[i]);
+	}
+}
+
 static void direct_session_close(struct wlr_session *base, int fd) {
 	struct direct_session *session = wl_container_of(base, session, base);
 
@@ -65,8 +91,8 @@ static void direct_session_close(struct wlr_session *base, int fd) {
 	}
 
 	if (major(st.st_rdev) == DRM_MAJOR) {
-		direct_ipc_dropmaster(session->sock, session->base.drm_fd);
-		session->base.drm_fd = -1;
+		direct_ipc_dropmaster(session->sock, fd);
+		session_remove_drm_fd(base, fd);
 	} else if (major(st.st_rdev) == INPUT_MAJOR) {
 		ioctl(fd, EVIOCREVOKE, 0);
 	}
@@ -109,11 +135,15 @@ static int vt_handler(int signo, void *data) {
 	if (session->base.active) {
 		session->base.active = false;
 		wl_signal_emit(&session->base.session_signal, session);
-		direct_ipc_dropmaster(session->sock, session->base.drm_fd);
+		for (size_t i = 0; i < session->base.num_drm_fds; ++i) {
+			direct_ipc_dropmaster(session->sock, session->base.drm_fds[i]);
+		}
 		ioctl(session->tty_fd, VT_RELDISP, 1);
 	} else {
 		ioctl(session->tty_fd, VT_RELDISP, VT_ACKACQ);
-		direct_ipc_setmaster(session->sock, session->base.drm_fd);
+		for (size_t i = 0; i < session->base.num_drm_fds; ++i) {
+			direct_ipc_setmaster(session->sock, session->base.drm_fds[i]);
+		}
 		session->base.active = true;
 		wl_signal_emit(&session->base.session_signal, session);
 	}
@@ -221,7 +251,6 @@ static struct wlr_session *direct_session_start(struct wl_display *disp) {
 	wlr_log(L_INFO, "Successfully loaded direct session");
 
 	snprintf(session->base.seat, sizeof(session->base.seat), "%s", seat);
-	session->base.drm_fd = -1;
 	session->base.impl = &session_direct;
 	session->base.active = true;
 	wl_signal_init(&session->base.session_signal);
@@ -239,6 +268,7 @@ const struct session_impl session_direct = {
 	.start = direct_session_start,
 	.finish = direct_session_finish,
 	.open = direct_session_open,
+	.open_files = direct_session_open_files,
 	.close = direct_session_close,
 	.change_vt = direct_change_vt,
 };
@@ -67,8 +67,9 @@ static int logind_take_device(struct wlr_session *base, const char *path) {
 		goto error;
 	}
 
-	if (major(st.st_rdev) == DRM_MAJOR) {
-		session->base.drm_fd = fd;
+	if (major(st.st_rdev) == DRM_MAJOR && !session_add_drm_fd(base, fd)) {
+		close(fd);
+		fd = -EMFILE;
 	}
 
 error:
@@ -98,7 +99,7 @@ static void logind_release_device(struct wlr_session *base, int fd) {
 	}
 
 	if (major(st.st_rdev) == DRM_MAJOR) {
-		session->base.drm_fd = -1;
+		session_remove_drm_fd(base, fd);
 	}
 
 	sd_bus_error_free(&error);
@@ -267,7 +268,15 @@ static int resume_device(sd_bus_message *msg, void *userdata, sd_bus_error *ret_
 	}
 
 	if (major == DRM_MAJOR) {
-		dup2(fd, session->base.drm_fd);
+		// Replace the fd of the device that was resumed
+		for (size_t i = 0; i < session->base.num_drm_fds; ++i) {
+			int drm_fd = session->base.drm_fds[i];
+			struct stat st;
+			if (fstat(drm_fd, &st) == 0 && st.st_rdev == makedev(major, minor)) {
+				dup2(fd, drm_fd);
+				break;
+			}
+		}
 		session->base.active = true;
 		wl_signal_emit(&session->base.session_signal, session);
 	}
@@ -374,7 +383,6 @@ static struct wlr_session *logind_session_start(struct wl_display *disp) {
 
 	wlr_log(L_INFO, "Successfully loaded logind session");
 
-	session->base.drm_fd = -1;
 	session->base.impl = &session_logind;
 	session->base.active = true;
 	wl_signal_init(&session->base.session_signal);
@@ -41,10 +41,41 @@ int wlr_session_open_file(struct wlr_session *session, const char *path) {
 	return session->impl->open(session, path);
 }
 
+void wlr_session_open_files(struct wlr_session *session, size_t n,
+		const char *const paths[], int fds[]) {
+	if (session->impl->open_files) {
+		session->impl->open_files(session, n, paths, fds);
+		return;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		fds[i] = session->impl->open(session, paths[i]);
+	}
+}
+
 void wlr_session_close_file(struct wlr_session *session, int fd) {
 	session->impl->close(session, fd);
 }
 
+bool session_add_drm_fd(struct wlr_session *session, int fd) {
+	size_t max = sizeof(session->drm_fds) / sizeof(session->drm_fds[0]);
+	if (session->num_drm_fds == max) {
+		wlr_log(L_ERROR, "Too many DRM devices open");
+		return false;
+	}
+
+	session->drm_fds[session->num_drm_fds++] = fd;
+	return true;
+}
+
+void session_remove_drm_fd(struct wlr_session *session, int fd) {
+	for (size_t i = 0; i < session->num_drm_fds; ++i) {
+		if (session->drm_fds[i] == fd) {
+			session->drm_fds[i] = session->drm_fds[--session->num_drm_fds];
+			return;
+		}
+	}
+}
+
 bool wlr_session_change_vt(struct wlr_session *session, unsigned vt) {
 	if (!session) {
 		return false;
@@ -56,14 +56,17 @@ out_fd:
 	return false;
 }
 
-/* Tries to find the primary GPU by checking for the "boot_vga" attribute.
- * If it's not found, it returns the first valid GPU it finds.
+/* Opens up to ret_len KMS capable GPUs and stores their fds in ret.
+ * The primary GPU, found by checking for the "boot_vga" attribute, is put
+ * first. If it's not found, the first valid GPU found comes first.
+ * Returns the number of GPUs opened.
  */
-int wlr_udev_find_gpu(struct wlr_udev *udev, struct wlr_session *session) {
+size_t wlr_udev_find_gpus(struct wlr_udev *udev, struct wlr_session *session,
+		size_t ret_len, int *ret) {
 	struct udev_enumerate *en = udev_enumerate_new(udev->udev);
 	if (!en) {
 		wlr_log(L_ERROR, "Failed to create udev enumeration");
-		return -1;
+		return 0;
 	}
 
 	udev_enumerate_add_match_subsystem(en, "drm");
@@ -71,9 +74,13 @@ int wlr_udev_find_gpu(struct wlr_udev *udev, struct wlr_session *session) {
 	udev_enumerate_scan_devices(en);
 
 	struct udev_list_entry *entry;
-	int fd = -1;
+	size_t i = 0;
 
 	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(en)) {
+		if (i == ret_len) {
+			break;
+		}
+
 		bool is_boot_vga = false;
 
 		const char *path = udev_list_entry_get_name(entry);
@@ -103,12 +110,7 @@ int wlr_udev_find_gpu(struct wlr_udev *udev, struct wlr_session *session) {
 			}
 		}
 
-		// We already have a valid GPU
-		if (!is_boot_vga && fd >= 0) {
-			udev_device_unref(dev);
-			continue;
-		}
-
+		int fd = -1;
 		path = udev_device_get_devnode(dev);
 		if (!device_is_kms(session, path, &fd)) {
 			udev_device_unref(dev);
@@ -117,15 +119,18 @@ int wlr_udev_find_gpu(struct wlr_udev *udev, struct wlr_session *session) {
 
 		udev_device_unref(dev);
 
-		// We've found the primary GPU
+		ret[i] = fd;
+		// The primary GPU goes first
 		if (is_boot_vga) {
-			break;
+			ret[i] = ret[0];
+			ret[0] = fd;
 		}
+		++i;
 	}
 
 	udev_enumerate_unref(en);
 
-	return fd;
+	return i;
 }
 
 static int udev_event(int fd, uint32_t mask, void *data) {
@@ -14,6 +14,8 @@ static struct wl_callback_listener frame_listener;
 static void surface_frame_callback(void *data, struct wl_callback *cb, uint32_t time) {
 	struct wlr_output *wlr_output = data;
 	assert(wlr_output);
+	// The parent compositor gives us no timing information here
+	wlr_output_send_present(wlr_output, NULL, 0, 0);
 	wl_signal_emit(&wlr_output->events.frame, wlr_output);
 	wl_callback_destroy(cb);
 }
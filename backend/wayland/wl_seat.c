@@ -52,7 +52,7 @@ static void pointer_handle_motion(void *data, struct wl_pointer *wl_pointer,
 	wlr_event.height_mm = height;
 	wlr_event.x_mm = wl_fixed_to_double(surface_x);
 	wlr_event.y_mm = wl_fixed_to_double(surface_y);
-	wl_signal_emit(&dev->pointer->events.motion_absolute, &wlr_event);
+	wlr_pointer_notify_motion_absolute(dev->pointer, &wlr_event);
 }
 
 static void pointer_handle_button(void *data, struct wl_pointer *wl_pointer,
@@ -65,7 +65,7 @@ static void pointer_handle_button(void *data, struct wl_pointer *wl_pointer,
 	wlr_event.state = state;
 	wlr_event.time_sec = time / 1000;
 	wlr_event.time_usec = time * 1000;
-	wl_signal_emit(&dev->pointer->events.button, &wlr_event);
+	wlr_pointer_notify_button(dev->pointer, &wlr_event);
 }
 
 static void pointer_handle_axis(void *data, struct wl_pointer *wl_pointer,
@@ -80,7 +80,7 @@ static void pointer_handle_axis(void *data, struct wl_pointer *wl_pointer,
 	wlr_event.time_sec = time / 1000;
 	wlr_event.time_usec = time * 1000;
 	wlr_event.source = wlr_wl_pointer->axis_source;
-	wl_signal_emit(&dev->pointer->events.axis, &wlr_event);
+	wlr_pointer_notify_axis(dev->pointer, &wlr_event);
 }
 
 static void pointer_handle_frame(void *data, struct wl_pointer *wl_pointer) {
@@ -154,7 +154,11 @@ static void keyboard_handle_modifiers(void *data, struct wl_keyboard *wl_keyboar
 
 static void keyboard_handle_repeat_info(void *data, struct wl_keyboard *wl_keyboard,
 	int32_t rate, int32_t delay) {
-
+	struct wlr_input_device *dev = data;
+	assert(dev && dev->keyboard);
+	// The parent compositor leaves repeating to its clients, pass its
+	// settings on to whoever repeats our keys
+	wlr_keyboard_set_repeat_info(dev->keyboard, rate, delay);
 }
 
 static struct wl_keyboard_listener keyboard_listener = {
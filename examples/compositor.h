@@ -9,6 +9,10 @@ struct wl_compositor_state {
 	struct wlr_renderer *renderer;
 	struct wl_list surfaces;
 	struct wl_listener destroy_surface_listener;
+
+	struct {
+		struct wl_signal new_surface; // struct wlr_surface *
+	} events;
 };
 
 void wl_compositor_init(struct wl_display *display,
@@ -9,8 +9,15 @@
 #include <wlr/backend/session.h>
 #include <wlr/render.h>
 #include <wlr/render/gles2.h>
+#include <wlr/egl.h>
+#include <wlr/types/wlr_linux_dmabuf.h>
+#include <wlr/types/wlr_linux_explicit_synchronization.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_presentation.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_subcompositor.h>
 #include <wlr/types/wlr_surface.h>
+#include <wlr/types/wlr_viewporter.h>
 #include <wlr/types/wlr_xdg_shell_v6.h>
 #include <xkbcommon/xkbcommon.h>
 #include <wlr/util/log.h>
@@ -20,42 +27,106 @@
 struct sample_state {
 	struct wlr_renderer *renderer;
 	struct wl_compositor_state compositor;
+	struct wlr_subcompositor *subcompositor;
 	struct wl_shell_state shell;
 	struct wlr_xdg_shell_v6 *xdg_shell;
+	struct wlr_presentation *presentation;
+	struct wlr_linux_dmabuf *linux_dmabuf;
+	struct wlr_linux_explicit_synchronization *explicit_sync;
+	struct wlr_viewporter *viewporter;
+	struct wlr_scene *scene;
+
+	struct wl_listener new_surface;
+};
+
+struct sample_surface {
+	struct sample_state *sample;
+	struct wlr_surface *surface;
+	struct wl_listener commit;
+	struct wl_listener destroy;
 };
 
-/*
- * Convert timespec to milliseconds
- */
-static inline int64_t timespec_to_msec(const struct timespec *a) {
-	return (int64_t)a->tv_sec * 1000 + a->tv_nsec / 1000000;
+static void sample_surface_destroy(struct sample_surface *sample_surface) {
+	wl_list_remove(&sample_surface->commit.link);
+	wl_list_remove(&sample_surface->destroy.link);
+	free(sample_surface);
+}
+
+static void handle_surface_commit(struct wl_listener *listener, void *data) {
+	struct sample_surface *sample_surface =
+		wl_container_of(listener, sample_surface, commit);
+	struct wlr_surface *surface = sample_surface->surface;
+	// The role is known by the first commit. Subsurfaces are added to the
+	// scene by the tree of their parent.
+	if (!surface->subsurface) {
+		struct wlr_scene_tree *tree = wlr_scene_subsurface_tree_create(
+			&sample_surface->sample->scene->node, surface);
+		if (tree) {
+			wlr_scene_node_set_position(&tree->node, 200, 200);
+		}
+	}
+	sample_surface_destroy(sample_surface);
+}
+
+static void handle_surface_destroy(struct wl_listener *listener, void *data) {
+	struct sample_surface *sample_surface =
+		wl_container_of(listener, sample_surface, destroy);
+	sample_surface_destroy(sample_surface);
+}
+
+static void handle_new_surface(struct wl_listener *listener, void *data) {
+	struct sample_state *sample =
+		wl_container_of(listener, sample, new_surface);
+	struct wlr_surface *surface = data;
+	struct sample_surface *sample_surface =
+		calloc(1, sizeof(struct sample_surface));
+	if (!sample_surface) {
+		return;
+	}
+	sample_surface->sample = sample;
+	sample_surface->surface = surface;
+	sample_surface->commit.notify = handle_surface_commit;
+	wl_signal_add(&surface->signals.commit, &sample_surface->commit);
+	sample_surface->destroy.notify = handle_surface_destroy;
+	wl_signal_add(&surface->signals.destroy, &sample_surface->destroy);
+}
+
+static void handle_surface_sampled(struct wlr_surface *surface,
+		int sx, int sy, void *data) {
+	struct output_state *output = data;
+	struct sample_state *sample = output->compositor->data;
+	wlr_presentation_surface_sampled(sample->presentation, surface,
+		output->output);
+}
+
+void handle_output_add(struct output_state *output) {
+	struct sample_state *sample = output->compositor->data;
+	if (!sample->scene) {
+		return;
+	}
+	output->data = wlr_scene_output_create(sample->scene, output->output);
+}
+
+void handle_output_remove(struct output_state *output) {
+	wlr_scene_output_destroy(output->data);
 }
 
 void handle_output_frame(struct output_state *output, struct timespec *ts) {
 	struct compositor_state *state = output->compositor;
 	struct sample_state *sample = state->data;
 	struct wlr_output *wlr_output = output->output;
+	struct wlr_scene_output *scene_output = output->data;
+	if (!scene_output) {
+		return;
+	}
 
 	wlr_output_make_current(wlr_output);
 	wlr_renderer_begin(sample->renderer, wlr_output);
 
-	struct wl_resource *_res;
-	float matrix[16];
-	wl_list_for_each(_res, &sample->compositor.surfaces, link) {
-		struct wlr_surface *surface = wl_resource_get_user_data(_res);
-		wlr_surface_flush_damage(surface);
-		if (surface->texture->valid) {
-			wlr_texture_get_matrix(surface->texture, &matrix,
-					&wlr_output->transform_matrix, 200, 200);
-			wlr_render_with_matrix(sample->renderer, surface->texture, &matrix);
-
-			struct wlr_frame_callback *cb, *cnext;
-			wl_list_for_each_safe(cb, cnext, &surface->frame_callback_list, link) {
-				wl_callback_send_done(cb->resource, timespec_to_msec(ts));
-				wl_resource_destroy(cb->resource);
-			}
-		}
-	}
+	// Surfaces that aren't on this output are left to the hidden throttle
+	wlr_scene_output_render(scene_output, ts);
+	wlr_scene_output_for_each_surface(scene_output, handle_surface_sampled,
+		output);
 
 	wlr_renderer_end(sample->renderer);
 	wlr_output_swap_buffers(wlr_output);
@@ -63,17 +134,36 @@ void handle_output_frame(struct output_state *output, struct timespec *ts) {
 
 int main() {
 	struct sample_state state = { 0 };
-	struct compositor_state compositor = { 0,
+	struct compositor_state compositor = {
 		.data = &state,
+		.output_add_cb = handle_output_add,
+		.output_remove_cb = handle_output_remove,
 		.output_frame_cb = handle_output_frame,
 	};
 	compositor_init(&compositor);
 
 	state.renderer = wlr_gles2_renderer_init(compositor.backend);
+	state.scene = wlr_scene_create(state.renderer);
+	// Outputs show up while the backend starts, before the scene exists
+	struct output_state *output;
+	wl_list_for_each(output, &compositor.outputs, link) {
+		handle_output_add(output);
+	}
 	wl_display_init_shm(compositor.display);
 	wl_compositor_init(compositor.display, &state.compositor, state.renderer);
+	state.new_surface.notify = handle_new_surface;
+	wl_signal_add(&state.compositor.events.new_surface, &state.new_surface);
+	state.subcompositor = wlr_subcompositor_create(compositor.display);
 	wl_shell_init(compositor.display, &state.shell);
 	state.xdg_shell = wlr_xdg_shell_v6_init(compositor.display);
+	state.presentation = wlr_presentation_create(compositor.display);
+	state.viewporter = wlr_viewporter_create(compositor.display);
+	struct wlr_egl *egl = wlr_backend_get_egl(compositor.backend);
+	if (egl) {
+		state.linux_dmabuf = wlr_linux_dmabuf_create(compositor.display, egl);
+		state.explicit_sync =
+			wlr_linux_explicit_synchronization_create(compositor.display);
+	}
 
 	compositor_run(&compositor);
 }
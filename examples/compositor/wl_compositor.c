@@ -30,6 +30,7 @@ static void wl_compositor_create_surface(struct wl_client *client,
 	wl_resource_add_destroy_listener(surface_resource, &surface->compositor_listener);
 
 	wl_list_insert(&state->surfaces, wl_resource_get_link(surface_resource));
+	wl_signal_emit(&state->events.new_surface, surface);
 }
 
 static void wl_compositor_create_region(struct wl_client *client,
@@ -78,4 +79,5 @@ void wl_compositor_init(struct wl_display *display,
 	state->renderer = renderer;
 	wl_list_init(&state->wl_resources);
 	wl_list_init(&state->surfaces);
+	wl_signal_init(&state->events.new_surface);
 }
@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 199309L
+/*
+ * Measures how wlr_region_coalesce reduces texture upload calls for damage
+ * typical of a few kinds of clients, and how much extra data it uploads in
+ * exchange.
+ *
+ * Usage: damage-bench [call cost in bytes] [max boxes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pixman.h>
+#include <wlr/types/wlr_region.h>
+
+#define BPP 4
+#define FRAMES 1000
+
+/*
+ * Damage generators. Each one reproduces the shape of the damage a kind of
+ * client posts per frame; the random parts use a fixed seed so runs are
+ * comparable.
+ */
+
+// 80x24 terminal with 9x18 cells: scattered glyph updates from output
+// scrolling in, plus the cursor cell
+static void damage_terminal(pixman_region32_t *region, int frame) {
+	const int cw = 9, ch = 18;
+	int cells = 40 + rand() % 200;
+	for (int i = 0; i < cells; ++i) {
+		int col = rand() % 80;
+		int row = rand() % 24;
+		int len = 1 + rand() % 8;
+		pixman_region32_union_rect(region, region,
+			col * cw, row * ch, len * cw, ch);
+	}
+	pixman_region32_union_rect(region, region,
+		(frame % 80) * cw, 23 * ch, cw, ch);
+}
+
+// Editor typing: a few glyphs on the cursor line, its line number, the
+// status bar, and occasionally a completion popup
+static void damage_editor(pixman_region32_t *region, int frame) {
+	const int cw = 8, ch = 16;
+	int line = 10 + frame % 40;
+	int col = 6 + frame % 100;
+	pixman_region32_union_rect(region, region, col * cw, line * ch, 3 * cw, ch);
+	pixman_region32_union_rect(region, region, 0, line * ch, 5 * cw, ch);
+	pixman_region32_union_rect(region, region, 0, 60 * ch, 1280, ch);
+	if (frame % 7 == 0) {
+		pixman_region32_union_rect(region, region,
+			col * cw, (line + 1) * ch, 40 * cw, 10 * ch);
+	}
+}
+
+// Browser: the viewport scrolls, the scrollbar thumb moves and a couple of
+// small animations (spinner, caret) tick
+static void damage_browser(pixman_region32_t *region, int frame) {
+	if (frame % 3 == 0) {
+		pixman_region32_union_rect(region, region, 0, 80, 1904, 1000);
+	}
+	pixman_region32_union_rect(region, region, 1904, 80 + frame % 900, 16, 120);
+	pixman_region32_union_rect(region, region, 24, 24, 16, 16);
+	pixman_region32_union_rect(region, region, 400 + frame % 50, 40, 2, 18);
+}
+
+// Text-heavy document reflow: many short words damaged across many lines
+static void damage_text(pixman_region32_t *region, int frame) {
+	const int ch = 20;
+	for (int line = 0; line < 50; ++line) {
+		int x = 40;
+		while (x < 1800) {
+			int w = 20 + rand() % 80;
+			if (rand() % 3 == 0) {
+				pixman_region32_union_rect(region, region, x, 100 + line * ch,
+					w, ch - 4);
+			}
+			x += w + 8;
+		}
+	}
+}
+
+struct pattern {
+	const char *name;
+	void (*damage)(pixman_region32_t *region, int frame);
+};
+
+static const struct pattern patterns[] = {
+	{ "terminal", damage_terminal },
+	{ "editor", damage_editor },
+	{ "browser", damage_browser },
+	{ "text", damage_text },
+};
+
+static uint64_t region_bytes(pixman_box32_t *boxes, int n) {
+	uint64_t bytes = 0;
+	for (int i = 0; i < n; ++i) {
+		bytes += (uint64_t)(boxes[i].x2 - boxes[i].x1) *
+			(boxes[i].y2 - boxes[i].y1) * BPP;
+	}
+	return bytes;
+}
+
+static int64_t timespec_to_nsec(const struct timespec *ts) {
+	return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+	struct wlr_region_coalesce_params params = {
+		.call_cost = WLR_REGION_COALESCE_CALL_COST,
+		.max_boxes = WLR_REGION_COALESCE_MAX_BOXES,
+	};
+	if (argc > 1) {
+		params.call_cost = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		params.max_boxes = atoi(argv[2]);
+	}
+	if (params.max_boxes <= 0) {
+		fprintf(stderr, "max boxes must be positive\n");
+		return 1;
+	}
+
+	printf("call cost %"PRIu32" bytes, at most %d boxes, %d frames\n\n",
+		params.call_cost, params.max_boxes, FRAMES);
+	printf("%-10s %10s %12s %10s %12s %10s %10s\n", "pattern", "rects",
+		"bytes", "boxes", "bytes", "cost", "ns/frame");
+
+	pixman_box32_t *boxes = calloc(params.max_boxes, sizeof(pixman_box32_t));
+	if (!boxes) {
+		return 1;
+	}
+
+	for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); ++i) {
+		uint64_t rects = 0, rect_bytes = 0;
+		uint64_t nboxes = 0, box_bytes = 0;
+		int64_t nsec = 0;
+		srand(1);
+
+		for (int frame = 0; frame < FRAMES; ++frame) {
+			pixman_region32_t region;
+			pixman_region32_init(&region);
+			patterns[i].damage(&region, frame);
+
+			int n;
+			pixman_box32_t *r = pixman_region32_rectangles(&region, &n);
+			rects += n;
+			rect_bytes += region_bytes(r, n);
+
+			struct timespec start, end;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			int m = wlr_region_coalesce(&region, &params, BPP, boxes);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			nsec += timespec_to_nsec(&end) - timespec_to_nsec(&start);
+
+			nboxes += m;
+			box_bytes += region_bytes(boxes, m);
+			pixman_region32_fini(&region);
+		}
+
+		// Modelled upload cost, relative to uploading every rectangle
+		double before = (double)rects * params.call_cost + rect_bytes;
+		double after = (double)nboxes * params.call_cost + box_bytes;
+		printf("%-10s %10.1f %12.0f %10.1f %12.0f %9.0f%% %10"PRId64"\n",
+			patterns[i].name,
+			(double)rects / FRAMES, (double)rect_bytes / FRAMES,
+			(double)nboxes / FRAMES, (double)box_bytes / FRAMES,
+			100.0 * after / before, nsec / FRAMES);
+	}
+
+	free(boxes);
+	return 0;
+}
@@ -0,0 +1,266 @@
+#define _POSIX_C_SOURCE 199309L
+/*
+ * Measures what the libinput backend spends per event between having
+ * converted a libinput event and the listeners of the wlr_input_device
+ * signal running: the handler table lookup, the device lookup and the
+ * emission. The events are synthetic, no libinput context or device is
+ * needed.
+ *
+ * Usage: input-bench [events per mix]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/interfaces/wlr_input_device.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/interfaces/wlr_pointer.h>
+#include <wlr/interfaces/wlr_touch.h>
+#include <wlr/interfaces/wlr_tablet_tool.h>
+#include <wlr/interfaces/wlr_tablet_pad.h>
+#include "backend/libinput.h"
+
+#define EVENTS 10000000
+// Synthetic events are cycled through, a power of two
+#define QUEUE_SIZE 1024
+// Reports per flush for the coalesced mixes, e.g. an 8 kHz mouse on a
+// 1 kHz display
+#define REPORTS_PER_FRAME 8
+
+static uint64_t delivered;
+
+static void handle_event(struct wl_listener *listener, void *data) {
+	++delivered;
+}
+
+static struct wl_listener listeners[32];
+static size_t n_listeners;
+
+static void listen(struct wl_signal *signal) {
+	struct wl_listener *listener = &listeners[n_listeners++];
+	listener->notify = handle_event;
+	wl_signal_add(signal, listener);
+}
+
+static struct wlr_input_device *create_device(
+		enum wlr_input_device_type type) {
+	struct wlr_input_device *dev = calloc(1, sizeof(struct wlr_input_device));
+	wlr_input_device_init(dev, type, NULL, "input-bench", 0, 0);
+	switch (type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		dev->keyboard = calloc(1, sizeof(struct wlr_keyboard));
+		wlr_keyboard_init(dev->keyboard, NULL);
+		listen(&dev->keyboard->events.key);
+		break;
+	case WLR_INPUT_DEVICE_POINTER:
+		dev->pointer = calloc(1, sizeof(struct wlr_pointer));
+		wlr_pointer_init(dev->pointer, NULL);
+		listen(&dev->pointer->events.motion);
+		listen(&dev->pointer->events.motion_absolute);
+		listen(&dev->pointer->events.button);
+		listen(&dev->pointer->events.axis);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		dev->touch = calloc(1, sizeof(struct wlr_touch));
+		wlr_touch_init(dev->touch, NULL);
+		listen(&dev->touch->events.down);
+		listen(&dev->touch->events.up);
+		listen(&dev->touch->events.motion);
+		listen(&dev->touch->events.cancel);
+		listen(&dev->touch->events.frame);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_TOOL:
+		dev->tablet_tool = calloc(1, sizeof(struct wlr_tablet_tool));
+		wlr_tablet_tool_init(dev->tablet_tool, NULL);
+		listen(&dev->tablet_tool->events.axis);
+		listen(&dev->tablet_tool->events.proximity);
+		listen(&dev->tablet_tool->events.tip);
+		listen(&dev->tablet_tool->events.button);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_PAD:
+		dev->tablet_pad = calloc(1, sizeof(struct wlr_tablet_pad));
+		wlr_tablet_pad_init(dev->tablet_pad, NULL);
+		listen(&dev->tablet_pad->events.button);
+		listen(&dev->tablet_pad->events.ring);
+		listen(&dev->tablet_pad->events.strip);
+		break;
+	}
+	return dev;
+}
+
+/*
+ * Event mixes. Each one fills the queue with the event types a kind of
+ * device produces, in roughly the proportions it produces them.
+ */
+
+static enum libinput_event_type mix_mouse(int i) {
+	switch (i % 20) {
+	case 0:
+		return LIBINPUT_EVENT_POINTER_BUTTON;
+	case 10:
+		return LIBINPUT_EVENT_POINTER_AXIS;
+	default:
+		return LIBINPUT_EVENT_POINTER_MOTION;
+	}
+}
+
+static enum libinput_event_type mix_keyboard(int i) {
+	return LIBINPUT_EVENT_KEYBOARD_KEY;
+}
+
+static enum libinput_event_type mix_touch(int i) {
+	switch (i % 16) {
+	case 0:
+		return LIBINPUT_EVENT_TOUCH_DOWN;
+	case 14:
+		return LIBINPUT_EVENT_TOUCH_UP;
+	default:
+		// Every other event ends a frame
+		return i % 2 ? LIBINPUT_EVENT_TOUCH_FRAME :
+			LIBINPUT_EVENT_TOUCH_MOTION;
+	}
+}
+
+static enum libinput_event_type mix_tablet(int i) {
+	switch (i % 32) {
+	case 0:
+		return LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY;
+	case 1:
+		return LIBINPUT_EVENT_TABLET_TOOL_TIP;
+	case 16:
+		return LIBINPUT_EVENT_TABLET_PAD_RING;
+	default:
+		return LIBINPUT_EVENT_TABLET_TOOL_AXIS;
+	}
+}
+
+static enum libinput_event_type mix_all(int i) {
+	static const enum libinput_event_type types[] = {
+		LIBINPUT_EVENT_KEYBOARD_KEY,
+		LIBINPUT_EVENT_POINTER_MOTION,
+		LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+		LIBINPUT_EVENT_POINTER_BUTTON,
+		LIBINPUT_EVENT_POINTER_AXIS,
+		LIBINPUT_EVENT_TOUCH_DOWN,
+		LIBINPUT_EVENT_TOUCH_UP,
+		LIBINPUT_EVENT_TOUCH_MOTION,
+		LIBINPUT_EVENT_TOUCH_CANCEL,
+		LIBINPUT_EVENT_TOUCH_FRAME,
+		LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+		LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY,
+		LIBINPUT_EVENT_TABLET_TOOL_TIP,
+		LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
+		LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+		LIBINPUT_EVENT_TABLET_PAD_RING,
+		LIBINPUT_EVENT_TABLET_PAD_STRIP,
+	};
+	return types[i % (sizeof(types) / sizeof(types[0]))];
+}
+
+struct mix {
+	const char *name;
+	enum libinput_event_type (*type)(int i);
+	bool coalesce;
+};
+
+static const struct mix mixes[] = {
+	{ "mouse", mix_mouse, false },
+	{ "mouse-coalesced", mix_mouse, true },
+	{ "keyboard", mix_keyboard, false },
+	{ "touch", mix_touch, false },
+	{ "tablet", mix_tablet, false },
+	{ "tablet-coalesced", mix_tablet, true },
+	{ "all", mix_all, false },
+};
+
+static void fill_event(struct wlr_libinput_input_event *event,
+		enum libinput_event_type type, int i) {
+	event->type = type;
+	// Only kept for the latency histogram, which dispatch doesn't record
+	event->time_usec = 0;
+	switch (type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		event->pointer_motion.delta_x = i % 3 - 1;
+		event->pointer_motion.delta_y = i % 5 - 2;
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		event->pointer_axis.n_axes = 1;
+		event->pointer_axis.axes[0].delta = 15;
+		break;
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		event->tablet_tool.has_axis = true;
+		break;
+	default:
+		break;
+	}
+}
+
+static int64_t timespec_to_nsec(const struct timespec *ts) {
+	return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+	uint64_t events = EVENTS;
+	if (argc > 1) {
+		events = strtoull(argv[1], NULL, 10);
+	}
+	if (events == 0) {
+		fprintf(stderr, "the number of events must be positive\n");
+		return 1;
+	}
+
+	struct wlr_libinput_device_set set = { 0 };
+	for (int type = 0; type < WLR_LIBINPUT_DEVICE_TYPES; ++type) {
+		set.devices[type] = create_device(type);
+	}
+	struct wlr_pointer *pointer =
+		set.devices[WLR_INPUT_DEVICE_POINTER]->pointer;
+	struct wlr_tablet_tool *tool =
+		set.devices[WLR_INPUT_DEVICE_TABLET_TOOL]->tablet_tool;
+
+	struct wlr_libinput_input_event *queue =
+		calloc(QUEUE_SIZE, sizeof(struct wlr_libinput_input_event));
+	if (!queue) {
+		return 1;
+	}
+
+	printf("%"PRIu64" events per mix\n\n", events);
+	printf("%-16s %12s %10s\n", "mix", "signals", "ns/event");
+
+	for (size_t i = 0; i < sizeof(mixes) / sizeof(mixes[0]); ++i) {
+		for (int j = 0; j < QUEUE_SIZE; ++j) {
+			fill_event(&queue[j], mixes[i].type(j), j);
+		}
+		wlr_pointer_set_motion_coalescing(pointer, mixes[i].coalesce, NULL, 0);
+		wlr_tablet_tool_set_axis_coalescing(tool, mixes[i].coalesce, NULL, 0);
+		delivered = 0;
+
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (uint64_t n = 0; n < events; ++n) {
+			wlr_libinput_event_dispatch(&set, &queue[n & (QUEUE_SIZE - 1)]);
+			if (mixes[i].coalesce && n % REPORTS_PER_FRAME == 0) {
+				wlr_pointer_flush_motion(pointer);
+				wlr_tablet_tool_flush_axis(tool);
+			}
+		}
+		wlr_pointer_flush_motion(pointer);
+		wlr_tablet_tool_flush_axis(tool);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		int64_t nsec = timespec_to_nsec(&end) - timespec_to_nsec(&start);
+		printf("%-16s %12"PRIu64" %10.1f\n", mixes[i].name, delivered,
+			(double)nsec / events);
+	}
+
+	free(queue);
+	for (int type = 0; type < WLR_LIBINPUT_DEVICE_TYPES; ++type) {
+		wlr_input_device_destroy(set.devices[type]);
+	}
+	return 0;
+}
@@ -7,6 +7,9 @@
 #include <wayland-server.h>
 #include <xf86drmMode.h>
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
 #include <libudev.h>
 #include <gbm.h>
 
@@ -19,13 +22,37 @@
 #include <backend/udev.h>
 #include "drm-properties.h"
 
-struct wlr_drm_plane {
-	uint32_t type;
-	uint32_t id;
+struct wlr_drm_renderer {
+	int fd;
+	struct gbm_device *gbm;
+	struct wlr_egl egl;
 
-	uint32_t possible_crtcs;
+	// Used to copy frames between surfaces: from the render GPU on secondary
+	// GPUs, for GL upscaling and for mirroring
+	PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES;
+	GLuint blit_prog;
+	GLint blit_swizzle; // uniform location
+	// GL_EXT_texture_format_BGRA8888, CPU copies are uploaded as RGBA and
+	// swizzled back in the blit without it
+	bool has_bgra;
+};
 
-	uint32_t width, height;
+bool wlr_drm_renderer_init(struct wlr_drm_renderer *renderer, int fd);
+void wlr_drm_renderer_free(struct wlr_drm_renderer *renderer);
+
+// Imported buffer from another GPU, cached so it is only imported once
+struct wlr_drm_mgpu_image {
+	struct gbm_bo *bo;
+	EGLImageKHR image;
+	GLuint tex;
+	bool swizzled; // BGRA data uploaded as RGBA
+};
+
+struct wlr_drm_surface {
+	struct wlr_drm_renderer *renderer;
+
+	uint32_t width;
+	uint32_t height;
 
 	struct gbm_surface *gbm;
 	EGLSurface egl;
@@ -33,6 +60,39 @@ struct wlr_drm_plane {
 	struct gbm_bo *front;
 	struct gbm_bo *back;
 
+	// Only used when this surface receives copies from another GPU or from
+	// a mirrored output
+	struct wlr_drm_mgpu_image mgpu_images[4];
+	size_t mgpu_next;
+
+	// Buffers also scanned out by mirror outputs. They go back to the
+	// surface once both it and all mirrors are done with them.
+	struct {
+		struct gbm_bo *bo;
+		int refs;
+		bool released;
+	} mirrored[4];
+};
+
+struct wlr_drm_plane {
+	uint32_t type;
+	uint32_t id;
+
+	uint32_t possible_crtcs;
+
+	// Surface rendered into. On secondary GPUs, this lives on the render GPU.
+	struct wlr_drm_surface surf;
+	// Only used if surf can't be scanned out directly (secondary GPUs, GL
+	// upscaling): the copy of surf which gets scanned out
+	struct wlr_drm_surface mgpu_surf;
+
+	// Size of the attached buffer when it isn't one of ours, i.e. when
+	// scanning out a mirrored output. Zero otherwise.
+	uint32_t src_width, src_height;
+	// Size on the CRTC if the display engine scales the buffer. Zero
+	// otherwise.
+	uint32_t crtc_width, crtc_height;
+
 	// Only used by cursor
 	float matrix[16];
 	struct wlr_renderer *wlr_rend;
@@ -71,24 +131,20 @@ struct wlr_drm_connector {
 	struct wl_list link;
 };
 
-struct wlr_drm_renderer {
-	int fd;
-	struct gbm_device *gbm;
-	struct wlr_egl egl;
-};
-
-bool wlr_drm_renderer_init(struct wlr_drm_renderer *renderer, int fd);
-void wlr_drm_renderer_free(struct wlr_drm_renderer *renderer);
-
 struct wlr_drm_interface;
 
 struct wlr_drm_backend {
 	struct wlr_backend backend;
 
+	// The backend of the render GPU, or NULL if this is the render GPU
+	struct wlr_drm_backend *parent;
+
 	const struct wlr_drm_interface *iface;
 
 	int fd;
 	dev_t dev;
+	// Whether page-flip timestamps are in CLOCK_MONOTONIC
+	bool monotonic_timestamps;
 
 	size_t num_crtcs;
 	struct wlr_drm_crtc *crtcs;
@@ -157,6 +213,22 @@ struct wlr_drm_output {
 	struct wlr_drm_renderer *renderer;
 
 	bool pageflip_pending;
+
+	// Frames are rendered at this fraction of the mode's size and upscaled
+	float render_scale;
+	// Set if the display engine can't do the upscaling
+	bool gl_upscale;
+	// Set if render_scale changed while a flip was pending
+	bool rescale_pending;
+
+	// Output whose frames are shown here instead of our own, or NULL
+	struct wlr_drm_output *mirror_source;
+	// Set if the source's buffers can't be scanned out here and get copied
+	bool mirror_blit;
+	// Source buffers on screen and queued for scanout
+	struct wlr_drm_surface *mirror_surf;
+	struct gbm_bo *mirror_front;
+	struct gbm_bo *mirror_back;
 };
 
 // Used to provide atomic or legacy DRM functions
@@ -168,6 +240,10 @@ struct wlr_drm_interface {
 	bool (*crtc_pageflip)(struct wlr_drm_backend *backend,
 			struct wlr_drm_output *output, struct wlr_drm_crtc *crtc,
 			uint32_t fb_id, drmModeModeInfo *mode);
+	// Check whether crtc can scan out fb_id with the current plane setup
+	bool (*crtc_test)(struct wlr_drm_backend *backend,
+			struct wlr_drm_output *output, struct wlr_drm_crtc *crtc,
+			uint32_t fb_id, drmModeModeInfo *mode);
 	// Enable the cursor buffer on crtc. Set bo to NULL to disable
 	bool (*crtc_set_cursor)(struct wlr_drm_backend *backend,
 			struct wlr_drm_crtc *crtc, struct gbm_bo *bo);
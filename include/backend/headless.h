@@ -0,0 +1,35 @@
+#ifndef _WLR_INTERNAL_BACKEND_HEADLESS_H
+#define _WLR_INTERNAL_BACKEND_HEADLESS_H
+
+#include <stdbool.h>
+#include <EGL/egl.h>
+#include <wayland-server.h>
+#include <wlr/egl.h>
+#include <wlr/backend/headless.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/list.h>
+
+#define HEADLESS_DEFAULT_REFRESH (60 * 1000) // 60 Hz
+
+struct wlr_headless_backend {
+	struct wlr_backend backend;
+
+	struct wl_display *display;
+	struct wlr_egl egl;
+	list_t *outputs;
+	bool started;
+};
+
+struct wlr_headless_output {
+	struct wlr_output wlr_output;
+
+	struct wlr_headless_backend *backend;
+	EGLSurface egl_surface;
+
+	struct wl_event_source *frame_timer;
+	int frame_delay; // ms
+};
+
+void wlr_headless_output_start(struct wlr_headless_output *output);
+
+#endif
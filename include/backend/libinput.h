@@ -1,13 +1,26 @@
 #ifndef _WLR_BACKEND_LIBINPUT_INTERNAL_H
 #define _WLR_BACKEND_LIBINPUT_INTERNAL_H
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <libinput.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_input_device.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_touch.h>
+#include <wlr/types/wlr_tablet_tool.h>
+#include <wlr/types/wlr_tablet_pad.h>
 #include <wlr/backend/interface.h>
 #include <wlr/interfaces/wlr_input_device.h>
-#include <wlr/util/list.h>
 #include "backend/udev.h"
 
+// Bucket i counts events delivered between 2^i and 2^(i+1) microseconds
+// after the kernel timestamped them, the last one everything older
+#define WLR_LIBINPUT_LATENCY_BUCKETS 20
+
+struct wlr_libinput_thread;
+
 struct wlr_libinput_backend {
 	struct wlr_backend backend;
 
@@ -18,9 +31,26 @@ struct wlr_libinput_backend {
 	struct libinput *libinput_context;
 	struct wl_event_source *input_event;
 
+	// Set with WLR_LIBINPUT_THREAD=1, the libinput context is then read from
+	// a separate thread and has to be used with libinput_lock held
+	bool use_thread;
+	struct wlr_libinput_thread *thread;
+	pthread_mutex_t libinput_lock; // recursive
+
 	struct wl_listener session_signal;
 
-	list_t *wlr_device_lists;
+	struct wl_list devices; // wlr_libinput_device_set::link
+
+	// Evdev nodes of the seat opened in one batch before libinput probes
+	// them, handed out by open_restricted during startup
+	struct wl_array preopened; // struct wlr_libinput_preopened
+
+	uint64_t latency_histogram[WLR_LIBINPUT_LATENCY_BUCKETS];
+};
+
+struct wlr_libinput_preopened {
+	char *path;
+	int fd; // -1 once libinput took it
 };
 
 struct wlr_libinput_input_device {
@@ -29,58 +59,160 @@ struct wlr_libinput_input_device {
 	struct libinput_device *handle;
 };
 
-void wlr_libinput_event(struct wlr_libinput_backend *state,
-		struct libinput_event *event);
+#define WLR_LIBINPUT_DEVICE_TYPES (WLR_INPUT_DEVICE_TABLET_PAD + 1)
+
+/**
+ * The devices created for a libinput device, one per capability and indexed
+ * by their type. Stored in the libinput device's user data.
+ */
+struct wlr_libinput_device_set {
+	struct libinput_device *handle;
+	struct wlr_input_device *devices[WLR_LIBINPUT_DEVICE_TYPES];
+	struct wl_list link; // wlr_libinput_backend::devices
+};
+
+void wlr_libinput_device_set_destroy(struct wlr_libinput_backend *backend,
+		struct wlr_libinput_device_set *set);
+
+/**
+ * A libinput event converted to the wlr_event_* structs it is emitted as. Only
+ * the libinput device is kept, the wlr_input_device is looked up when the
+ * event is emitted.
+ */
+struct wlr_libinput_input_event {
+	enum libinput_event_type type;
+	struct libinput_device *device;
+	uint64_t time_usec; // CLOCK_MONOTONIC, 0 for device events
+
+	union {
+		struct wlr_event_keyboard_key keyboard_key;
+		struct wlr_event_pointer_motion pointer_motion;
+		struct wlr_event_pointer_motion_absolute pointer_motion_abs;
+		struct wlr_event_pointer_button pointer_button;
+		struct {
+			struct wlr_event_pointer_axis axes[2];
+			size_t n_axes;
+		} pointer_axis;
+		struct wlr_event_touch_down touch_down;
+		struct wlr_event_touch_up touch_up;
+		struct wlr_event_touch_motion touch_motion;
+		struct wlr_event_touch_cancel touch_cancel;
+		struct wlr_event_touch_frame touch_frame;
+		struct {
+			// Emitted before the event itself if has_axis is set
+			struct wlr_event_tablet_tool_axis axis;
+			bool has_axis;
+			union {
+				struct wlr_event_tablet_tool_proximity proximity;
+				struct wlr_event_tablet_tool_tip tip;
+				struct wlr_event_tablet_tool_button button;
+			};
+		} tablet_tool;
+		struct wlr_event_tablet_pad_button tablet_pad_button;
+		struct wlr_event_tablet_pad_ring tablet_pad_ring;
+		struct wlr_event_tablet_pad_strip tablet_pad_strip;
+	};
+};
+
+/**
+ * Fills out from a libinput event. Returns false if the event isn't emitted
+ * at all.
+ */
+bool wlr_libinput_event_convert(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void wlr_libinput_event_emit(struct wlr_libinput_backend *backend,
+		struct wlr_libinput_input_event *event);
+/**
+ * Emits an input event on the matching device of set, without going through
+ * the libinput device.
+ */
+void wlr_libinput_event_dispatch(struct wlr_libinput_device_set *set,
+		struct wlr_libinput_input_event *event);
 
-struct wlr_input_device *get_appropriate_device(
-		enum wlr_input_device_type desired_type,
+struct wlr_libinput_backend *wlr_libinput_backend_from_device(
 		struct libinput_device *device);
+void wlr_libinput_backend_lock(struct wlr_libinput_backend *backend);
+void wlr_libinput_backend_unlock(struct wlr_libinput_backend *backend);
+
+/**
+ * Starts reading the backend's libinput context on a separate thread. Events
+ * are handed to the main loop through a ring buffer and emitted from there.
+ */
+struct wlr_libinput_thread *wlr_libinput_thread_create(
+		struct wlr_libinput_backend *backend);
+void wlr_libinput_thread_destroy(struct wlr_libinput_thread *thread);
+bool wlr_libinput_thread_is_current(struct wlr_libinput_thread *thread);
+/**
+ * Open and close device files from the input thread. The session is only
+ * used on the main loop, these wait for it to do the call.
+ */
+int wlr_libinput_thread_open_file(struct wlr_libinput_thread *thread,
+		const char *path);
+void wlr_libinput_thread_close_file(struct wlr_libinput_thread *thread,
+		int fd);
+/**
+ * Takes the backend's libinput lock on the main loop, serving the session
+ * requests of the input thread while it is held there.
+ */
+void wlr_libinput_thread_lock_backend(struct wlr_libinput_thread *thread);
 
 struct wlr_keyboard *wlr_libinput_keyboard_create(
 		struct libinput_device *device);
-void handle_keyboard_key(struct libinput_event *event,
-		struct libinput_device *device);
+void convert_keyboard_key(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void handle_keyboard_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event);
 
 struct wlr_pointer *wlr_libinput_pointer_create(
 		struct libinput_device *device);
-void handle_pointer_motion(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_pointer_motion_abs(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_pointer_button(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_pointer_axis(struct libinput_event *event,
-		struct libinput_device *device);
+void convert_pointer_motion(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_pointer_motion_abs(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_pointer_button(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_pointer_axis(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void handle_pointer_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event);
 
 struct wlr_touch *wlr_libinput_touch_create(
 		struct libinput_device *device);
-void handle_touch_down(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_touch_up(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_touch_motion(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_touch_cancel(struct libinput_event *event,
-		struct libinput_device *device);
+void convert_touch_down(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_touch_up(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_touch_motion(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_touch_cancel(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_touch_frame(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void handle_touch_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event);
 
 struct wlr_tablet_tool *wlr_libinput_tablet_tool_create(
 		struct libinput_device *device);
-void handle_tablet_tool_axis(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_tablet_tool_proximity(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_tablet_tool_tip(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_tablet_tool_button(struct libinput_event *event,
-		struct libinput_device *device);
+void convert_tablet_tool_axis(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_tablet_tool_proximity(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_tablet_tool_tip(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_tablet_tool_button(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void handle_tablet_tool_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event);
 
 struct wlr_tablet_pad *wlr_libinput_tablet_pad_create(
 		struct libinput_device *device);
-void handle_tablet_pad_button(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_tablet_pad_ring(struct libinput_event *event,
-		struct libinput_device *device);
-void handle_tablet_pad_strip(struct libinput_event *event,
-		struct libinput_device *device);
+void convert_tablet_pad_button(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_tablet_pad_ring(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void convert_tablet_pad_strip(struct libinput_event *event,
+		struct wlr_libinput_input_event *out);
+void handle_tablet_pad_event(struct wlr_input_device *wlr_dev,
+		struct wlr_libinput_input_event *event);
 
 #endif
@@ -0,0 +1,136 @@
+#ifndef _WLR_INTERNAL_BACKEND_REPLAY_H
+#define _WLR_INTERNAL_BACKEND_REPLAY_H
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wayland-server.h>
+#include <wlr/backend/interface.h>
+#include <wlr/backend/replay.h>
+#include <wlr/types/wlr_input_device.h>
+
+/*
+ * A recording is a file header followed by records, each a record header
+ * and size bytes of payload. Event payloads are the wlr_event_* structs as
+ * they were emitted, except for those holding pointers, so a recording is
+ * only meant to be replayed by a build of the same wlroots on the same
+ * architecture; the version is bumped when the layout of any of them changes.
+ */
+#define WLR_REPLAY_MAGIC "WLRINPUT"
+#define WLR_REPLAY_VERSION 3
+// Large enough for any event struct, a full touch frame and a device name
+#define WLR_REPLAY_MAX_PAYLOAD 1024
+
+struct wlr_replay_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+enum wlr_replay_record_type {
+	WLR_REPLAY_DEVICE_ADD,
+	WLR_REPLAY_DEVICE_REMOVE,
+	WLR_REPLAY_KEYBOARD_KEY,
+	WLR_REPLAY_POINTER_MOTION,
+	WLR_REPLAY_POINTER_MOTION_ABSOLUTE,
+	WLR_REPLAY_POINTER_BUTTON,
+	WLR_REPLAY_POINTER_AXIS,
+	WLR_REPLAY_TOUCH_DOWN,
+	WLR_REPLAY_TOUCH_UP,
+	WLR_REPLAY_TOUCH_MOTION,
+	WLR_REPLAY_TOUCH_CANCEL,
+	WLR_REPLAY_TABLET_TOOL_AXIS,
+	WLR_REPLAY_TABLET_TOOL_PROXIMITY,
+	WLR_REPLAY_TABLET_TOOL_TIP,
+	WLR_REPLAY_TABLET_TOOL_BUTTON,
+	WLR_REPLAY_TABLET_PAD_BUTTON,
+	WLR_REPLAY_TABLET_PAD_RING,
+	WLR_REPLAY_TABLET_PAD_STRIP,
+	WLR_REPLAY_TOUCH_FRAME,
+	WLR_REPLAY_RECORD_TYPES,
+};
+
+struct wlr_replay_record {
+	uint64_t time_nsec; // since the recorder was created
+	uint32_t device; // assigned by the WLR_REPLAY_DEVICE_ADD record
+	uint16_t type; // enum wlr_replay_record_type
+	uint16_t size; // of the payload
+};
+
+// Payload of WLR_REPLAY_DEVICE_ADD, followed by name_len bytes of name
+struct wlr_replay_device_info {
+	uint32_t type; // enum wlr_input_device_type
+	int32_t vendor, product;
+	uint32_t name_len;
+};
+
+// Payload of WLR_REPLAY_TOUCH_FRAME, followed by n_points wlr_touch_point
+struct wlr_replay_touch_frame {
+	uint32_t time_sec;
+	uint64_t time_usec;
+	double width_mm, height_mm;
+	uint32_t n_points;
+};
+
+struct wlr_replay_device {
+	struct wlr_input_device *wlr_device;
+	uint32_t id;
+	struct wl_list link; // wlr_replay_backend::devices
+};
+
+struct wlr_replay_backend {
+	struct wlr_backend backend;
+
+	struct wl_display *display;
+	FILE *file;
+	double speed;
+	bool finished;
+
+	// The record due next, read ahead of time
+	bool has_record;
+	struct wlr_replay_record record;
+	alignas(max_align_t) uint8_t payload[WLR_REPLAY_MAX_PAYLOAD];
+
+	// Replay clock, records are due at start + time_nsec / speed
+	uint64_t start_nsec;
+
+	struct wl_event_source *timer;
+	struct wl_event_source *idle;
+	struct wl_list devices; // wlr_replay_device::link
+
+	struct wl_signal done;
+};
+
+struct wlr_recorder_device;
+
+struct wlr_recorder_listener {
+	struct wl_listener listener;
+	struct wlr_recorder_device *device;
+	uint16_t type;
+	uint16_t size;
+};
+
+struct wlr_recorder_device {
+	struct wlr_input_recorder *recorder;
+	struct wlr_input_device *wlr_device;
+	uint32_t id;
+	struct wlr_recorder_listener listeners[5];
+	size_t n_listeners;
+	struct wl_list link; // wlr_input_recorder::devices
+};
+
+struct wlr_input_recorder {
+	FILE *file;
+	uint64_t start_nsec;
+	uint32_t next_id;
+	struct wl_list devices; // wlr_recorder_device::link
+
+	struct wl_listener input_add;
+	struct wl_listener input_remove;
+};
+
+uint64_t wlr_replay_get_time_nsec(void);
+
+#endif
@@ -1,9 +1,17 @@
 #ifndef SESSION_DIRECT_IPC
 #define SESSION_DIRECT_IPC
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <sys/types.h>
 
+// Open requests sent ahead of their replies by direct_ipc_open_batch
+#define DIRECT_IPC_BATCH_WINDOW 32
+
 int direct_ipc_open(int sock, const char *path);
+// Returns false if the socket broke, the files not opened get -EPIPE
+bool direct_ipc_open_batch(int sock, size_t n, const char *const paths[],
+		int fds[]);
 void direct_ipc_setmaster(int sock, int fd);
 void direct_ipc_dropmaster(int sock, int fd);
 void direct_ipc_finish(int sock, pid_t pid);
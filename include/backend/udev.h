@@ -22,7 +22,8 @@ struct wlr_udev {
 	struct wl_list devices;
 };
 
-int wlr_udev_find_gpu(struct wlr_udev *udev, struct wlr_session *session);
+size_t wlr_udev_find_gpus(struct wlr_udev *udev, struct wlr_session *session,
+		size_t ret_len, int *ret);
 bool wlr_udev_signal_add(struct wlr_udev *udev, dev_t dev, struct wl_listener *listener);
 void wlr_udev_signal_remove(struct wlr_udev *udev, struct wl_listener *listener);
 
@@ -14,6 +14,9 @@
 #include <wlr/util/log.h>
 
 extern PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES;
+// GL_EXT_texture_format_BGRA8888, without it BGRA data is uploaded as RGBA
+// and swizzled back in the shader
+extern bool gles2_has_bgra;
 
 struct pixel_format {
 	uint32_t wl_format;
@@ -26,20 +29,23 @@ struct wlr_gles2_renderer {
 	struct wlr_renderer wlr_renderer;
 
 	struct wlr_egl *egl;
+	struct wl_list buffer_images; // gles2_buffer_image::link
 };
 
 struct wlr_gles2_texture {
 	struct wlr_texture wlr_texture;
 
+	struct wlr_gles2_renderer *renderer;
 	struct wlr_egl *egl;
 	GLuint tex_id;
+	GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_EXTERNAL_OES
 	const struct pixel_format *pixel_format;
-	EGLImageKHR image;
 };
 
 struct shaders {
 	bool initialized;
 	GLuint rgba, rgbx;
+	GLuint bgra, bgrx;
 	GLuint quad;
 	GLuint ellipse;
 	GLuint external;
@@ -48,8 +54,11 @@ struct shaders {
 extern struct shaders shaders;
 
 const struct pixel_format *gl_format_for_wl_format(enum wl_shm_format fmt);
+const struct pixel_format *gl_upload_format_for_wl_format(
+		enum wl_shm_format fmt);
 
-struct wlr_texture *gles2_texture_init();
+struct wlr_texture *gles2_texture_init(struct wlr_gles2_renderer *renderer);
+void gles2_buffer_images_destroy(struct wlr_gles2_renderer *renderer);
 
 extern const GLchar quad_vertex_src[];
 extern const GLchar quad_fragment_src[];
@@ -57,6 +66,8 @@ extern const GLchar ellipse_fragment_src[];
 extern const GLchar vertex_src[];
 extern const GLchar fragment_src_rgba[];
 extern const GLchar fragment_src_rgbx[];
+extern const GLchar fragment_src_bgra[];
+extern const GLchar fragment_src_bgrx[];
 extern const GLchar fragment_src_external[];
 
 bool _gles2_flush_errors(const char *file, int line);
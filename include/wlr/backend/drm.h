@@ -6,9 +6,37 @@
 #include <wlr/backend.h>
 #include <wlr/backend/udev.h>
 
+/*
+ * Creates a DRM backend using the specified GPU file descriptor.
+ * If parent is a DRM backend, this GPU only scans out: frames are rendered
+ * on the parent's GPU and copied over. parent should be NULL otherwise.
+ * The backend takes ownership of gpu_fd, unless creating it fails.
+ */
 struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
-		struct wlr_session *session, struct wlr_udev *udev, int gpu_fd);
+		struct wlr_session *session, struct wlr_udev *udev, int gpu_fd,
+		struct wlr_backend *parent);
 
 bool wlr_backend_is_drm(struct wlr_backend *backend);
 
+struct wlr_output;
+
+/*
+ * Shows the frames of source on mirror too. source renders as usual, while
+ * mirror stops emitting frame events and scans out source's buffers, scaled
+ * by the display hardware if the sizes differ. When that isn't supported,
+ * each frame is copied to mirror with a single blit instead.
+ * Both outputs must belong to the same DRM backend. Pass a NULL source to
+ * stop mirroring.
+ */
+bool wlr_drm_output_set_mirror(struct wlr_output *mirror,
+		struct wlr_output *source);
+
+/*
+ * Renders output at scale times the size of its mode, with 0 < scale <= 1,
+ * and upscales the result to fill the screen. The display engine's scaler is
+ * used when it supports the configuration, otherwise frames are upscaled with
+ * a GL blit. The output's resolution changes accordingly.
+ */
+bool wlr_drm_output_set_render_scale(struct wlr_output *output, float scale);
+
 #endif
@@ -0,0 +1,28 @@
+#ifndef WLR_BACKEND_HEADLESS_H
+#define WLR_BACKEND_HEADLESS_H
+
+#include <wayland-server.h>
+#include <wlr/backend.h>
+#include <wlr/types/wlr_output.h>
+#include <stdbool.h>
+
+/**
+ * Creates a headless backend. It doesn't need a session, a DRM device or a
+ * parent compositor: outputs are rendered offscreen with a surfaceless EGL
+ * display (e.g. llvmpipe) and their frames are driven by a timer.
+ * The backend is created with no outputs; use wlr_headless_add_output.
+ */
+struct wlr_backend *wlr_headless_backend_create(struct wl_display *display);
+/**
+ * Adds a virtual output of the given size to the backend. Its only mode
+ * refreshes at 60Hz, but any mode can be set with wlr_output_set_mode.
+ * Outputs added before the backend is started are announced when it starts.
+ */
+struct wlr_output *wlr_headless_add_output(struct wlr_backend *backend,
+		int32_t width, int32_t height);
+/**
+ * True if the given backend is a headless backend.
+ */
+bool wlr_backend_is_headless(struct wlr_backend *backend);
+
+#endif
@@ -8,8 +8,19 @@
 #include <wlr/backend/udev.h>
 #include <wlr/types/wlr_input_device.h>
 
+/**
+ * Creates the libinput backend. With WLR_LIBINPUT_THREAD=1 set in the
+ * environment, events are read from libinput on a separate thread so they
+ * are timestamped and queued while the main loop is busy, and emitted from
+ * the main loop as usual.
+ */
 struct wlr_backend *wlr_libinput_backend_create(struct wl_display *display,
 		struct wlr_session *session, struct wlr_udev *udev);
+/**
+ * Returns the libinput device of a device created by this backend. With the
+ * input thread, the handle may only be used from the input_add signal, while
+ * the backend holds the libinput lock.
+ */
 struct libinput_device *wlr_libinput_get_device_handle(struct wlr_input_device *dev);
 
 bool wlr_backend_is_libinput(struct wlr_backend *backend);
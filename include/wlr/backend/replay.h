@@ -0,0 +1,46 @@
+#ifndef WLR_BACKEND_REPLAY_H
+#define WLR_BACKEND_REPLAY_H
+
+#include <stdbool.h>
+#include <wayland-server.h>
+#include <wlr/backend.h>
+
+struct wlr_input_recorder;
+
+/**
+ * Creates a backend replaying the input devices and events of a recording
+ * made with wlr_input_recorder. Combine it with a headless backend in a
+ * multi backend to run a compositor against the same input every time.
+ *
+ * Events are emitted at their recorded pace divided by speed, so 1 replays in
+ * real time and 2 twice as fast. A speed of 0 replays as fast as the event
+ * loop allows. Event timestamps are moved to the time of the replay.
+ *
+ * wlr_backend_autocreate sets this up when WLR_HEADLESS_OUTPUTS and
+ * WLR_INPUT_REPLAY=<path> are set, with the speed in WLR_INPUT_REPLAY_SPEED.
+ */
+struct wlr_backend *wlr_replay_backend_create(struct wl_display *display,
+		const char *path, double speed);
+/**
+ * True if the given backend is a replay backend.
+ */
+bool wlr_backend_is_replay(struct wlr_backend *backend);
+/**
+ * Signal emitted once the last record was replayed. The devices of the
+ * recording are kept until the backend is destroyed.
+ */
+struct wl_signal *wlr_replay_backend_get_done_signal(
+		struct wlr_backend *backend);
+
+/**
+ * Records the input devices a backend announces from now on and the events
+ * they emit to a file. Create it before starting the backend, devices added
+ * earlier are not recorded. Pointer motion is recorded as the pointer emits
+ * it, after coalescing, tablet tool axes before it. Destroy the recorder
+ * before the backend.
+ */
+struct wlr_input_recorder *wlr_input_recorder_create(
+		struct wlr_backend *backend, const char *path);
+void wlr_input_recorder_destroy(struct wlr_input_recorder *recorder);
+
+#endif
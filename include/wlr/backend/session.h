@@ -2,6 +2,7 @@
 #define WLR_SESSION_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <wayland-server.h>
 #include <sys/types.h>
 
@@ -16,7 +17,13 @@ struct wlr_session {
 	struct wl_signal session_signal;
 	bool active;
 
-	int drm_fd;
+	/*
+	 * DRM devices opened through this session, which lose and regain
+	 * DRM master as the session becomes inactive/active.
+	 */
+	int drm_fds[8];
+	size_t num_drm_fds;
+
 	unsigned vtnr;
 	char seat[8];
 };
@@ -52,6 +59,14 @@ void wlr_session_finish(struct wlr_session *session);
  */
 int wlr_session_open_file(struct wlr_session *session, const char *path);
 
+/*
+ * Opens several files like wlr_session_open_file, with fewer round trips
+ * where the session supports it. fds[i] is set to the file descriptor of
+ * paths[i], or -errno on error.
+ */
+void wlr_session_open_files(struct wlr_session *session, size_t n,
+		const char *const paths[], int fds[]);
+
 /*
  * Closes a file previously opened with wlr_session_open_file.
  */
@@ -7,8 +7,18 @@ struct session_impl {
 	struct wlr_session *(*start)(struct wl_display *disp);
 	void (*finish)(struct wlr_session *session);
 	int (*open)(struct wlr_session *session, const char *path);
+	// Optional, open is called for each file otherwise
+	void (*open_files)(struct wlr_session *session, size_t n,
+		const char *const paths[], int fds[]);
 	void (*close)(struct wlr_session *session, int fd);
 	bool (*change_vt)(struct wlr_session *session, unsigned vt);
 };
 
+/*
+ * Used by implementations to keep track of opened DRM devices.
+ * session_add_drm_fd returns false if too many are open.
+ */
+bool session_add_drm_fd(struct wlr_session *session, int fd);
+void session_remove_drm_fd(struct wlr_session *session, int fd);
+
 #endif
@@ -18,10 +18,21 @@ struct wlr_egl {
 	PFNEGLQUERYWAYLANDBUFFERWL eglQueryWaylandBufferWL;
 	PFNEGLBINDWAYLANDDISPLAYWL eglBindWaylandDisplayWL;
 	PFNEGLUNBINDWAYLANDDISPLAYWL eglUnbindWaylandDisplayWL;
+	PFNEGLQUERYDMABUFFORMATSEXTPROC eglQueryDmaBufFormatsEXT;
+	PFNEGLQUERYDMABUFMODIFIERSEXTPROC eglQueryDmaBufModifiersEXT;
+	PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR;
+	PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR;
+	PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID;
 
 	const char *egl_exts;
 	const char *gl_exts;
 
+	struct {
+		bool dmabuf_import;
+		bool dmabuf_import_modifiers;
+		bool native_fence_sync;
+	} exts;
+
 	struct wl_display *wl_display;
 };
 
@@ -62,6 +73,37 @@ EGLSurface wlr_egl_create_surface(struct wlr_egl *egl, void *window);
 EGLImageKHR wlr_egl_create_image(struct wlr_egl *egl,
 		EGLenum target, EGLClientBuffer buffer, const EGLint *attribs);
 
+struct wlr_dmabuf_buffer_attribs;
+
+/**
+ * Imports a linux dmabuf into an egl image. Modifiers are passed along when
+ * egl supports them.
+ */
+EGLImageKHR wlr_egl_create_image_from_dmabuf(struct wlr_egl *egl,
+		struct wlr_dmabuf_buffer_attribs *attributes);
+
+/**
+ * Gets the DRM fourcc formats egl can import dmabufs in. Returns the number
+ * of formats and stores a newly allocated array in formats, or -1 on error.
+ */
+int wlr_egl_get_dmabuf_formats(struct wlr_egl *egl, int **formats);
+
+/**
+ * Gets the modifiers egl can import dmabufs of the given format with. Returns
+ * the number of modifiers and stores a newly allocated array in modifiers,
+ * or -1 on error. Returns 0 if egl can't tell, in which case only implicit
+ * modifiers should be used.
+ */
+int wlr_egl_get_dmabuf_modifiers(struct wlr_egl *egl, int format,
+		uint64_t **modifiers);
+
+/**
+ * Creates a sync_file fence that signals once the GL commands submitted so
+ * far have completed, and flushes them. Returns the fence fd, or -1 if
+ * EGL_ANDROID_native_fence_sync isn't supported.
+ */
+int wlr_egl_create_fence_fd(struct wlr_egl *egl);
+
 /**
  * Destroys an egl image created with the given wlr_egl.
  */
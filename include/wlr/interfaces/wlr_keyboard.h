@@ -10,5 +10,10 @@ struct wlr_keyboard_impl {
 
 void wlr_keyboard_init(struct wlr_keyboard *keyboard, struct wlr_keyboard_impl *impl);
 void wlr_keyboard_destroy(struct wlr_keyboard *keyboard);
+/**
+ * Updates the repeat settings the device prefers and emits repeat_info.
+ */
+void wlr_keyboard_set_repeat_info(struct wlr_keyboard *keyboard,
+		int32_t rate, int32_t delay);
 
 #endif
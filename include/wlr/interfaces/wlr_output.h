@@ -21,5 +21,11 @@ void wlr_output_free(struct wlr_output *output);
 void wlr_output_update_matrix(struct wlr_output *output);
 struct wl_global *wlr_output_create_global(
 		struct wlr_output *wlr_output, struct wl_display *display);
+/**
+ * Emits the present event. If when is NULL, the current time is used. The
+ * refresh interval is derived from the current mode.
+ */
+void wlr_output_send_present(struct wlr_output *output, struct timespec *when,
+		unsigned seq, uint32_t flags);
 
 #endif
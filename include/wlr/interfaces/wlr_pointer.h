@@ -10,4 +10,17 @@ void wlr_pointer_init(struct wlr_pointer *pointer,
 		struct wlr_pointer_impl *impl);
 void wlr_pointer_destroy(struct wlr_pointer *pointer);
 
+/**
+ * Emits an event on the pointer, backends use these instead of emitting the
+ * signals themselves so motion can be coalesced.
+ */
+void wlr_pointer_notify_motion(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_motion *event);
+void wlr_pointer_notify_motion_absolute(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_motion_absolute *event);
+void wlr_pointer_notify_button(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_button *event);
+void wlr_pointer_notify_axis(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_axis *event);
+
 #endif
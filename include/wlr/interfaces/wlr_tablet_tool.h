@@ -10,4 +10,17 @@ void wlr_tablet_tool_init(struct wlr_tablet_tool *tool,
 		struct wlr_tablet_tool_impl *impl);
 void wlr_tablet_tool_destroy(struct wlr_tablet_tool *tool);
 
+/**
+ * Emits an event on the tool, backends use these instead of emitting the
+ * signals themselves so axis updates can be coalesced.
+ */
+void wlr_tablet_tool_notify_axis(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_axis *event);
+void wlr_tablet_tool_notify_proximity(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_proximity *event);
+void wlr_tablet_tool_notify_tip(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_tip *event);
+void wlr_tablet_tool_notify_button(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_button *event);
+
 #endif
@@ -10,4 +10,23 @@ void wlr_touch_init(struct wlr_touch *touch,
 		struct wlr_touch_impl *impl);
 void wlr_touch_destroy(struct wlr_touch *touch);
 
+/**
+ * Emits an event on the touch device, backends use these instead of emitting
+ * the signals themselves so the points can be grouped into frames.
+ */
+void wlr_touch_notify_down(struct wlr_touch *touch,
+		struct wlr_event_touch_down *event);
+void wlr_touch_notify_up(struct wlr_touch *touch,
+		struct wlr_event_touch_up *event);
+void wlr_touch_notify_motion(struct wlr_touch *touch,
+		struct wlr_event_touch_motion *event);
+void wlr_touch_notify_cancel(struct wlr_touch *touch,
+		struct wlr_event_touch_cancel *event);
+/**
+ * Ends the current frame. The points of the event are filled in from the
+ * points notified since the last frame, nothing is emitted if there are none.
+ */
+void wlr_touch_notify_frame(struct wlr_touch *touch,
+		struct wlr_event_touch_frame *event);
+
 #endif
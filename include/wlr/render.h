@@ -28,6 +28,15 @@ struct wlr_texture *wlr_render_texture_init(struct wlr_renderer *r);
  */
 bool wlr_render_with_matrix(struct wlr_renderer *r,
 		struct wlr_texture *texture, const float (*matrix)[16]);
+/**
+ * Renders the texture like wlr_render_with_matrix, but samples it at the
+ * texture coordinates texcoord_matrix maps the corners of the unit square to.
+ * This crops, scales and transforms the texture while it's drawn, see
+ * wlr_surface::texcoord_matrix.
+ */
+bool wlr_render_with_texcoord_matrix(struct wlr_renderer *r,
+		struct wlr_texture *texture, const float (*matrix)[16],
+		const float (*texcoord_matrix)[16]);
 /**
  * Renders a solid quad in the specified color.
  */
@@ -48,6 +57,12 @@ const enum wl_shm_format *wlr_renderer_get_formats(
  */
 bool wlr_renderer_buffer_is_drm(struct wlr_renderer *renderer,
 		struct wl_resource *buffer);
+/**
+ * Returns a sync_file fd that signals once the rendering commands submitted so
+ * far are done, or -1 if the renderer can't create fences. The caller owns
+ * the fd.
+ */
+int wlr_renderer_create_fence(struct wlr_renderer *renderer);
 /**
  * Destroys this wlr_renderer. Textures must be destroyed separately.
  */
@@ -95,6 +110,14 @@ bool wlr_texture_upload_shm(struct wlr_texture *tex, uint32_t format,
  bool wlr_texture_upload_drm(struct wlr_texture *tex,
  	struct wl_resource *drm_buffer);
 
+/**
+ * Attaches the contents of the given linux-dmabuf wl_buffer resource onto the
+ * texture without copying. The texture samples from the buffer's memory until
+ * something else is uploaded onto it.
+ */
+bool wlr_texture_upload_dmabuf(struct wlr_texture *tex,
+	struct wl_resource *dmabuf_resource);
+
 /**
  * Copies a rectangle of pixels from a wl_shm_buffer onto the texture. The
  * buffer is not accessed after this function returns. Under some circumstances,
@@ -17,6 +17,9 @@ struct wlr_renderer_impl {
 	struct wlr_texture *(*texture_init)(struct wlr_renderer *renderer);
 	bool (*render_with_matrix)(struct wlr_renderer *renderer,
 		struct wlr_texture *texture, const float (*matrix)[16]);
+	bool (*render_with_texcoord_matrix)(struct wlr_renderer *renderer,
+		struct wlr_texture *texture, const float (*matrix)[16],
+		const float (*texcoord_matrix)[16]);
 	void (*render_quad)(struct wlr_renderer *renderer,
 		const float (*color)[4], const float (*matrix)[16]);
 	void (*render_ellipse)(struct wlr_renderer *renderer,
@@ -25,6 +28,7 @@ struct wlr_renderer_impl {
 		struct wlr_renderer *renderer, size_t *len);
 	bool (*buffer_is_drm)(struct wlr_renderer *renderer,
 		struct wl_resource *buffer);
+	int (*create_fence)(struct wlr_renderer *renderer);
 	void (*destroy)(struct wlr_renderer *renderer);
 };
 
@@ -44,6 +48,8 @@ struct wlr_texture_impl {
 		int x, int y, int width, int height, struct wl_shm_buffer *shm);
 	bool (*upload_drm)(struct wlr_texture *texture,
 		struct wl_resource *drm_buf);
+	bool (*upload_dmabuf)(struct wlr_texture *texture,
+		struct wl_resource *dmabuf_resource);
 	void (*get_matrix)(struct wlr_texture *state,
 		float (*matrix)[16], const float (*projection)[16], int x, int y);
 	void (*bind)(struct wlr_texture *texture);
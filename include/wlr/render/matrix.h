@@ -13,4 +13,12 @@ enum wl_output_transform;
 void wlr_matrix_texture(float mat[static 16], int32_t width, int32_t height,
 		enum wl_output_transform transform);
 
+/*
+ * Writes the matrix mapping the coordinates of a width x height surface to
+ * the coordinates of its buffer, for the buffer transform set with
+ * wl_surface.set_buffer_transform. Scale and viewport aren't applied.
+ */
+void wlr_matrix_buffer_transform(float mat[static 16],
+		enum wl_output_transform transform, int32_t width, int32_t height);
+
 #endif
@@ -0,0 +1,89 @@
+#ifndef _WLR_TYPES_WLR_INPUT_LATENCY_H
+#define _WLR_TYPES_WLR_INPUT_LATENCY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server.h>
+
+struct wlr_output;
+
+// Number of frames the percentiles of an output are computed over
+#define WLR_INPUT_LATENCY_SAMPLES 1024
+
+struct wlr_input_latency {
+	struct wl_list outputs; // wlr_input_latency_output::link
+
+	// Timestamp of the newest input event, in CLOCK_MONOTONIC microseconds
+	uint64_t last_input_usec;
+
+	void *data;
+};
+
+struct wlr_input_latency_output {
+	struct wlr_input_latency *latency;
+	struct wlr_output *output;
+	struct wl_list link; // wlr_input_latency::outputs
+
+	// Newest input already shown in a frame of this output
+	uint64_t sampled_input_usec;
+	// Input of the frame waiting for its present event, 0 if none
+	uint64_t pending_input_usec;
+
+	// Input-to-present latencies of the last frames with input, in
+	// microseconds
+	uint64_t samples[WLR_INPUT_LATENCY_SAMPLES];
+	size_t n_samples, next_sample;
+
+	struct wl_listener output_present;
+	struct wl_listener output_destroy;
+};
+
+struct wlr_input_latency_stats {
+	size_t samples;
+	// In microseconds
+	uint64_t p50, p90, p99, max;
+};
+
+/**
+ * Measures how long input events take to reach the screen. The compositor
+ * reports input with wlr_input_latency_notify_input and tells which frames
+ * of an output show it with wlr_input_latency_output_sampled. When the frame
+ * is presented, the time since the newest input event it contains is
+ * recorded for the output. Percentiles are logged at L_DEBUG every
+ * WLR_INPUT_LATENCY_SAMPLES frames.
+ */
+struct wlr_input_latency *wlr_input_latency_create(void);
+void wlr_input_latency_destroy(struct wlr_input_latency *latency);
+
+/**
+ * Records an input event the compositor acted on, with the time_usec of its
+ * wlr_event_*.
+ */
+void wlr_input_latency_notify_input(struct wlr_input_latency *latency,
+		uint64_t time_usec);
+
+/**
+ * Starts measuring an output. The measurement is removed along with the
+ * output.
+ */
+struct wlr_input_latency_output *wlr_input_latency_add_output(
+		struct wlr_input_latency *latency, struct wlr_output *output);
+void wlr_input_latency_output_destroy(
+		struct wlr_input_latency_output *latency_output);
+
+/**
+ * Tells that the frame being rendered for the output reflects all input
+ * reported so far. Call this before wlr_output_swap_buffers.
+ */
+void wlr_input_latency_output_sampled(
+		struct wlr_input_latency_output *latency_output);
+
+/**
+ * Computes the latency percentiles of the output over its last frames.
+ * Returns false if no frame with input has been presented yet.
+ */
+bool wlr_input_latency_output_get_stats(
+		struct wlr_input_latency_output *latency_output,
+		struct wlr_input_latency_stats *stats);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef _WLR_TYPES_WLR_KEY_REPEAT_H
+#define _WLR_TYPES_WLR_KEY_REPEAT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server.h>
+
+struct wlr_keyboard;
+
+struct wlr_key_repeat {
+	int timer_fd;
+	struct wl_event_source *timer_source;
+	struct wl_list keyboards; // wlr_key_repeat_keyboard::link
+
+	int32_t rate; // repeats per second, 0 disables repeat
+	int32_t delay; // ms before the first repeat
+
+	// The key being repeated, if keyboard is set
+	struct wlr_keyboard *keyboard;
+	uint32_t keycode;
+	// CLOCK_MONOTONIC time of the first repeat, in microseconds
+	uint64_t start_usec;
+	uint64_t repeats; // emitted since start
+
+	struct {
+		struct wl_signal repeat; // struct wlr_event_key_repeat
+	} events;
+
+	void *data;
+};
+
+struct wlr_key_repeat_keyboard {
+	struct wlr_key_repeat *repeat;
+	struct wlr_keyboard *keyboard;
+	struct wl_list link; // wlr_key_repeat::keyboards
+
+	struct wl_listener key;
+};
+
+struct wlr_event_key_repeat {
+	struct wlr_keyboard *keyboard;
+	uint32_t keycode;
+	// Repeats that became due since the last event, more than one if the
+	// event loop fell behind
+	uint32_t count;
+	// When the last of them became due
+	uint32_t time_sec;
+	uint64_t time_usec;
+};
+
+/**
+ * Repeats the last key pressed on any of its keyboards while it is held.
+ * All keyboards share one timerfd on the event loop, so create one per seat.
+ *
+ * Repeats are scheduled on a fixed grid from the first one instead of from
+ * the previous dispatch, so a loaded event loop doesn't make them drift.
+ * Repeats missed while the loop was busy are emitted as a single event
+ * with a count. Keys the keyboard's keymap marks as not repeating, e.g.
+ * modifiers, are ignored.
+ */
+struct wlr_key_repeat *wlr_key_repeat_create(struct wl_event_loop *loop);
+void wlr_key_repeat_destroy(struct wlr_key_repeat *repeat);
+
+/**
+ * Sets the repeat rate in repeats per second and the delay before the first
+ * repeat in milliseconds, like wl_keyboard.repeat_info. A rate of 0 disables
+ * repeat. Takes effect on the next key press.
+ */
+void wlr_key_repeat_set_info(struct wlr_key_repeat *repeat, int32_t rate,
+		int32_t delay);
+
+/**
+ * Starts repeating the keys of a keyboard. Remove the keyboard before
+ * destroying it.
+ */
+bool wlr_key_repeat_add_keyboard(struct wlr_key_repeat *repeat,
+		struct wlr_keyboard *keyboard);
+void wlr_key_repeat_remove_keyboard(struct wlr_key_repeat *repeat,
+		struct wlr_keyboard *keyboard);
+
+/**
+ * Stops the current repeat, e.g. when the keyboard focus changes.
+ */
+void wlr_key_repeat_cancel(struct wlr_key_repeat *repeat);
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef _WLR_TYPES_KEYBOARD_H
 #define _WLR_TYPES_KEYBOARD_H
 #include <wayland-server.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <xkbcommon/xkbcommon.h>
 
 enum WLR_KEYBOARD_LED {
 	WLR_LED_NUM_LOCK = 1,
@@ -17,12 +20,52 @@ struct wlr_keyboard {
 
 	struct {
 		struct wl_signal key;
+		struct wl_signal keymap;
+		struct wl_signal repeat_info;
 	} events;
 
+	// Preferred by the device, e.g. the parent compositor's settings with
+	// the Wayland backend. 0 if it has no preference.
+	struct {
+		int32_t rate, delay;
+	} repeat_info;
+
+	// Set with wlr_keyboard_set_keymap, serialized once into a sealed memfd
+	// shared by every client
+	struct xkb_keymap *keymap;
+	int keymap_fd;
+	size_t keymap_size;
+	// The rule names keymap was compiled from, if it was
+	struct {
+		char *rules, *model, *layout, *variant, *options;
+	} keymap_names;
+
 	void *data;
 };
 
 void wlr_keyboard_led_update(struct wlr_keyboard *keyboard, uint32_t leds);
+/**
+ * Sets the keymap of the keyboard, taking a reference to it. It is
+ * serialized once into a sealed, read-only memfd that is sent to every
+ * client by wlr_keyboard_send_keymap. Emits the keymap signal, unless the
+ * keymap didn't change.
+ */
+bool wlr_keyboard_set_keymap(struct wlr_keyboard *keyboard,
+		struct xkb_keymap *keymap);
+/**
+ * Compiles a keymap from rule names and sets it, see wlr_keyboard_set_keymap.
+ * Nothing is compiled if the names are the ones the current keymap was
+ * compiled from, so it is cheap to call whenever the layout might have
+ * changed.
+ */
+bool wlr_keyboard_set_keymap_from_names(struct wlr_keyboard *keyboard,
+		const struct xkb_rule_names *names);
+/**
+ * Sends the keymap to a wl_keyboard resource. All resources share the same
+ * file descriptor.
+ */
+void wlr_keyboard_send_keymap(struct wlr_keyboard *keyboard,
+		struct wl_resource *resource);
 
 enum wlr_key_state {
 	WLR_KEY_RELEASED,
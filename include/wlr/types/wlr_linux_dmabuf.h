@@ -0,0 +1,67 @@
+#ifndef _WLR_TYPES_WLR_LINUX_DMABUF_H
+#define _WLR_TYPES_WLR_LINUX_DMABUF_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <wayland-server.h>
+#include <wlr/egl.h>
+
+#define WLR_LINUX_DMABUF_MAX_PLANES 4
+
+#ifndef DRM_FORMAT_MOD_INVALID
+#define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
+#endif
+
+struct wlr_dmabuf_buffer_attribs {
+	int32_t width, height;
+	uint32_t format; // DRM fourcc
+	uint32_t flags; // zwp_linux_buffer_params_v1_flags
+	uint64_t modifier[WLR_LINUX_DMABUF_MAX_PLANES];
+
+	int n_planes;
+	uint32_t offset[WLR_LINUX_DMABUF_MAX_PLANES];
+	uint32_t stride[WLR_LINUX_DMABUF_MAX_PLANES];
+	int fd[WLR_LINUX_DMABUF_MAX_PLANES];
+};
+
+struct wlr_dmabuf_buffer {
+	struct wlr_egl *egl;
+	struct wl_resource *buffer_resource;
+	struct wl_resource *params_resource;
+	struct wlr_dmabuf_buffer_attribs attributes;
+
+	// Imported once when the buffer is created and kept until it is
+	// destroyed, textures sample from it directly
+	EGLImageKHR image;
+};
+
+struct wlr_linux_dmabuf {
+	struct wl_global *wl_global;
+	struct wl_list wl_resources;
+	struct wlr_egl *egl;
+
+	void *data;
+};
+
+/**
+ * Creates the zwp_linux_dmabuf_v1 global. The advertised formats and
+ * modifiers are the ones egl can import, and buffers are only handed to the
+ * client once egl accepted them.
+ */
+struct wlr_linux_dmabuf *wlr_linux_dmabuf_create(struct wl_display *display,
+		struct wlr_egl *egl);
+void wlr_linux_dmabuf_destroy(struct wlr_linux_dmabuf *linux_dmabuf);
+
+/**
+ * Returns true if the given wl_buffer resource was created through
+ * linux-dmabuf.
+ */
+bool wlr_dmabuf_resource_is_buffer(struct wl_resource *buffer_resource);
+
+/**
+ * Returns the wlr_dmabuf_buffer backing a wl_buffer resource created through
+ * linux-dmabuf.
+ */
+struct wlr_dmabuf_buffer *wlr_dmabuf_buffer_from_buffer_resource(
+		struct wl_resource *buffer_resource);
+
+#endif
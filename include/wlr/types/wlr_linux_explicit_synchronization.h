@@ -0,0 +1,40 @@
+#ifndef _WLR_TYPES_WLR_LINUX_EXPLICIT_SYNCHRONIZATION_H
+#define _WLR_TYPES_WLR_LINUX_EXPLICIT_SYNCHRONIZATION_H
+#include <wayland-server.h>
+
+struct wlr_surface;
+
+struct wlr_linux_explicit_synchronization {
+	struct wl_global *wl_global;
+	struct wl_list wl_resources;
+
+	void *data;
+};
+
+struct wlr_linux_surface_synchronization {
+	struct wl_resource *resource;
+	struct wlr_surface *surface;
+
+	struct wl_listener surface_destroy;
+	struct wl_listener surface_precommit;
+};
+
+/**
+ * Creates the zwp_linux_explicit_synchronization_v1 global. Acquire fences
+ * are waited on in the event loop, surfaces keep showing their previous
+ * buffer until the fence signals. Release fences come from the surface's
+ * renderer.
+ */
+struct wlr_linux_explicit_synchronization *
+	wlr_linux_explicit_synchronization_create(struct wl_display *display);
+void wlr_linux_explicit_synchronization_destroy(
+		struct wlr_linux_explicit_synchronization *explicit_sync);
+
+/**
+ * Sends a zwp_linux_buffer_release_v1 event and destroys the resource. A
+ * fenced release is sent if fence_fd is a valid fd, which stays owned by the
+ * caller, an immediate release otherwise.
+ */
+void wlr_linux_buffer_release_send(struct wl_resource *release, int fence_fd);
+
+#endif
@@ -3,6 +3,7 @@
 #include <wayland-server.h>
 #include <wlr/util/list.h>
 #include <stdbool.h>
+#include <time.h>
 
 struct wlr_output_mode {
 	uint32_t flags; // enum wl_output_mode
@@ -12,6 +13,28 @@ struct wlr_output_mode {
 
 struct wlr_output_impl;
 
+enum wlr_output_present_flag {
+	// The presentation was synchronized to the vertical retrace
+	WLR_OUTPUT_PRESENT_VSYNC = 0x1,
+	// The timestamp was taken from the display hardware
+	WLR_OUTPUT_PRESENT_HW_CLOCK = 0x2,
+	// The display hardware signalled that it started using the new content
+	WLR_OUTPUT_PRESENT_HW_COMPLETION = 0x4,
+	// No zero-copy flag: client buffers are always composited, never
+	// scanned out directly
+};
+
+struct wlr_output_event_present {
+	struct wlr_output *output;
+	/* Time the content was shown, in CLOCK_MONOTONIC */
+	struct timespec *when;
+	/* Vertical retrace counter (MSC), zero if unavailable */
+	unsigned seq;
+	/* Refresh interval in nanoseconds, zero if unknown */
+	int refresh;
+	uint32_t flags; // enum wlr_output_present_flag
+};
+
 struct wlr_output {
 	const struct wlr_output_impl *impl;
 
@@ -37,6 +60,8 @@ struct wlr_output {
 	struct {
 		struct wl_signal frame;
 		struct wl_signal resolution;
+		struct wl_signal present;
+		struct wl_signal destroy;
 	} events;
 
 	struct {
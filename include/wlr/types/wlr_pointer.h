@@ -2,27 +2,17 @@
 #define _WLR_TYPES_POINTER_H
 #include <wlr/types/wlr_input_device.h>
 #include <wayland-server.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 struct wlr_pointer_impl;
 
-struct wlr_pointer {
-	struct wlr_pointer_impl *impl;
-
-	struct {
-		struct wl_signal motion;
-		struct wl_signal motion_absolute;
-		struct wl_signal button;
-		struct wl_signal axis;
-	} events;
-
-	void *data;
-};
-
 struct wlr_event_pointer_motion {
 	uint32_t time_sec;
 	uint64_t time_usec;
 	double delta_x, delta_y;
+	// Before pointer acceleration, for clients asking for relative motion
+	double unaccel_dx, unaccel_dy;
 };
 
 struct wlr_event_pointer_motion_absolute {
@@ -59,4 +49,44 @@ struct wlr_event_pointer_axis {
 	double delta;
 };
 
+struct wlr_pointer {
+	struct wlr_pointer_impl *impl;
+
+	struct {
+		struct wl_signal motion;
+		struct wl_signal motion_absolute;
+		struct wl_signal button;
+		struct wl_signal axis;
+	} events;
+
+	// Motion held back until the next flush, see
+	// wlr_pointer_set_motion_coalescing
+	struct {
+		bool enabled;
+		int interval_ms;
+		struct wl_event_source *timer;
+		bool timer_armed;
+		bool has_motion, has_motion_absolute;
+		struct wlr_event_pointer_motion motion;
+		struct wlr_event_pointer_motion_absolute motion_absolute;
+	} coalesce;
+
+	void *data;
+};
+
+/**
+ * Makes the pointer accumulate motion events instead of emitting each one.
+ * Relative deltas are summed up and the last absolute position is kept. The
+ * result is emitted as a single event by wlr_pointer_flush_motion, e.g. from
+ * an output's frame handler, and every interval_ms milliseconds on loop if
+ * interval_ms is positive. Button and axis events flush the motion before
+ * them, so the event order is kept. Disabling it flushes the pending motion.
+ */
+void wlr_pointer_set_motion_coalescing(struct wlr_pointer *pointer,
+		bool enabled, struct wl_event_loop *loop, int interval_ms);
+/**
+ * Emits the motion accumulated since the last flush, if any.
+ */
+void wlr_pointer_flush_motion(struct wlr_pointer *pointer);
+
 #endif
@@ -0,0 +1,50 @@
+#ifndef _WLR_TYPES_WLR_PRESENTATION_H
+#define _WLR_TYPES_WLR_PRESENTATION_H
+#include <wayland-server.h>
+#include <stdbool.h>
+
+struct wlr_surface;
+struct wlr_output;
+
+struct wlr_presentation {
+	struct wl_global *wl_global;
+	struct wl_list wl_resources;
+	struct wl_list feedbacks; // wlr_presentation_feedback::link
+
+	void *data;
+};
+
+struct wlr_presentation_feedback {
+	struct wl_resource *resource;
+	struct wlr_presentation *presentation;
+	struct wlr_surface *surface;
+	struct wl_list link;
+
+	// Set once the surface state this feedback belongs to is committed
+	bool committed;
+	// Set once that state has been sampled for an output
+	struct wlr_output *output;
+
+	struct wl_listener surface_commit;
+	struct wl_listener surface_destroy;
+	struct wl_listener output_present;
+	struct wl_listener output_destroy;
+};
+
+/**
+ * Creates the wp_presentation global. Timestamps are reported in
+ * CLOCK_MONOTONIC, which is what wlr_output present events carry.
+ */
+struct wlr_presentation *wlr_presentation_create(struct wl_display *display);
+void wlr_presentation_destroy(struct wlr_presentation *presentation);
+
+/**
+ * Tells the presentation interface that the current state of the surface has
+ * been rendered for the next frame of the output. Committed feedback for the
+ * surface is sent once the output emits its present event. Call this while
+ * rendering the surface.
+ */
+void wlr_presentation_surface_sampled(struct wlr_presentation *presentation,
+		struct wlr_surface *surface, struct wlr_output *output);
+
+#endif
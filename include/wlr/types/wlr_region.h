@@ -1,7 +1,11 @@
 #ifndef _WLR_TYPES_REGION_H
 #define _WLR_TYPES_REGION_H
+#include <stdint.h>
+#include <pixman.h>
+#include <wayland-server-protocol.h>
 
 struct wl_resource;
+struct wl_client;
 
 /*
  * Implements the given resource as region.
@@ -10,4 +14,37 @@ struct wl_resource;
 void wlr_region_create(struct wl_client *client, struct wl_resource *res,
 		uint32_t id);
 
+/*
+ * Maps src, a region of a width x height surface, to the coordinates of its
+ * buffer for the buffer transform set with wl_surface.set_buffer_transform.
+ * dst may be src.
+ */
+void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
+		enum wl_output_transform transform, int32_t width, int32_t height);
+
+/*
+ * Tuning for wlr_region_coalesce. Merging two rectangles into their bounding
+ * box pays off when the bytes transferred in excess cost less than the fixed
+ * overhead of one more transfer.
+ */
+struct wlr_region_coalesce_params {
+	// Overhead of one transfer call, expressed in bytes of transfer
+	uint32_t call_cost;
+	// Hard limit on the number of boxes produced
+	int max_boxes;
+};
+
+#define WLR_REGION_COALESCE_CALL_COST (16 * 1024)
+#define WLR_REGION_COALESCE_MAX_BOXES 16
+
+/*
+ * Approximates region with at most params->max_boxes boxes, which together
+ * cover the whole region and may cover extra pixels. bpp is the number of
+ * bytes per pixel. Writes the boxes to boxes, which must have room for
+ * params->max_boxes entries, and returns how many were written.
+ */
+int wlr_region_coalesce(pixman_region32_t *region,
+		const struct wlr_region_coalesce_params *params, uint32_t bpp,
+		pixman_box32_t *boxes);
+
 #endif
@@ -0,0 +1,212 @@
+#ifndef _WLR_TYPES_WLR_SCENE_H
+#define _WLR_TYPES_WLR_SCENE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <pixman.h>
+#include <wayland-server.h>
+
+struct wlr_output;
+struct wlr_renderer;
+struct wlr_surface;
+struct wlr_texture;
+
+// Leaf nodes are indexed in a grid of square cells this many pixels wide
+#define WLR_SCENE_CELL_SIZE 256
+// Number of hash buckets the grid cells are spread over, a power of two
+#define WLR_SCENE_GRID_BUCKETS 256
+// Nodes covering more cells are kept in a separate list instead
+#define WLR_SCENE_MAX_NODE_CELLS 64
+
+enum wlr_scene_node_type {
+	WLR_SCENE_NODE_ROOT,
+	WLR_SCENE_NODE_TREE,
+	WLR_SCENE_NODE_SURFACE,
+	WLR_SCENE_NODE_RECT,
+	WLR_SCENE_NODE_BUFFER,
+};
+
+struct wlr_scene_cell_ref {
+	struct wlr_scene_node *node;
+	int32_t cx, cy;
+	struct wl_list link; // wlr_scene::buckets
+};
+
+struct wlr_scene_node {
+	enum wlr_scene_node_type type;
+	struct wlr_scene_node *parent;
+	struct wl_list link; // wlr_scene_node::children
+	struct wl_list children; // wlr_scene_node::link, bottom to top
+
+	bool enabled;
+	int32_t x, y; // relative to the parent
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+
+	// Spatial index of leaf nodes, only set while the node and all of its
+	// ancestors are enabled
+	bool indexed;
+	pixman_box32_t box; // in scene coordinates
+	struct wlr_scene_cell_ref *cells;
+	int n_cells;
+	struct wl_list large_link; // wlr_scene::large
+
+	uint32_t order; // stacking order, higher is on top
+	uint32_t visit; // last visible list the node was added to
+};
+
+struct wlr_scene {
+	struct wlr_scene_node node;
+	struct wlr_renderer *renderer;
+	struct wl_list outputs; // wlr_scene_output::link
+
+	struct wl_list buckets[WLR_SCENE_GRID_BUCKETS]; // wlr_scene_cell_ref::link
+	struct wl_list large; // wlr_scene_node::large_link
+
+	bool order_dirty;
+	uint32_t visit;
+	// Bumped whenever the set or stacking of indexed nodes changes
+	uint32_t generation;
+};
+
+struct wlr_scene_tree {
+	struct wlr_scene_node node;
+};
+
+struct wlr_scene_surface {
+	struct wlr_scene_node node;
+	struct wlr_surface *surface;
+
+	struct wl_listener surface_commit;
+	struct wl_listener surface_destroy;
+};
+
+struct wlr_scene_rect {
+	struct wlr_scene_node node;
+	int32_t width, height;
+	float color[4];
+};
+
+struct wlr_scene_buffer {
+	struct wlr_scene_node node;
+	struct wlr_texture *texture; // not owned
+};
+
+struct wlr_scene_output {
+	struct wlr_output *output;
+	struct wlr_scene *scene;
+	struct wl_list link; // wlr_scene::outputs
+	int32_t x, y; // in scene coordinates
+
+	// What changed since the last render, in output coordinates
+	pixman_region32_t damage;
+
+	// Indexed nodes intersecting the output, bottom to top
+	struct wl_array visible; // struct wlr_scene_node *
+	uint32_t generation;
+
+	struct wl_listener output_destroy;
+	struct wl_listener output_resolution;
+};
+
+/**
+ * Creates a scene, the root node of a tree of nodes rendered with renderer.
+ * Destroy it with wlr_scene_node_destroy.
+ */
+struct wlr_scene *wlr_scene_create(struct wlr_renderer *renderer);
+
+/**
+ * Creates a node that only groups its children, e.g. the windows of a
+ * workspace.
+ */
+struct wlr_scene_tree *wlr_scene_tree_create(struct wlr_scene_node *parent);
+/**
+ * Creates a node showing a wlr_surface. The node is destroyed along with the
+ * surface.
+ */
+struct wlr_scene_surface *wlr_scene_surface_create(
+		struct wlr_scene_node *parent, struct wlr_surface *surface);
+/**
+ * Creates a tree with a surface node for the surface and each of its
+ * subsurfaces, kept in sync with the subsurface positions and stacking.
+ */
+struct wlr_scene_tree *wlr_scene_subsurface_tree_create(
+		struct wlr_scene_node *parent, struct wlr_surface *surface);
+struct wlr_scene_rect *wlr_scene_rect_create(struct wlr_scene_node *parent,
+		int32_t width, int32_t height, const float color[static 4]);
+void wlr_scene_rect_set_size(struct wlr_scene_rect *rect,
+		int32_t width, int32_t height);
+void wlr_scene_rect_set_color(struct wlr_scene_rect *rect,
+		const float color[static 4]);
+/**
+ * Creates a node showing a texture at its size. The texture must outlive the
+ * node.
+ */
+struct wlr_scene_buffer *wlr_scene_buffer_create(struct wlr_scene_node *parent,
+		struct wlr_texture *texture);
+
+/**
+ * Destroys the node and all of its children.
+ */
+void wlr_scene_node_destroy(struct wlr_scene_node *node);
+void wlr_scene_node_set_enabled(struct wlr_scene_node *node, bool enabled);
+void wlr_scene_node_set_position(struct wlr_scene_node *node,
+		int32_t x, int32_t y);
+/**
+ * Moves the node right above or below a sibling.
+ */
+void wlr_scene_node_place_above(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling);
+void wlr_scene_node_place_below(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling);
+void wlr_scene_node_raise_to_top(struct wlr_scene_node *node);
+void wlr_scene_node_lower_to_bottom(struct wlr_scene_node *node);
+/**
+ * Moves the node to the top of another parent's children.
+ */
+void wlr_scene_node_reparent(struct wlr_scene_node *node,
+		struct wlr_scene_node *new_parent);
+
+/**
+ * Finds the topmost node at the given scene coordinates and stores the
+ * coordinates relative to it in nx and ny. Surfaces only accept points inside
+ * their input region. Only the grid cell containing the point is looked at.
+ */
+struct wlr_scene_node *wlr_scene_node_at(struct wlr_scene *scene,
+		double lx, double ly, double *nx, double *ny);
+
+struct wlr_scene_surface *wlr_scene_surface_from_node(
+		struct wlr_scene_node *node);
+
+/**
+ * Adds an output to the scene. The output shows the part of the scene at its
+ * position, and is removed when the wlr_output is destroyed.
+ */
+struct wlr_scene_output *wlr_scene_output_create(struct wlr_scene *scene,
+		struct wlr_output *output);
+void wlr_scene_output_destroy(struct wlr_scene_output *scene_output);
+void wlr_scene_output_set_position(struct wlr_scene_output *scene_output,
+		int32_t x, int32_t y);
+/**
+ * Renders the nodes visible on the output, bottom to top, and completes the
+ * frame callbacks of the surfaces among them. Nodes entirely hidden behind
+ * opaque ones are skipped and their surfaces get no frame callbacks. Call
+ * between wlr_renderer_begin and wlr_renderer_end.
+ */
+void wlr_scene_output_render(struct wlr_scene_output *scene_output,
+		const struct timespec *now);
+/**
+ * Calls iterator for each surface node on the output during the last
+ * wlr_scene_output_render, hidden or not, bottom to top, with output
+ * coordinates.
+ */
+void wlr_scene_output_for_each_surface(struct wlr_scene_output *scene_output,
+		void (*iterator)(struct wlr_surface *surface, int sx, int sy,
+			void *data),
+		void *data);
+
+#endif
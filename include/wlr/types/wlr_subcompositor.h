@@ -0,0 +1,19 @@
+#ifndef _WLR_TYPES_WLR_SUBCOMPOSITOR_H
+#define _WLR_TYPES_WLR_SUBCOMPOSITOR_H
+#include <wayland-server.h>
+
+struct wlr_subcompositor {
+	struct wl_global *wl_global;
+	struct wl_list wl_resources;
+
+	void *data;
+};
+
+/**
+ * Creates the wl_subcompositor global. Subsurfaces are tracked on their
+ * wlr_surface, see wlr_surface::subsurfaces_below and subsurfaces_above.
+ */
+struct wlr_subcompositor *wlr_subcompositor_create(struct wl_display *display);
+void wlr_subcompositor_destroy(struct wlr_subcompositor *subcompositor);
+
+#endif
@@ -3,12 +3,18 @@
 #include <wayland-server.h>
 #include <pixman.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <wlr/types/wlr_region.h>
 
 struct wlr_frame_callback {
 	struct wl_resource *resource;
 	struct wl_list link;
 };
 
+// Default wlr_surface::hidden_frame_interval, in milliseconds
+#define WLR_SURFACE_HIDDEN_FRAME_INTERVAL 1000
+
 #define WLR_SURFACE_INVALID_BUFFER 1
 #define WLR_SURFACE_INVALID_SURFACE_DAMAGE 2
 #define WLR_SURFACE_INVALID_BUFFER_DAMAGE 4
@@ -16,6 +22,7 @@ struct wlr_frame_callback {
 #define WLR_SURFACE_INVALID_INPUT_REGION 16
 #define WLR_SURFACE_INVALID_TRANSFORM 32
 #define WLR_SURFACE_INVALID_SCALE 64
+#define WLR_SURFACE_INVALID_VIEWPORT 128
 
 struct wlr_surface_state {
 	uint32_t invalid;
@@ -25,6 +32,62 @@ struct wlr_surface_state {
 	pixman_region32_t opaque, input;
 	uint32_t transform;
 	int32_t scale;
+
+	int32_t buffer_width, buffer_height;
+	int32_t width, height; // in surface coordinates
+
+	// wp_viewport: the part of the buffer that is shown, in buffer
+	// coordinates after transform and scale, and the size it's scaled to
+	struct {
+		bool has_src, has_dst;
+		float src_x, src_y, src_width, src_height;
+		int32_t dst_width, dst_height;
+	} viewport;
+
+	// Explicit synchronization: a sync_file the client signals once the
+	// buffer is ready, or -1, and the zwp_linux_buffer_release_v1 to send
+	// once it can be reused
+	int acquire_fence;
+	struct wl_resource *buffer_release;
+
+	struct wl_list frame_callback_list; // wlr_frame_callback::link
+
+	// Committed states that can't be applied yet
+	struct wl_list link; // wlr_surface::state_queue
+	bool synchronized; // waits for the parent of a synchronized subsurface
+};
+
+struct wlr_subsurface_state {
+	int32_t x, y; // relative to the parent surface
+};
+
+struct wlr_subsurface {
+	struct wl_resource *resource;
+	struct wlr_surface *surface;
+	struct wlr_surface *parent; // NULL once the parent is destroyed
+
+	struct wlr_subsurface_state current, pending;
+
+	// Commits of synchronized subsurfaces wait in the surface's state queue
+	// until the parent commits
+	bool synchronized;
+
+	struct wl_list parent_link; // wlr_surface::subsurfaces_below/above
+	struct wl_list parent_pending_link;
+
+	struct {
+		struct wl_signal destroy;
+	} signals;
+
+	struct wl_listener surface_destroy;
+	struct wl_listener parent_destroy;
+};
+
+struct wlr_surface_precommit_event {
+	struct wlr_surface *surface;
+	// Set by listeners that posted a protocol error about the pending
+	// state, which is then dropped instead of committed
+	bool rejected;
 };
 
 struct wlr_surface {
@@ -32,16 +95,55 @@ struct wlr_surface {
 	struct wlr_renderer *renderer;
 	struct wlr_texture *texture;
 	struct wlr_surface_state current, pending;
+	// Committed states waiting to be applied, oldest first. A state waits
+	// for its acquire fence or the parent of a synchronized subsurface, and
+	// holds back the ones committed after it.
+	struct wl_list state_queue; // wlr_surface_state::link
 	const char *role; // the lifetime-bound role or null
+	struct wlr_subsurface *subsurface; // set while the surface is a subsurface
 
+	// Child subsurfaces stacked below and above this surface, bottom to top
+	struct wl_list subsurfaces_below; // wlr_subsurface::parent_link
+	struct wl_list subsurfaces_above;
+	// Stacking order applied on the next commit
+	struct wl_list subsurfaces_pending_below; // wlr_subsurface::parent_pending_link
+	struct wl_list subsurfaces_pending_above;
+
+	// Map between buffer pixels and surface coordinates, taking the buffer
+	// transform, scale and viewport into account
 	float buffer_to_surface_matrix[16];
 	float surface_to_buffer_matrix[16];
+	// Maps the unit square onto the part of the texture that is shown, in
+	// normalized texture coordinates
+	float texcoord_matrix[16];
+
+	// How damage is merged into boxes before uploading it. max_boxes is
+	// clamped to 1..WLR_REGION_COALESCE_MAX_BOXES.
+	struct wlr_region_coalesce_params upload_coalesce;
+
+	// Waits for the acquire fence of the first queued state
+	struct wl_event_source *acquire_source;
+	// Release for the buffer the texture samples from
+	struct wl_resource *texture_release;
+	// GPU buffer the texture samples from, released once it moves on
+	struct wl_resource *texture_buffer;
+	struct wl_listener texture_buffer_destroy;
 
 	struct {
+		struct wl_signal precommit; // struct wlr_surface_precommit_event
 		struct wl_signal commit;
+		struct wl_signal new_subsurface; // struct wlr_subsurface *
+		struct wl_signal destroy;
 	} signals;
 
-	struct wl_list frame_callback_list; // wl_surface.frame
+	struct wl_list frame_callback_list; // committed wl_surface.frame
+
+	// Callbacks of surfaces that aren't presented anywhere are completed
+	// after this many milliseconds, so hidden clients still make progress
+	// without rendering at the output refresh rate
+	int hidden_frame_interval;
+	struct wl_event_source *frame_timer;
+	bool frame_timer_armed;
 
 	struct wl_listener compositor_listener; // destroy listener used by compositor
 	void *compositor_data;
@@ -54,4 +156,28 @@ struct wlr_surface *wlr_surface_create(struct wl_resource *res,
 		struct wlr_renderer *renderer);
 void wlr_surface_flush_damage(struct wlr_surface *surface);
 
+/**
+ * Completes the pending frame callbacks of a surface that has been presented
+ * on an output. Compositors call this for visible surfaces only, others are
+ * throttled to hidden_frame_interval.
+ */
+void wlr_surface_send_frame_done(struct wlr_surface *surface,
+		const struct timespec *when);
+
+/**
+ * Like wlr_texture_get_matrix, but scales to the surface size instead of the
+ * texture size. Render the surface with wlr_render_with_texcoord_matrix and
+ * texcoord_matrix so the transform, scale and viewport are applied while
+ * sampling.
+ */
+void wlr_surface_get_matrix(struct wlr_surface *surface,
+		float (*matrix)[16], const float (*projection)[16], int x, int y);
+
+/**
+ * Gives the surface the wl_subsurface role with the given parent and creates
+ * the wl_subsurface resource with the given id.
+ */
+struct wlr_subsurface *wlr_surface_make_subsurface(struct wlr_surface *surface,
+		struct wlr_surface *parent, uint32_t id);
+
 #endif
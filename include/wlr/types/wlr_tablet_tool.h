@@ -2,23 +2,11 @@
 #define _WLR_TYPES_TABLET_TOOL_H
 #include <wlr/types/wlr_input_device.h>
 #include <wayland-server.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 struct wlr_tablet_tool_impl;
 
-struct wlr_tablet_tool {
-	struct wlr_tablet_tool_impl *impl;
-
-	struct {
-		struct wl_signal axis;
-		struct wl_signal proximity;
-		struct wl_signal tip;
-		struct wl_signal button;
-	} events;
-
-	void *data;
-};
-
 enum wlr_tablet_tool_axes {
 	WLR_TABLET_TOOL_AXIS_X = 1,
 	WLR_TABLET_TOOL_AXIS_Y = 2,
@@ -78,4 +66,48 @@ struct wlr_event_tablet_tool_button {
 	enum wlr_button_state state;
 };
 
+struct wlr_tablet_tool {
+	struct wlr_tablet_tool_impl *impl;
+
+	struct {
+		struct wl_signal axis;
+		// Every axis update of the device, even while axis is coalesced
+		struct wl_signal axis_sample;
+		struct wl_signal proximity;
+		struct wl_signal tip;
+		struct wl_signal button;
+	} events;
+
+	// Axis updates held back until the next flush, see
+	// wlr_tablet_tool_set_axis_coalescing
+	struct {
+		bool enabled;
+		int interval_ms;
+		struct wl_event_source *timer;
+		bool timer_armed;
+		bool has_axis;
+		struct wlr_event_tablet_tool_axis axis;
+	} coalesce;
+
+	void *data;
+};
+
+/**
+ * Makes the tool accumulate axis events instead of emitting each one on the
+ * axis signal. The latest value of each axis is kept and wheel deltas are
+ * summed up. The result is emitted as a single event by
+ * wlr_tablet_tool_flush_axis, e.g. from an output's frame handler, and every
+ * interval_ms milliseconds on loop if interval_ms is positive. Proximity, tip
+ * and button events flush the axes before them, so the event order is kept.
+ *
+ * The axis_sample signal still gets every update, for clients that want the
+ * full rate of the device, e.g. drawing applications.
+ */
+void wlr_tablet_tool_set_axis_coalescing(struct wlr_tablet_tool *tool,
+		bool enabled, struct wl_event_loop *loop, int interval_ms);
+/**
+ * Emits the axis updates accumulated since the last flush, if any.
+ */
+void wlr_tablet_tool_flush_axis(struct wlr_tablet_tool *tool);
+
 #endif
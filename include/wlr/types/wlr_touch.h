@@ -1,10 +1,26 @@
 #ifndef _WLR_TYPES_TOUCH_H
 #define _WLR_TYPES_TOUCH_H
 #include <wayland-server.h>
+#include <stddef.h>
 #include <stdint.h>
 
 struct wlr_touch_impl;
 
+// Points changed in a frame beyond this are sent in an extra frame
+#define WLR_TOUCH_FRAME_MAX_POINTS 32
+
+enum wlr_touch_point_state {
+	WLR_TOUCH_POINT_DOWN,
+	WLR_TOUCH_POINT_MOTION,
+	WLR_TOUCH_POINT_UP,
+};
+
+struct wlr_touch_point {
+	int32_t slot;
+	enum wlr_touch_point_state state;
+	double x_mm, y_mm; // unset for WLR_TOUCH_POINT_UP
+};
+
 struct wlr_touch {
 	struct wlr_touch_impl *impl;
 
@@ -13,8 +29,16 @@ struct wlr_touch {
 		struct wl_signal up;
 		struct wl_signal motion;
 		struct wl_signal cancel;
+		struct wl_signal frame;
 	} events;
 
+	// Points changed since the last frame
+	struct {
+		struct wlr_touch_point points[WLR_TOUCH_FRAME_MAX_POINTS];
+		size_t n_points;
+		double width_mm, height_mm;
+	} pending;
+
 	void *data;
 };
 
@@ -46,4 +70,20 @@ struct wlr_event_touch_cancel {
 	int32_t slot;
 };
 
+/**
+ * Sent once the device has reported all the points that changed at the same
+ * time. Compositors can use it to send one wl_touch frame for them, or listen
+ * to it alone instead of the per-point signals.
+ */
+struct wlr_event_touch_frame {
+	uint32_t time_sec;
+	uint64_t time_usec;
+	double width_mm, height_mm;
+	// Points changed since the previous frame, in the order they were
+	// reported. A point moving after going down in the same frame is merged
+	// into its down.
+	size_t n_points;
+	struct wlr_touch_point *points;
+};
+
 #endif
@@ -0,0 +1,30 @@
+#ifndef _WLR_TYPES_WLR_VIEWPORTER_H
+#define _WLR_TYPES_WLR_VIEWPORTER_H
+#include <wayland-server.h>
+
+struct wlr_surface;
+
+struct wlr_viewporter {
+	struct wl_global *wl_global;
+	struct wl_list wl_resources;
+
+	void *data;
+};
+
+struct wlr_viewport {
+	struct wl_resource *resource;
+	struct wlr_surface *surface;
+
+	struct wl_listener surface_destroy;
+	struct wl_listener surface_precommit;
+};
+
+/**
+ * Creates the wp_viewporter global. Viewports end up in
+ * wlr_surface_state::viewport; the surface size and matrices account for
+ * them, so the renderer crops and scales while sampling the buffer.
+ */
+struct wlr_viewporter *wlr_viewporter_create(struct wl_display *display);
+void wlr_viewporter_destroy(struct wlr_viewporter *viewporter);
+
+#endif
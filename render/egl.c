@@ -1,14 +1,20 @@
+#include <assert.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 #include <gbm.h> // GBM_FORMAT_XRGB8888
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/util/log.h>
 #include <wlr/egl.h>
+#include <wlr/types/wlr_linux_dmabuf.h>
 
 // Extension documentation
 // https://www.khronos.org/registry/EGL/extensions/KHR/EGL_KHR_image_base.txt.
 // https://cgit.freedesktop.org/mesa/mesa/tree/docs/specs/WL_bind_wayland_display.spec
+// https://www.khronos.org/registry/EGL/extensions/EXT/EGL_EXT_image_dma_buf_import.txt
+// https://www.khronos.org/registry/EGL/extensions/EXT/EGL_EXT_image_dma_buf_import_modifiers.txt
+// https://www.khronos.org/registry/EGL/extensions/ANDROID/EGL_ANDROID_native_fence_sync.txt
 
 const char *egl_error(void) {
 	switch (eglGetError()) {
@@ -71,6 +77,21 @@ static bool egl_exts(struct wlr_egl *egl) {
 static bool egl_get_config(EGLDisplay disp, EGLConfig *out, EGLenum platform) {
 	EGLint count = 0, matched = 0, ret;
 
+	// Surfaceless displays can only render offscreen
+	static const EGLint pbuffer_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE,
+	};
+	const EGLint *attribs = NULL;
+	if (platform == EGL_PLATFORM_SURFACELESS_MESA) {
+		attribs = pbuffer_attribs;
+	}
+
 	ret = eglGetConfigs(disp, NULL, 0, &count);
 	if (ret == EGL_FALSE || count == 0) {
 		wlr_log(L_ERROR, "eglGetConfigs returned no configs");
@@ -79,7 +100,7 @@ static bool egl_get_config(EGLDisplay disp, EGLConfig *out, EGLenum platform) {
 
 	EGLConfig configs[count];
 
-	ret = eglChooseConfig(disp, NULL, configs, count, &matched);
+	ret = eglChooseConfig(disp, attribs, configs, count, &matched);
 	if (ret == EGL_FALSE) {
 		wlr_log(L_ERROR, "eglChooseConfig failed");
 		return false;
@@ -88,7 +109,8 @@ static bool egl_get_config(EGLDisplay disp, EGLConfig *out, EGLenum platform) {
 	for (int i = 0; i < matched; ++i) {
 		EGLint gbm_format;
 
-		if (platform == EGL_PLATFORM_WAYLAND_EXT) {
+		if (platform == EGL_PLATFORM_WAYLAND_EXT ||
+				platform == EGL_PLATFORM_SURFACELESS_MESA) {
 			*out = configs[i];
 			return true;
 		}
@@ -150,8 +172,7 @@ bool wlr_egl_init(struct wlr_egl *egl, EGLenum platform,
 
 	eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl->context);
 	egl->egl_exts = eglQueryString(egl->display, EGL_EXTENSIONS);
-	if (strstr(egl->egl_exts, "EGL_WL_bind_wayland_display") == NULL ||
-		strstr(egl->egl_exts, "EGL_KHR_image_base") == NULL) {
+	if (strstr(egl->egl_exts, "EGL_KHR_image_base") == NULL) {
 		wlr_log(L_ERROR, "Required egl extensions not supported");
 		goto error;
 	}
@@ -160,12 +181,42 @@ bool wlr_egl_init(struct wlr_egl *egl, EGLenum platform,
 		eglGetProcAddress("eglCreateImageKHR");
 	egl->eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC)
 		eglGetProcAddress("eglDestroyImageKHR");
-	egl->eglQueryWaylandBufferWL = (PFNEGLQUERYWAYLANDBUFFERWL)
-		(void*) eglGetProcAddress("eglQueryWaylandBufferWL");
-	egl->eglBindWaylandDisplayWL = (PFNEGLBINDWAYLANDDISPLAYWL)
-		(void*) eglGetProcAddress("eglBindWaylandDisplayWL");
-	egl->eglUnbindWaylandDisplayWL = (PFNEGLUNBINDWAYLANDDISPLAYWL)
-		(void*) eglGetProcAddress("eglUnbindWaylandDisplayWL");
+
+	// Software rasterizers (e.g. llvmpipe on a surfaceless display) can't
+	// share buffers with clients, but are fine for everything else
+	if (strstr(egl->egl_exts, "EGL_WL_bind_wayland_display")) {
+		egl->eglQueryWaylandBufferWL = (PFNEGLQUERYWAYLANDBUFFERWL)
+			(void*) eglGetProcAddress("eglQueryWaylandBufferWL");
+		egl->eglBindWaylandDisplayWL = (PFNEGLBINDWAYLANDDISPLAYWL)
+			(void*) eglGetProcAddress("eglBindWaylandDisplayWL");
+		egl->eglUnbindWaylandDisplayWL = (PFNEGLUNBINDWAYLANDDISPLAYWL)
+			(void*) eglGetProcAddress("eglUnbindWaylandDisplayWL");
+	} else {
+		wlr_log(L_INFO, "EGL_WL_bind_wayland_display not supported, "
+			"clients will be limited to shm buffers");
+	}
+
+	egl->exts.dmabuf_import =
+		strstr(egl->egl_exts, "EGL_EXT_image_dma_buf_import") != NULL;
+	if (strstr(egl->egl_exts, "EGL_EXT_image_dma_buf_import_modifiers")) {
+		egl->eglQueryDmaBufFormatsEXT = (PFNEGLQUERYDMABUFFORMATSEXTPROC)
+			eglGetProcAddress("eglQueryDmaBufFormatsEXT");
+		egl->eglQueryDmaBufModifiersEXT = (PFNEGLQUERYDMABUFMODIFIERSEXTPROC)
+			eglGetProcAddress("eglQueryDmaBufModifiersEXT");
+		egl->exts.dmabuf_import_modifiers = egl->eglQueryDmaBufFormatsEXT &&
+			egl->eglQueryDmaBufModifiersEXT;
+	}
+
+	if (strstr(egl->egl_exts, "EGL_ANDROID_native_fence_sync")) {
+		egl->eglCreateSyncKHR = (PFNEGLCREATESYNCKHRPROC)
+			eglGetProcAddress("eglCreateSyncKHR");
+		egl->eglDestroySyncKHR = (PFNEGLDESTROYSYNCKHRPROC)
+			eglGetProcAddress("eglDestroySyncKHR");
+		egl->eglDupNativeFenceFDANDROID = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC)
+			eglGetProcAddress("eglDupNativeFenceFDANDROID");
+		egl->exts.native_fence_sync = egl->eglCreateSyncKHR &&
+			egl->eglDestroySyncKHR && egl->eglDupNativeFenceFDANDROID;
+	}
 
 	egl->gl_exts = (const char*) glGetString(GL_EXTENSIONS);
 	wlr_log(L_INFO, "Using EGL %d.%d", (int)major, (int)minor);
@@ -223,6 +274,191 @@ EGLImage wlr_egl_create_image(struct wlr_egl *egl, EGLenum target,
 		buffer, attribs);
 }
 
+EGLImageKHR wlr_egl_create_image_from_dmabuf(struct wlr_egl *egl,
+		struct wlr_dmabuf_buffer_attribs *attributes) {
+	if (!egl->exts.dmabuf_import) {
+		wlr_log(L_ERROR, "dmabuf import extension not present");
+		return NULL;
+	}
+
+	bool has_modifier = false;
+	if (attributes->modifier[0] != DRM_FORMAT_MOD_INVALID) {
+		if (!egl->exts.dmabuf_import_modifiers) {
+			return NULL;
+		}
+		has_modifier = true;
+	}
+
+	unsigned int atti = 0;
+	EGLint attribs[50];
+	attribs[atti++] = EGL_WIDTH;
+	attribs[atti++] = attributes->width;
+	attribs[atti++] = EGL_HEIGHT;
+	attribs[atti++] = attributes->height;
+	attribs[atti++] = EGL_LINUX_DRM_FOURCC_EXT;
+	attribs[atti++] = attributes->format;
+
+	struct {
+		EGLint fd;
+		EGLint offset;
+		EGLint pitch;
+		EGLint mod_lo;
+		EGLint mod_hi;
+	} attr_names[WLR_LINUX_DMABUF_MAX_PLANES] = {
+		{
+			EGL_DMA_BUF_PLANE0_FD_EXT,
+			EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+			EGL_DMA_BUF_PLANE0_PITCH_EXT,
+			EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,
+			EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT
+		}, {
+			EGL_DMA_BUF_PLANE1_FD_EXT,
+			EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+			EGL_DMA_BUF_PLANE1_PITCH_EXT,
+			EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT,
+			EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT
+		}, {
+			EGL_DMA_BUF_PLANE2_FD_EXT,
+			EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+			EGL_DMA_BUF_PLANE2_PITCH_EXT,
+			EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT,
+			EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT
+		}, {
+			EGL_DMA_BUF_PLANE3_FD_EXT,
+			EGL_DMA_BUF_PLANE3_OFFSET_EXT,
+			EGL_DMA_BUF_PLANE3_PITCH_EXT,
+			EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT,
+			EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT
+		}
+	};
+
+	for (int i = 0; i < attributes->n_planes; i++) {
+		attribs[atti++] = attr_names[i].fd;
+		attribs[atti++] = attributes->fd[i];
+		attribs[atti++] = attr_names[i].offset;
+		attribs[atti++] = attributes->offset[i];
+		attribs[atti++] = attr_names[i].pitch;
+		attribs[atti++] = attributes->stride[i];
+		if (has_modifier) {
+			attribs[atti++] = attr_names[i].mod_lo;
+			attribs[atti++] = attributes->modifier[i] & 0xFFFFFFFF;
+			attribs[atti++] = attr_names[i].mod_hi;
+			attribs[atti++] = attributes->modifier[i] >> 32;
+		}
+	}
+	attribs[atti++] = EGL_IMAGE_PRESERVED_KHR;
+	attribs[atti++] = EGL_TRUE;
+	attribs[atti++] = EGL_NONE;
+	assert(atti < sizeof(attribs) / sizeof(attribs[0]));
+
+	// The image keeps its own reference to the dmabufs, the fds stay owned by
+	// the caller
+	return egl->eglCreateImageKHR(egl->display, EGL_NO_CONTEXT,
+		EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+}
+
+int wlr_egl_get_dmabuf_formats(struct wlr_egl *egl, int **formats) {
+	if (!egl->exts.dmabuf_import) {
+		wlr_log(L_INFO, "dmabuf import extension not present");
+		return -1;
+	}
+
+	// Without the modifiers extension egl can't list its formats, assume the
+	// usual ones work
+	if (!egl->exts.dmabuf_import_modifiers) {
+		static const int fallback_formats[] = {
+			GBM_FORMAT_ARGB8888,
+			GBM_FORMAT_XRGB8888,
+		};
+		int num = sizeof(fallback_formats) / sizeof(fallback_formats[0]);
+		*formats = calloc(num, sizeof(int));
+		if (!*formats) {
+			wlr_log_errno(L_ERROR, "Allocation failed");
+			return -1;
+		}
+		memcpy(*formats, fallback_formats, sizeof(fallback_formats));
+		return num;
+	}
+
+	EGLint num;
+	if (!egl->eglQueryDmaBufFormatsEXT(egl->display, 0, NULL, &num)) {
+		wlr_log(L_ERROR, "failed to query number of dmabuf formats");
+		return -1;
+	}
+
+	*formats = calloc(num, sizeof(int));
+	if (*formats == NULL) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return -1;
+	}
+
+	if (!egl->eglQueryDmaBufFormatsEXT(egl->display, num, *formats, &num)) {
+		wlr_log(L_ERROR, "failed to query dmabuf formats");
+		free(*formats);
+		return -1;
+	}
+	return num;
+}
+
+int wlr_egl_get_dmabuf_modifiers(struct wlr_egl *egl, int format,
+		uint64_t **modifiers) {
+	if (!egl->exts.dmabuf_import_modifiers) {
+		return 0;
+	}
+
+	EGLint num;
+	if (!egl->eglQueryDmaBufModifiersEXT(egl->display, format, 0,
+			NULL, NULL, &num)) {
+		wlr_log(L_ERROR, "failed to query dmabuf number of modifiers");
+		return -1;
+	}
+	if (num == 0) {
+		return 0;
+	}
+
+	*modifiers = calloc(num, sizeof(uint64_t));
+	if (*modifiers == NULL) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return -1;
+	}
+
+	if (!egl->eglQueryDmaBufModifiersEXT(egl->display, format, num,
+			(EGLuint64KHR *)*modifiers, NULL, &num)) {
+		wlr_log(L_ERROR, "failed to query dmabuf modifiers");
+		free(*modifiers);
+		return -1;
+	}
+	return num;
+}
+
+int wlr_egl_create_fence_fd(struct wlr_egl *egl) {
+	if (!egl->exts.native_fence_sync) {
+		return -1;
+	}
+
+	static const EGLint attribs[] = {
+		EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID,
+		EGL_NONE,
+	};
+	EGLSyncKHR sync = egl->eglCreateSyncKHR(egl->display,
+		EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+	if (sync == EGL_NO_SYNC_KHR) {
+		wlr_log(L_ERROR, "Failed to create EGL fence: %s", egl_error());
+		return -1;
+	}
+
+	// The fence only gets an fd once it has been submitted
+	glFlush();
+
+	int fd = egl->eglDupNativeFenceFDANDROID(egl->display, sync);
+	egl->eglDestroySyncKHR(egl->display, sync);
+	if (fd == EGL_NO_NATIVE_FENCE_FD_ANDROID) {
+		wlr_log(L_ERROR, "Failed to export EGL fence: %s", egl_error());
+		return -1;
+	}
+	return fd;
+}
+
 bool wlr_egl_destroy_image(struct wlr_egl *egl, EGLImage image) {
 	if (!egl->eglDestroyImageKHR) {
 		return false;
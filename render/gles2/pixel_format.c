@@ -35,6 +35,26 @@ struct pixel_format formats[] = {
 };
 // TODO: more pixel formats
 
+// The BGRA formats above, for when GL_BGRA_EXT can't be uploaded
+static struct pixel_format swizzled_formats[] = {
+	{
+		.wl_format = WL_SHM_FORMAT_ARGB8888,
+		.depth = 32,
+		.bpp = 32,
+		.gl_format = GL_RGBA,
+		.gl_type = GL_UNSIGNED_BYTE,
+		.shader = &shaders.bgra
+	},
+	{
+		.wl_format = WL_SHM_FORMAT_XRGB8888,
+		.depth = 24,
+		.bpp = 32,
+		.gl_format = GL_RGBA,
+		.gl_type = GL_UNSIGNED_BYTE,
+		.shader = &shaders.bgrx
+	},
+};
+
 const struct pixel_format *gl_format_for_wl_format(enum wl_shm_format fmt) {
 	for (size_t i = 0; i < sizeof(formats) / sizeof(*formats); ++i) {
 		if (formats[i].wl_format == fmt) {
@@ -43,3 +63,20 @@ const struct pixel_format *gl_format_for_wl_format(enum wl_shm_format fmt) {
 	}
 	return NULL;
 }
+
+/*
+ * Like gl_format_for_wl_format, but for uploading pixels of that format. Only
+ * differs when the BGRA extension is missing.
+ */
+const struct pixel_format *gl_upload_format_for_wl_format(
+		enum wl_shm_format fmt) {
+	if (!gles2_has_bgra) {
+		size_t n = sizeof(swizzled_formats) / sizeof(*swizzled_formats);
+		for (size_t i = 0; i < n; ++i) {
+			if (swizzled_formats[i].wl_format == fmt) {
+				return &swizzled_formats[i];
+			}
+		}
+	}
+	return gl_format_for_wl_format(fmt);
+}
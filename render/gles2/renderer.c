@@ -14,6 +14,7 @@
 #include "render/gles2.h"
 
 PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES = NULL;
+bool gles2_has_bgra = false;
 struct shaders shaders;
 
 static bool compile_shader(GLuint type, const GLchar *src, GLuint *shader) {
@@ -82,6 +83,14 @@ static void init_default_shaders() {
 	if (!compile_program(vertex_src, fragment_src_rgbx, &shaders.rgbx)) {
 		goto error;
 	}
+	if (!gles2_has_bgra) {
+		if (!compile_program(vertex_src, fragment_src_bgra, &shaders.bgra)) {
+			goto error;
+		}
+		if (!compile_program(vertex_src, fragment_src_bgrx, &shaders.bgrx)) {
+			goto error;
+		}
+	}
 	if (!compile_program(quad_vertex_src, quad_fragment_src, &shaders.quad)) {
 		goto error;
 	}
@@ -117,8 +126,18 @@ static void init_image_ext() {
 	}
 }
 
+static void init_bgra_ext() {
+	const char *exts = (const char*) glGetString(GL_EXTENSIONS);
+	gles2_has_bgra = strstr(exts, "GL_EXT_texture_format_BGRA8888");
+	if (!gles2_has_bgra) {
+		wlr_log(L_INFO, "GL_EXT_texture_format_BGRA8888 not supported, "
+			"swizzling BGRA textures in shaders");
+	}
+}
+
 static void init_globals() {
 	init_image_ext();
+	init_bgra_ext();
 	init_default_shaders();
 }
 
@@ -147,24 +166,18 @@ static struct wlr_texture *wlr_gles2_texture_init(
 		struct wlr_renderer *_renderer) {
 	struct wlr_gles2_renderer *renderer =
 		(struct wlr_gles2_renderer *)_renderer;
-	return gles2_texture_init(renderer->egl);
+	return gles2_texture_init(renderer);
 }
 
-static void draw_quad() {
-	GLfloat verts[] = {
-		1, 0, // top right
-		0, 0, // top left
-		1, 1, // bottom right
-		0, 1, // bottom left
-	};
-	GLfloat texcoord[] = {
-		1, 0, // top right
-		0, 0, // top left
-		1, 1, // bottom right
-		0, 1, // bottom left
-	};
+static const GLfloat quad_verts[] = {
+	1, 0, // top right
+	0, 0, // top left
+	1, 1, // bottom right
+	0, 1, // bottom left
+};
 
-	GL_CALL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, verts));
+static void draw_quad_texcoord(const GLfloat texcoord[static 8]) {
+	GL_CALL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, quad_verts));
 	GL_CALL(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, texcoord));
 
 	GL_CALL(glEnableVertexAttribArray(0));
@@ -176,6 +189,10 @@ static void draw_quad() {
 	GL_CALL(glDisableVertexAttribArray(1));
 }
 
+static void draw_quad() {
+	draw_quad_texcoord(quad_verts);
+}
+
 static bool wlr_gles2_render_texture(struct wlr_renderer *_renderer,
 		struct wlr_texture *texture, const float (*matrix)[16]) {
 	if (!texture || !texture->valid) {
@@ -191,6 +208,30 @@ static bool wlr_gles2_render_texture(struct wlr_renderer *_renderer,
 	return true;
 }
 
+static bool wlr_gles2_render_texture_texcoord(struct wlr_renderer *_renderer,
+		struct wlr_texture *texture, const float (*matrix)[16],
+		const float (*texcoord_matrix)[16]) {
+	if (!texture || !texture->valid) {
+		wlr_log(L_ERROR, "attempt to render invalid texture");
+		return false;
+	}
+
+	// Only four vertices, cheaper to transform here than in the shader
+	const float *m = *texcoord_matrix;
+	GLfloat texcoord[8];
+	for (int i = 0; i < 4; ++i) {
+		GLfloat x = quad_verts[2 * i], y = quad_verts[2 * i + 1];
+		texcoord[2 * i] = m[0] * x + m[1] * y + m[3];
+		texcoord[2 * i + 1] = m[4] * x + m[5] * y + m[7];
+	}
+
+	wlr_texture_bind(texture);
+	GL_CALL(glUniformMatrix4fv(0, 1, GL_FALSE, *matrix));
+	GL_CALL(glUniform1f(2, 1.0f));
+	draw_quad_texcoord(texcoord);
+	return true;
+}
+
 static void wlr_gles2_render_quad(struct wlr_renderer *renderer,
 		const float (*color)[4], const float (*matrix)[16]) {
 	GL_CALL(glUseProgram(shaders.quad));
@@ -228,15 +269,35 @@ static bool wlr_gles2_buffer_is_drm(struct wlr_renderer *_renderer,
 			EGL_TEXTURE_FORMAT, &format);
 }
 
+static int wlr_gles2_create_fence(struct wlr_renderer *_renderer) {
+	struct wlr_gles2_renderer *renderer =
+		(struct wlr_gles2_renderer *)_renderer;
+	if (!renderer->egl) {
+		return -1;
+	}
+	return wlr_egl_create_fence_fd(renderer->egl);
+}
+
+static void wlr_gles2_destroy(struct wlr_renderer *_renderer) {
+	struct wlr_gles2_renderer *renderer =
+		(struct wlr_gles2_renderer *)_renderer;
+	// Cached images stay around as long as their buffers otherwise
+	gles2_buffer_images_destroy(renderer);
+	free(renderer);
+}
+
 static struct wlr_renderer_impl wlr_renderer_impl = {
 	.begin = wlr_gles2_begin,
 	.end = wlr_gles2_end,
 	.texture_init = wlr_gles2_texture_init,
 	.render_with_matrix = wlr_gles2_render_texture,
+	.render_with_texcoord_matrix = wlr_gles2_render_texture_texcoord,
 	.render_quad = wlr_gles2_render_quad,
 	.render_ellipse = wlr_gles2_render_ellipse,
 	.formats = wlr_gles2_formats,
 	.buffer_is_drm = wlr_gles2_buffer_is_drm,
+	.create_fence = wlr_gles2_create_fence,
+	.destroy = wlr_gles2_destroy,
 };
 
 struct wlr_renderer *wlr_gles2_renderer_init(struct wlr_backend *backend) {
@@ -244,6 +305,7 @@ struct wlr_renderer *wlr_gles2_renderer_init(struct wlr_backend *backend) {
 	struct wlr_gles2_renderer *renderer =
 		calloc(1, sizeof(struct wlr_gles2_renderer));
 	wlr_renderer_init(&renderer->wlr_renderer, &wlr_renderer_impl);
+	wl_list_init(&renderer->buffer_images);
 	if (backend) {
 		struct wlr_egl *egl = wlr_backend_get_egl(backend);
 		renderer->egl = egl;
@@ -91,6 +91,27 @@ const GLchar fragment_src_rgbx[] =
 "   gl_FragColor.a = alpha;"
 "}";
 
+// For BGRA data uploaded as RGBA when GL_EXT_texture_format_BGRA8888 is
+// missing
+const GLchar fragment_src_bgra[] =
+"precision mediump float;"
+"varying vec2 v_texcoord;"
+"uniform sampler2D tex;"
+"uniform float alpha;"
+"void main() {"
+"	gl_FragColor = alpha * texture2D(tex, v_texcoord).bgra;"
+"}";
+
+const GLchar fragment_src_bgrx[] =
+"precision mediump float;"
+"varying vec2 v_texcoord;"
+"uniform sampler2D tex;"
+"uniform float alpha;"
+"void main() {"
+"   gl_FragColor.rgb = alpha * texture2D(tex, v_texcoord).bgr;"
+"   gl_FragColor.a = alpha;"
+"}";
+
 const GLchar fragment_src_external[] =
 "#extension GL_OES_EGL_image_external : require\n"
 "precision mediump float;"
@@ -3,12 +3,14 @@
 #include <assert.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <gbm.h>
 #include <wayland-util.h>
 #include <wayland-server-protocol.h>
 #include <wlr/egl.h>
 #include <wlr/render.h>
 #include <wlr/render/interface.h>
 #include <wlr/render/matrix.h>
+#include <wlr/types/wlr_linux_dmabuf.h>
 #include <wlr/util/log.h>
 #include "render/gles2.h"
 
@@ -22,21 +24,44 @@ static struct pixel_format external_pixel_format = {
 };
 
 static void gles2_texture_ensure_texture(struct wlr_gles2_texture *texture) {
-	if (texture->tex_id) {
+	if (texture->tex_id && texture->target == GL_TEXTURE_2D) {
 		return;
 	}
+	// A texture can't change its target once bound, start over
+	if (texture->tex_id) {
+		GL_CALL(glDeleteTextures(1, &texture->tex_id));
+	}
+	texture->target = GL_TEXTURE_2D;
 	GL_CALL(glGenTextures(1, &texture->tex_id));
 	GL_CALL(glBindTexture(GL_TEXTURE_2D, texture->tex_id));
 	GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
 	GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 }
 
+// Images are attached to the texture object, which has to be created for the
+// image's target
+static void gles2_texture_ensure_image_texture(struct wlr_gles2_texture *texture,
+		GLenum target) {
+	if (texture->tex_id && texture->target != target) {
+		GL_CALL(glDeleteTextures(1, &texture->tex_id));
+		texture->tex_id = 0;
+	}
+	if (!texture->tex_id) {
+		GL_CALL(glGenTextures(1, &texture->tex_id));
+	}
+	texture->target = target;
+	GL_CALL(glActiveTexture(GL_TEXTURE0));
+	GL_CALL(glBindTexture(target, texture->tex_id));
+	GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+}
+
 static bool gles2_texture_upload_pixels(struct wlr_texture *_texture,
 		enum wl_shm_format format, int stride, int width, int height,
 		const unsigned char *pixels) {
 	struct wlr_gles2_texture *texture = (struct wlr_gles2_texture *)_texture;
 	assert(texture);
-	const struct pixel_format *fmt = gl_format_for_wl_format(format);
+	const struct pixel_format *fmt = gl_upload_format_for_wl_format(format);
 	if (!fmt || !fmt->gl_format) {
 		wlr_log(L_ERROR, "No supported pixel format for this texture");
 		return false;
@@ -83,7 +108,7 @@ static bool gles2_texture_update_pixels(struct wlr_texture *_texture,
 static bool gles2_texture_upload_shm(struct wlr_texture *_texture,
 		uint32_t format, struct wl_shm_buffer *buffer) {
 	struct wlr_gles2_texture *texture = (struct wlr_gles2_texture *)_texture;
-	const struct pixel_format *fmt = gl_format_for_wl_format(format);
+	const struct pixel_format *fmt = gl_upload_format_for_wl_format(format);
 	if (!fmt || !fmt->gl_format) {
 		wlr_log(L_ERROR, "No supported pixel format for this texture");
 		return false;
@@ -142,27 +167,61 @@ static bool gles2_texture_update_shm(struct wlr_texture *_texture,
 	return true;
 }
 
-static bool gles2_texture_upload_drm(struct wlr_texture *_tex,
-		struct wl_resource *buf) {
-	struct wlr_gles2_texture *tex = (struct wlr_gles2_texture *)_tex;
-	if (!glEGLImageTargetTexture2DOES) {
-		return false;
+// EGLImages of wl_drm buffers, imported once and dropped with the buffer or
+// the renderer, whichever goes first. Clients usually cycle through two or
+// three buffers, so after the first few frames uploading a buffer only
+// rebinds its image.
+struct gles2_buffer_image {
+	struct wlr_gles2_renderer *renderer;
+	EGLImageKHR image;
+	GLenum target;
+	const struct pixel_format *pixel_format;
+	int width, height;
+	struct wl_listener buffer_destroy;
+	struct wl_list link; // wlr_gles2_renderer::buffer_images
+};
+
+static void gles2_buffer_image_destroy(struct gles2_buffer_image *cache) {
+	wl_list_remove(&cache->buffer_destroy.link);
+	wl_list_remove(&cache->link);
+	wlr_egl_destroy_image(cache->renderer->egl, cache->image);
+	free(cache);
+}
+
+void gles2_buffer_images_destroy(struct wlr_gles2_renderer *renderer) {
+	struct gles2_buffer_image *cache, *tmp;
+	wl_list_for_each_safe(cache, tmp, &renderer->buffer_images, link) {
+		gles2_buffer_image_destroy(cache);
+	}
+}
+
+static void handle_buffer_destroy(struct wl_listener *listener, void *data) {
+	struct gles2_buffer_image *cache =
+		wl_container_of(listener, cache, buffer_destroy);
+	gles2_buffer_image_destroy(cache);
+}
+
+static struct gles2_buffer_image *gles2_buffer_image_get(
+		struct wlr_gles2_renderer *renderer, struct wl_resource *buf) {
+	struct wlr_egl *egl = renderer->egl;
+	struct gles2_buffer_image *cache;
+	struct wl_listener *listener =
+		wl_resource_get_destroy_listener(buf, handle_buffer_destroy);
+	if (listener) {
+		cache = wl_container_of(listener, cache, buffer_destroy);
+		if (cache->renderer == renderer) {
+			return cache;
+		}
+		// Shown by another renderer now, which can't use this image
+		gles2_buffer_image_destroy(cache);
 	}
 
 	EGLint format;
-	if (!wlr_egl_query_buffer(tex->egl, buf, EGL_TEXTURE_FORMAT, &format)) {
+	if (!wlr_egl_query_buffer(egl, buf, EGL_TEXTURE_FORMAT, &format)) {
 		wlr_log(L_INFO, "upload_drm called with no drm buffer");
-		return false;
+		return NULL;
 	}
 
-	wlr_egl_query_buffer(tex->egl, buf, EGL_WIDTH,
-			(EGLint*)&tex->wlr_texture.width);
-	wlr_egl_query_buffer(tex->egl, buf, EGL_HEIGHT,
-			(EGLint*)&tex->wlr_texture.height);
-
-	EGLint inverted_y;
-	wlr_egl_query_buffer(tex->egl, buf, EGL_WAYLAND_Y_INVERTED_WL, &inverted_y);
-
 	GLenum target;
 	const struct pixel_format *pf;
 	switch (format) {
@@ -177,28 +236,99 @@ static bool gles2_texture_upload_drm(struct wlr_texture *_tex,
 		break;
 	default:
 		wlr_log(L_ERROR, "invalid/unsupported egl buffer format");
-		return false;
+		return NULL;
+	}
+
+	cache = calloc(1, sizeof(struct gles2_buffer_image));
+	if (!cache) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return NULL;
 	}
 
-	gles2_texture_ensure_texture(tex);
-	GL_CALL(glBindTexture(GL_TEXTURE_2D, tex->tex_id));
+	EGLint width, height;
+	wlr_egl_query_buffer(egl, buf, EGL_WIDTH, &width);
+	wlr_egl_query_buffer(egl, buf, EGL_HEIGHT, &height);
 
 	EGLint attribs[] = { EGL_WAYLAND_PLANE_WL, 0, EGL_NONE };
+	cache->image = wlr_egl_create_image(egl, EGL_WAYLAND_BUFFER_WL,
+		(EGLClientBuffer*) buf, attribs);
+	if (!cache->image) {
+		wlr_log(L_ERROR, "failed to create egl image: %s", egl_error());
+		free(cache);
+		return NULL;
+	}
+
+	cache->renderer = renderer;
+	cache->target = target;
+	cache->pixel_format = pf;
+	cache->width = width;
+	cache->height = height;
+	cache->buffer_destroy.notify = handle_buffer_destroy;
+	wl_resource_add_destroy_listener(buf, &cache->buffer_destroy);
+	wl_list_insert(&renderer->buffer_images, &cache->link);
+	return cache;
+}
+
+static bool gles2_texture_upload_drm(struct wlr_texture *_tex,
+		struct wl_resource *buf) {
+	struct wlr_gles2_texture *tex = (struct wlr_gles2_texture *)_tex;
+	if (!glEGLImageTargetTexture2DOES) {
+		return false;
+	}
 
-	if (tex->image) {
-		wlr_egl_destroy_image(tex->egl, tex->image);
+	struct gles2_buffer_image *cache = gles2_buffer_image_get(tex->renderer, buf);
+	if (!cache) {
+		return false;
 	}
 
-	tex->image = wlr_egl_create_image(tex->egl, EGL_WAYLAND_BUFFER_WL,
-		(EGLClientBuffer*) buf, attribs);
-	if (!tex->image) {
-		wlr_log(L_ERROR, "failed to create egl image: %s", egl_error());
- 		return false;
+	gles2_texture_ensure_image_texture(tex, cache->target);
+	GL_CALL(glEGLImageTargetTexture2DOES(cache->target, cache->image));
+	tex->wlr_texture.width = cache->width;
+	tex->wlr_texture.height = cache->height;
+	tex->wlr_texture.valid = true;
+	tex->pixel_format = cache->pixel_format;
+
+	return true;
+}
+
+static bool gles2_texture_upload_dmabuf(struct wlr_texture *_tex,
+		struct wl_resource *dmabuf_resource) {
+	struct wlr_gles2_texture *tex = (struct wlr_gles2_texture *)_tex;
+	if (!glEGLImageTargetTexture2DOES) {
+		return false;
 	}
 
-	GL_CALL(glActiveTexture(GL_TEXTURE0));
-	GL_CALL(glBindTexture(target, tex->tex_id));
-	GL_CALL(glEGLImageTargetTexture2DOES(target, tex->image));
+	struct wlr_dmabuf_buffer *dmabuf =
+		wlr_dmabuf_buffer_from_buffer_resource(dmabuf_resource);
+	if (!dmabuf->image) {
+		return false;
+	}
+
+	GLenum target;
+	const struct pixel_format *pf;
+	switch (dmabuf->attributes.format) {
+	// egl converts the channel order of RGB formats for us
+	case GBM_FORMAT_ARGB8888:
+	case GBM_FORMAT_ABGR8888:
+		target = GL_TEXTURE_2D;
+		pf = gl_format_for_wl_format(WL_SHM_FORMAT_ARGB8888);
+		break;
+	case GBM_FORMAT_XRGB8888:
+	case GBM_FORMAT_XBGR8888:
+		target = GL_TEXTURE_2D;
+		pf = gl_format_for_wl_format(WL_SHM_FORMAT_XRGB8888);
+		break;
+	default:
+		// YUV and friends, let the driver sample them
+		target = GL_TEXTURE_EXTERNAL_OES;
+		pf = &external_pixel_format;
+		break;
+	}
+
+	gles2_texture_ensure_image_texture(tex, target);
+	GL_CALL(glEGLImageTargetTexture2DOES(target, dmabuf->image));
+	tex->wlr_texture.width = dmabuf->attributes.width;
+	tex->wlr_texture.height = dmabuf->attributes.height;
 	tex->wlr_texture.valid = true;
 	tex->pixel_format = pf;
 
@@ -220,9 +350,9 @@ static void gles2_texture_get_matrix(struct wlr_texture *_texture,
 
 static void gles2_texture_bind(struct wlr_texture *_texture) {
 	struct wlr_gles2_texture *texture = (struct wlr_gles2_texture *)_texture;
-	GL_CALL(glBindTexture(GL_TEXTURE_2D, texture->tex_id));
-	GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-	GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GL_CALL(glBindTexture(texture->target, texture->tex_id));
+	GL_CALL(glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GL_CALL(glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 	GL_CALL(glUseProgram(*texture->pixel_format->shader));
 }
 
@@ -233,10 +363,6 @@ static void gles2_texture_destroy(struct wlr_texture *_texture) {
 		GL_CALL(glDeleteTextures(1, &texture->tex_id));
 	}
 
-	if (texture->image) {
-		wlr_egl_destroy_image(texture->egl, texture->image);
-	}
-
 	free(texture);
 }
 
@@ -246,15 +372,18 @@ static struct wlr_texture_impl wlr_texture_impl = {
 	.upload_shm = gles2_texture_upload_shm,
 	.update_shm = gles2_texture_update_shm,
 	.upload_drm = gles2_texture_upload_drm,
+	.upload_dmabuf = gles2_texture_upload_dmabuf,
 	.get_matrix = gles2_texture_get_matrix,
 	.bind = gles2_texture_bind,
 	.destroy = gles2_texture_destroy,
 };
 
-struct wlr_texture *gles2_texture_init(struct wlr_egl *egl) {
+struct wlr_texture *gles2_texture_init(struct wlr_gles2_renderer *renderer) {
 	struct wlr_gles2_texture *texture =
 		calloc(1, sizeof(struct wlr_gles2_texture));
 	wlr_texture_init(&texture->wlr_texture, &wlr_texture_impl);
-	texture->egl = egl;
+	texture->renderer = renderer;
+	texture->egl = renderer->egl;
+	texture->target = GL_TEXTURE_2D;
 	return &texture->wlr_texture;
 }
@@ -141,3 +141,43 @@ void wlr_matrix_texture(float mat[static 16], int32_t width, int32_t height,
 	mat[10] = 1.0f;
 	mat[15] = 1.0f;
 }
+
+void wlr_matrix_buffer_transform(float mat[static 16],
+		enum wl_output_transform transform, int32_t width, int32_t height) {
+	wlr_matrix_identity((float (*)[16])mat);
+
+	// The buffer holds the surface flipped first, then rotated
+	// counter-clockwise: bx = mat[0] * sx + mat[1] * sy + mat[3], and
+	// by = mat[4] * sx + mat[5] * sy + mat[7]
+	switch (transform) {
+	case WL_OUTPUT_TRANSFORM_NORMAL:
+		break;
+	case WL_OUTPUT_TRANSFORM_90:
+		mat[0] = 0; mat[1] = 1; mat[4] = -1; mat[5] = 0;
+		mat[7] = width;
+		break;
+	case WL_OUTPUT_TRANSFORM_180:
+		mat[0] = -1; mat[5] = -1;
+		mat[3] = width; mat[7] = height;
+		break;
+	case WL_OUTPUT_TRANSFORM_270:
+		mat[0] = 0; mat[1] = -1; mat[4] = 1; mat[5] = 0;
+		mat[3] = height;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED:
+		mat[0] = -1;
+		mat[3] = width;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+		mat[0] = 0; mat[1] = 1; mat[4] = 1; mat[5] = 0;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+		mat[5] = -1;
+		mat[7] = height;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+		mat[0] = 0; mat[1] = -1; mat[4] = -1; mat[5] = 0;
+		mat[3] = height; mat[7] = width;
+		break;
+	}
+}
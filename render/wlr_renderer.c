@@ -32,6 +32,16 @@ bool wlr_render_with_matrix(struct wlr_renderer *r,
 	return r->impl->render_with_matrix(r, texture, matrix);
 }
 
+bool wlr_render_with_texcoord_matrix(struct wlr_renderer *r,
+		struct wlr_texture *texture, const float (*matrix)[16],
+		const float (*texcoord_matrix)[16]) {
+	if (!r->impl->render_with_texcoord_matrix) {
+		return r->impl->render_with_matrix(r, texture, matrix);
+	}
+	return r->impl->render_with_texcoord_matrix(r, texture, matrix,
+		texcoord_matrix);
+}
+
 void wlr_render_colored_quad(struct wlr_renderer *r,
 		const float (*color)[4], const float (*matrix)[16]) {
 	r->impl->render_quad(r, color, matrix);
@@ -51,3 +61,10 @@ bool wlr_renderer_buffer_is_drm(struct wlr_renderer *r,
 		struct wl_resource *buffer) {
 	return r->impl->buffer_is_drm(r, buffer);
 }
+
+int wlr_renderer_create_fence(struct wlr_renderer *r) {
+	if (!r->impl->create_fence) {
+		return -1;
+	}
+	return r->impl->create_fence(r);
+}
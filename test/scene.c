@@ -0,0 +1,74 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_scene.h>
+
+/*
+ * Places nodes whose size and position overflow int32 when added up, and
+ * checks that they are indexed with a sane box and can still be found.
+ */
+
+static const float color[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+static bool check_node(const char *name, struct wlr_scene *scene,
+		struct wlr_scene_node *node, double lx, double ly) {
+	bool ok = true;
+	if (!node->indexed) {
+		fprintf(stderr, "%s: not indexed\n", name);
+		return false;
+	}
+	if (node->box.x1 >= node->box.x2 || node->box.y1 >= node->box.y2) {
+		fprintf(stderr, "%s: empty box %d,%d %d,%d\n", name,
+			node->box.x1, node->box.y1, node->box.x2, node->box.y2);
+		ok = false;
+	}
+	if (node->n_cells > WLR_SCENE_MAX_NODE_CELLS) {
+		fprintf(stderr, "%s: registered in %d cells\n", name, node->n_cells);
+		ok = false;
+	}
+	if (wlr_scene_node_at(scene, lx, ly, NULL, NULL) != node) {
+		fprintf(stderr, "%s: not found at %f,%f\n", name, lx, ly);
+		ok = false;
+	}
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	struct wlr_scene *scene = wlr_scene_create(NULL);
+	if (!scene) {
+		return 1;
+	}
+	int failed = 0;
+
+	// Offset by its parent, the far edges land past INT32_MAX
+	struct wlr_scene_tree *tree = wlr_scene_tree_create(&scene->node);
+	wlr_scene_node_set_position(&tree->node, 1000, 1000);
+	struct wlr_scene_rect *huge = wlr_scene_rect_create(&tree->node,
+		INT32_MAX, INT32_MAX, color);
+	wlr_scene_node_set_position(&huge->node, 1000000, 1000000);
+	if (!check_node("huge", scene, &huge->node, 2000000, 2000000)) {
+		++failed;
+	}
+
+	// Small, but next to the edge of the coordinate space
+	struct wlr_scene_rect *edge = wlr_scene_rect_create(&scene->node,
+		300, 300, color);
+	wlr_scene_node_set_position(&edge->node, INT32_MIN / 2 + 10,
+		INT32_MIN / 2 + 10);
+	if (!check_node("edge", scene, &edge->node, INT32_MIN / 2 + 100,
+			INT32_MIN / 2 + 100)) {
+		++failed;
+	}
+
+	// Wide and flat: each axis on its own is too large to multiply
+	struct wlr_scene_rect *wide = wlr_scene_rect_create(&scene->node,
+		INT32_MAX, 1, color);
+	wlr_scene_node_set_position(&wide->node, -1000000, 0);
+	if (!check_node("wide", scene, &wide->node, 0, 0)) {
+		++failed;
+	}
+
+	wlr_scene_node_destroy(&scene->node);
+	return failed == 0 ? 0 : 1;
+}
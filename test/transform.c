@@ -0,0 +1,59 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <pixman.h>
+#include <wayland-server-protocol.h>
+#include <wlr/render/matrix.h>
+#include <wlr/types/wlr_region.h>
+
+/*
+ * Maps a pixel near a corner of a non-square surface through every buffer
+ * transform, once with the matrix wlr_surface uses and once with
+ * wlr_region_transform, and checks that both land on the same buffer pixel.
+ */
+
+#define WIDTH 40
+#define HEIGHT 30
+
+static const char *names[] = {
+	"normal", "90", "180", "270",
+	"flipped", "flipped-90", "flipped-180", "flipped-270",
+};
+
+static bool check_transform(enum wl_output_transform transform) {
+	const int32_t sx = 2, sy = 1;
+
+	float mat[16];
+	wlr_matrix_buffer_transform(mat, transform, WIDTH, HEIGHT);
+	// Map the corners of the pixel, the box between them is the result
+	float x1 = mat[0] * sx + mat[1] * sy + mat[3];
+	float y1 = mat[4] * sx + mat[5] * sy + mat[7];
+	float x2 = mat[0] * (sx + 1) + mat[1] * (sy + 1) + mat[3];
+	float y2 = mat[4] * (sx + 1) + mat[5] * (sy + 1) + mat[7];
+	int32_t mx = x1 < x2 ? x1 : x2;
+	int32_t my = y1 < y2 ? y1 : y2;
+
+	pixman_region32_t region;
+	pixman_region32_init_rect(&region, sx, sy, 1, 1);
+	wlr_region_transform(&region, &region, transform, WIDTH, HEIGHT);
+	pixman_box32_t *box = pixman_region32_extents(&region);
+	bool ok = box->x2 - box->x1 == 1 && box->y2 - box->y1 == 1 &&
+		box->x1 == mx && box->y1 == my;
+	if (!ok) {
+		fprintf(stderr, "%s: matrix maps (%d, %d) to (%d, %d), "
+			"region to (%d, %d) %dx%d\n", names[transform], sx, sy, mx, my,
+			box->x1, box->y1, box->x2 - box->x1, box->y2 - box->y1);
+	}
+	pixman_region32_fini(&region);
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	int failed = 0;
+	for (int i = WL_OUTPUT_TRANSFORM_NORMAL;
+			i <= WL_OUTPUT_TRANSFORM_FLIPPED_270; ++i) {
+		if (!check_transform(i)) {
+			++failed;
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 199309L
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_input_latency.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+
+struct wlr_input_latency *wlr_input_latency_create(void) {
+	struct wlr_input_latency *latency =
+		calloc(1, sizeof(struct wlr_input_latency));
+	if (!latency) {
+		return NULL;
+	}
+	wl_list_init(&latency->outputs);
+	return latency;
+}
+
+void wlr_input_latency_destroy(struct wlr_input_latency *latency) {
+	if (!latency) {
+		return;
+	}
+	struct wlr_input_latency_output *latency_output, *tmp;
+	wl_list_for_each_safe(latency_output, tmp, &latency->outputs, link) {
+		wlr_input_latency_output_destroy(latency_output);
+	}
+	free(latency);
+}
+
+void wlr_input_latency_notify_input(struct wlr_input_latency *latency,
+		uint64_t time_usec) {
+	if (time_usec > latency->last_input_usec) {
+		latency->last_input_usec = time_usec;
+	}
+}
+
+static int compare_samples(const void *_a, const void *_b) {
+	uint64_t a = *(const uint64_t *)_a, b = *(const uint64_t *)_b;
+	return (a > b) - (a < b);
+}
+
+bool wlr_input_latency_output_get_stats(
+		struct wlr_input_latency_output *latency_output,
+		struct wlr_input_latency_stats *stats) {
+	size_t n = latency_output->n_samples;
+	if (n == 0) {
+		return false;
+	}
+	uint64_t sorted[WLR_INPUT_LATENCY_SAMPLES];
+	memcpy(sorted, latency_output->samples, n * sizeof(sorted[0]));
+	qsort(sorted, n, sizeof(sorted[0]), compare_samples);
+
+	stats->samples = n;
+	stats->p50 = sorted[n * 50 / 100];
+	stats->p90 = sorted[n * 90 / 100];
+	stats->p99 = sorted[n * 99 / 100];
+	stats->max = sorted[n - 1];
+	return true;
+}
+
+static void log_stats(struct wlr_input_latency_output *latency_output) {
+	struct wlr_input_latency_stats stats;
+	if (!wlr_input_latency_output_get_stats(latency_output, &stats)) {
+		return;
+	}
+	wlr_log(L_DEBUG, "Input latency on %s over %zu frames: p50 %.2f ms, "
+		"p90 %.2f ms, p99 %.2f ms, max %.2f ms",
+		latency_output->output->name, stats.samples,
+		stats.p50 / 1000.0, stats.p90 / 1000.0, stats.p99 / 1000.0,
+		stats.max / 1000.0);
+}
+
+static void handle_output_present(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_output *latency_output =
+		wl_container_of(listener, latency_output, output_present);
+	struct wlr_output_event_present *event = data;
+	uint64_t input_usec = latency_output->pending_input_usec;
+	if (input_usec == 0) {
+		return;
+	}
+	latency_output->pending_input_usec = 0;
+
+	uint64_t when_usec = (uint64_t)event->when->tv_sec * 1000000 +
+		event->when->tv_nsec / 1000;
+	uint64_t sample = when_usec > input_usec ? when_usec - input_usec : 0;
+
+	latency_output->samples[latency_output->next_sample] = sample;
+	latency_output->next_sample =
+		(latency_output->next_sample + 1) % WLR_INPUT_LATENCY_SAMPLES;
+	if (latency_output->n_samples < WLR_INPUT_LATENCY_SAMPLES) {
+		++latency_output->n_samples;
+	}
+	if (latency_output->next_sample == 0) {
+		log_stats(latency_output);
+	}
+}
+
+static void handle_output_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_output *latency_output =
+		wl_container_of(listener, latency_output, output_destroy);
+	wlr_input_latency_output_destroy(latency_output);
+}
+
+struct wlr_input_latency_output *wlr_input_latency_add_output(
+		struct wlr_input_latency *latency, struct wlr_output *output) {
+	assert(latency && output);
+	struct wlr_input_latency_output *latency_output =
+		calloc(1, sizeof(struct wlr_input_latency_output));
+	if (!latency_output) {
+		return NULL;
+	}
+	latency_output->latency = latency;
+	latency_output->output = output;
+	// Input from before the output existed was never meant for it
+	latency_output->sampled_input_usec = latency->last_input_usec;
+	wl_list_insert(&latency->outputs, &latency_output->link);
+
+	latency_output->output_present.notify = handle_output_present;
+	wl_signal_add(&output->events.present, &latency_output->output_present);
+	latency_output->output_destroy.notify = handle_output_destroy;
+	wl_signal_add(&output->events.destroy, &latency_output->output_destroy);
+	return latency_output;
+}
+
+void wlr_input_latency_output_destroy(
+		struct wlr_input_latency_output *latency_output) {
+	if (!latency_output) {
+		return;
+	}
+	log_stats(latency_output);
+	wl_list_remove(&latency_output->link);
+	wl_list_remove(&latency_output->output_present.link);
+	wl_list_remove(&latency_output->output_destroy.link);
+	free(latency_output);
+}
+
+void wlr_input_latency_output_sampled(
+		struct wlr_input_latency_output *latency_output) {
+	uint64_t input_usec = latency_output->latency->last_input_usec;
+	if (input_usec <= latency_output->sampled_input_usec) {
+		// Nothing new since the last frame, it doesn't show any input
+		return;
+	}
+	latency_output->sampled_input_usec = input_usec;
+	latency_output->pending_input_usec = input_usec;
+}
@@ -0,0 +1,202 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <wayland-server.h>
+#include <xkbcommon/xkbcommon.h>
+#include <wlr/types/wlr_key_repeat.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/util/log.h>
+
+static uint64_t get_time_usec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t repeat_period_usec(struct wlr_key_repeat *repeat) {
+	return 1000000 / repeat->rate;
+}
+
+static void usec_to_timespec(uint64_t usec, struct timespec *ts) {
+	ts->tv_sec = usec / 1000000;
+	ts->tv_nsec = (usec % 1000000) * 1000;
+}
+
+static void arm_timer(struct wlr_key_repeat *repeat) {
+	// The kernel keeps the expirations on the grid and counts the ones we
+	// haven't read yet
+	struct itimerspec spec = { 0 };
+	usec_to_timespec(repeat->start_usec, &spec.it_value);
+	usec_to_timespec(repeat_period_usec(repeat), &spec.it_interval);
+	if (timerfd_settime(repeat->timer_fd, TFD_TIMER_ABSTIME, &spec,
+			NULL) < 0) {
+		wlr_log_errno(L_ERROR, "Failed to arm key repeat timer");
+	}
+}
+
+void wlr_key_repeat_cancel(struct wlr_key_repeat *repeat) {
+	if (!repeat->keyboard) {
+		return;
+	}
+	repeat->keyboard = NULL;
+	struct itimerspec spec = { 0 };
+	if (timerfd_settime(repeat->timer_fd, 0, &spec, NULL) < 0) {
+		wlr_log_errno(L_ERROR, "Failed to disarm key repeat timer");
+	}
+}
+
+static bool key_repeats(struct wlr_keyboard *keyboard, uint32_t keycode) {
+	if (!keyboard->keymap) {
+		return true;
+	}
+	// xkb keycodes are offset by 8 from evdev ones
+	return xkb_keymap_key_repeats(keyboard->keymap, keycode + 8);
+}
+
+static void handle_key(struct wl_listener *listener, void *data) {
+	struct wlr_key_repeat_keyboard *repeat_keyboard =
+		wl_container_of(listener, repeat_keyboard, key);
+	struct wlr_key_repeat *repeat = repeat_keyboard->repeat;
+	struct wlr_event_keyboard_key *event = data;
+
+	if (event->state == WLR_KEY_RELEASED) {
+		if (repeat->keyboard == repeat_keyboard->keyboard &&
+				repeat->keycode == event->keycode) {
+			wlr_key_repeat_cancel(repeat);
+		}
+		return;
+	}
+
+	wlr_key_repeat_cancel(repeat);
+	if (repeat->rate <= 0 ||
+			!key_repeats(repeat_keyboard->keyboard, event->keycode)) {
+		return;
+	}
+	repeat->keyboard = repeat_keyboard->keyboard;
+	repeat->keycode = event->keycode;
+	repeat->start_usec = get_time_usec() + (uint64_t)repeat->delay * 1000;
+	repeat->repeats = 0;
+	arm_timer(repeat);
+}
+
+static int handle_timer(int fd, uint32_t mask, void *data) {
+	struct wlr_key_repeat *repeat = data;
+	uint64_t expirations;
+	if (read(fd, &expirations, sizeof(expirations)) < 0) {
+		// The timer was disarmed or re-armed since it woke us up
+		if (errno != EAGAIN) {
+			wlr_log_errno(L_ERROR, "Failed to read key repeat timer");
+		}
+		return 0;
+	}
+	if (!repeat->keyboard || expirations == 0) {
+		return 0;
+	}
+
+	repeat->repeats += expirations;
+	uint64_t time_usec = repeat->start_usec +
+		(repeat->repeats - 1) * repeat_period_usec(repeat);
+	struct wlr_event_key_repeat event = {
+		.keyboard = repeat->keyboard,
+		.keycode = repeat->keycode,
+		.count = expirations > UINT32_MAX ? UINT32_MAX : expirations,
+		.time_sec = time_usec / 1000,
+		.time_usec = time_usec,
+	};
+	wl_signal_emit(&repeat->events.repeat, &event);
+	return 0;
+}
+
+struct wlr_key_repeat *wlr_key_repeat_create(struct wl_event_loop *loop) {
+	struct wlr_key_repeat *repeat = calloc(1, sizeof(struct wlr_key_repeat));
+	if (!repeat) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+	repeat->timer_fd = timerfd_create(CLOCK_MONOTONIC,
+		TFD_CLOEXEC | TFD_NONBLOCK);
+	if (repeat->timer_fd < 0) {
+		wlr_log_errno(L_ERROR, "Failed to create key repeat timer");
+		free(repeat);
+		return NULL;
+	}
+	repeat->timer_source = wl_event_loop_add_fd(loop, repeat->timer_fd,
+		WL_EVENT_READABLE, handle_timer, repeat);
+	if (!repeat->timer_source) {
+		wlr_log(L_ERROR, "Failed to add key repeat timer to event loop");
+		close(repeat->timer_fd);
+		free(repeat);
+		return NULL;
+	}
+
+	// The usual defaults of X and Wayland compositors
+	repeat->rate = 25;
+	repeat->delay = 600;
+	wl_list_init(&repeat->keyboards);
+	wl_signal_init(&repeat->events.repeat);
+	return repeat;
+}
+
+static void repeat_keyboard_destroy(
+		struct wlr_key_repeat_keyboard *repeat_keyboard) {
+	struct wlr_key_repeat *repeat = repeat_keyboard->repeat;
+	if (repeat->keyboard == repeat_keyboard->keyboard) {
+		wlr_key_repeat_cancel(repeat);
+	}
+	wl_list_remove(&repeat_keyboard->key.link);
+	wl_list_remove(&repeat_keyboard->link);
+	free(repeat_keyboard);
+}
+
+void wlr_key_repeat_destroy(struct wlr_key_repeat *repeat) {
+	if (!repeat) {
+		return;
+	}
+	struct wlr_key_repeat_keyboard *repeat_keyboard, *tmp;
+	wl_list_for_each_safe(repeat_keyboard, tmp, &repeat->keyboards, link) {
+		repeat_keyboard_destroy(repeat_keyboard);
+	}
+	wl_event_source_remove(repeat->timer_source);
+	close(repeat->timer_fd);
+	free(repeat);
+}
+
+void wlr_key_repeat_set_info(struct wlr_key_repeat *repeat, int32_t rate,
+		int32_t delay) {
+	repeat->rate = rate > 0 ? rate : 0;
+	repeat->delay = delay > 0 ? delay : 0;
+	if (repeat->rate == 0) {
+		wlr_key_repeat_cancel(repeat);
+	}
+}
+
+bool wlr_key_repeat_add_keyboard(struct wlr_key_repeat *repeat,
+		struct wlr_keyboard *keyboard) {
+	struct wlr_key_repeat_keyboard *repeat_keyboard =
+		calloc(1, sizeof(struct wlr_key_repeat_keyboard));
+	if (!repeat_keyboard) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		return false;
+	}
+	repeat_keyboard->repeat = repeat;
+	repeat_keyboard->keyboard = keyboard;
+	repeat_keyboard->key.notify = handle_key;
+	wl_signal_add(&keyboard->events.key, &repeat_keyboard->key);
+	wl_list_insert(&repeat->keyboards, &repeat_keyboard->link);
+	return true;
+}
+
+void wlr_key_repeat_remove_keyboard(struct wlr_key_repeat *repeat,
+		struct wlr_keyboard *keyboard) {
+	struct wlr_key_repeat_keyboard *repeat_keyboard;
+	wl_list_for_each(repeat_keyboard, &repeat->keyboards, link) {
+		if (repeat_keyboard->keyboard == keyboard) {
+			repeat_keyboard_destroy(repeat_keyboard);
+			return;
+		}
+	}
+}
@@ -1,17 +1,51 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <wayland-server.h>
+#include <xkbcommon/xkbcommon.h>
 #include <wlr/types/wlr_keyboard.h>
 #include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/util/log.h>
 
 void wlr_keyboard_init(struct wlr_keyboard *kb,
 		struct wlr_keyboard_impl *impl) {
 	kb->impl = impl;
+	kb->keymap_fd = -1;
 	wl_signal_init(&kb->events.key);
+	wl_signal_init(&kb->events.keymap);
+	wl_signal_init(&kb->events.repeat_info);
+}
+
+static void keymap_names_finish(struct wlr_keyboard *kb) {
+	free(kb->keymap_names.rules);
+	free(kb->keymap_names.model);
+	free(kb->keymap_names.layout);
+	free(kb->keymap_names.variant);
+	free(kb->keymap_names.options);
+	memset(&kb->keymap_names, 0, sizeof(kb->keymap_names));
+}
+
+static void keymap_finish(struct wlr_keyboard *kb) {
+	xkb_keymap_unref(kb->keymap);
+	kb->keymap = NULL;
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+	}
+	kb->keymap_fd = -1;
+	kb->keymap_size = 0;
+	keymap_names_finish(kb);
 }
 
 void wlr_keyboard_destroy(struct wlr_keyboard *kb) {
-	if (kb && kb->impl && kb->impl->destroy) {
+	if (!kb) {
+		return;
+	}
+	keymap_finish(kb);
+	if (kb->impl && kb->impl->destroy) {
 		kb->impl->destroy(kb);
 	} else {
 		free(kb);
@@ -23,3 +57,135 @@ void wlr_keyboard_led_update(struct wlr_keyboard *kb, uint32_t leds) {
 		kb->impl->led_update(kb, leds);
 	}
 }
+
+void wlr_keyboard_set_repeat_info(struct wlr_keyboard *kb, int32_t rate,
+		int32_t delay) {
+	kb->repeat_info.rate = rate;
+	kb->repeat_info.delay = delay;
+	wl_signal_emit(&kb->events.repeat_info, kb);
+}
+
+/**
+ * Writes the keymap to a memfd sealed against any further change, so it can
+ * be handed to every client without them being able to modify it for the
+ * others.
+ */
+static int create_keymap_fd(const char *keymap_str, size_t size) {
+	int fd = memfd_create("wlroots-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		wlr_log_errno(L_ERROR, "Failed to create keymap memfd");
+		return -1;
+	}
+	size_t written = 0;
+	while (written < size) {
+		ssize_t ret = write(fd, keymap_str + written, size - written);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			wlr_log_errno(L_ERROR, "Failed to write keymap");
+			close(fd);
+			return -1;
+		}
+		written += ret;
+	}
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE |
+			F_SEAL_SEAL) < 0) {
+		wlr_log_errno(L_ERROR, "Failed to seal keymap memfd");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
+		struct xkb_keymap *keymap) {
+	if (keymap == kb->keymap) {
+		return true;
+	}
+
+	char *keymap_str = xkb_keymap_get_as_string(keymap,
+		XKB_KEYMAP_FORMAT_TEXT_V1);
+	if (!keymap_str) {
+		wlr_log(L_ERROR, "Failed to serialize keymap");
+		return false;
+	}
+	// Clients expect the terminating NUL to be part of the keymap
+	size_t size = strlen(keymap_str) + 1;
+	int fd = create_keymap_fd(keymap_str, size);
+	free(keymap_str);
+	if (fd < 0) {
+		return false;
+	}
+
+	keymap_finish(kb);
+	kb->keymap = xkb_keymap_ref(keymap);
+	kb->keymap_fd = fd;
+	kb->keymap_size = size;
+	wl_signal_emit(&kb->events.keymap, kb);
+	return true;
+}
+
+static bool name_equal(const char *a, const char *b) {
+	if (!a || !b) {
+		return a == b;
+	}
+	return strcmp(a, b) == 0;
+}
+
+static char *name_dup(const char *name) {
+	return name ? strdup(name) : NULL;
+}
+
+bool wlr_keyboard_set_keymap_from_names(struct wlr_keyboard *kb,
+		const struct xkb_rule_names *names) {
+	if (kb->keymap && name_equal(kb->keymap_names.rules, names->rules) &&
+			name_equal(kb->keymap_names.model, names->model) &&
+			name_equal(kb->keymap_names.layout, names->layout) &&
+			name_equal(kb->keymap_names.variant, names->variant) &&
+			name_equal(kb->keymap_names.options, names->options)) {
+		return true;
+	}
+
+	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+	if (!context) {
+		wlr_log(L_ERROR, "Failed to create XKB context");
+		return false;
+	}
+	struct xkb_keymap *keymap = xkb_keymap_new_from_names(context, names,
+		XKB_KEYMAP_COMPILE_NO_FLAGS);
+	xkb_context_unref(context);
+	if (!keymap) {
+		wlr_log(L_ERROR, "Failed to compile keymap");
+		return false;
+	}
+
+	bool ok = wlr_keyboard_set_keymap(kb, keymap);
+	xkb_keymap_unref(keymap);
+	if (!ok) {
+		return false;
+	}
+	kb->keymap_names.rules = name_dup(names->rules);
+	kb->keymap_names.model = name_dup(names->model);
+	kb->keymap_names.layout = name_dup(names->layout);
+	kb->keymap_names.variant = name_dup(names->variant);
+	kb->keymap_names.options = name_dup(names->options);
+	return true;
+}
+
+void wlr_keyboard_send_keymap(struct wlr_keyboard *kb,
+		struct wl_resource *resource) {
+	if (kb->keymap_fd < 0) {
+		int fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			wlr_log_errno(L_ERROR, "Failed to open /dev/null");
+			return;
+		}
+		wl_keyboard_send_keymap(resource, WL_KEYBOARD_KEYMAP_FORMAT_NO_KEYMAP,
+			fd, 0);
+		close(fd);
+		return;
+	}
+	wl_keyboard_send_keymap(resource, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
+		kb->keymap_fd, kb->keymap_size);
+}
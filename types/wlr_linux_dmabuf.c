@@ -0,0 +1,416 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <wayland-server.h>
+#include <wlr/egl.h>
+#include <wlr/types/wlr_linux_dmabuf.h>
+#include <wlr/util/log.h>
+#include "linux-dmabuf-unstable-v1-protocol.h"
+
+static void wl_buffer_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static const struct wl_buffer_interface wl_buffer_impl = {
+	.destroy = wl_buffer_destroy,
+};
+
+bool wlr_dmabuf_resource_is_buffer(struct wl_resource *buffer_resource) {
+	if (!wl_resource_instance_of(buffer_resource, &wl_buffer_interface,
+			&wl_buffer_impl)) {
+		return false;
+	}
+
+	struct wlr_dmabuf_buffer *buffer =
+		wl_resource_get_user_data(buffer_resource);
+	return buffer && buffer->buffer_resource && !buffer->params_resource;
+}
+
+struct wlr_dmabuf_buffer *wlr_dmabuf_buffer_from_buffer_resource(
+		struct wl_resource *buffer_resource) {
+	assert(wl_resource_instance_of(buffer_resource, &wl_buffer_interface,
+		&wl_buffer_impl));
+
+	struct wlr_dmabuf_buffer *buffer =
+		wl_resource_get_user_data(buffer_resource);
+	assert(buffer);
+	assert(buffer->buffer_resource);
+	assert(!buffer->params_resource);
+	assert(buffer->buffer_resource == buffer_resource);
+	return buffer;
+}
+
+static void linux_dmabuf_buffer_destroy(struct wlr_dmabuf_buffer *buffer) {
+	if (buffer->image) {
+		wlr_egl_destroy_image(buffer->egl, buffer->image);
+	}
+	for (int i = 0; i < WLR_LINUX_DMABUF_MAX_PLANES; i++) {
+		if (buffer->attributes.fd[i] != -1) {
+			close(buffer->attributes.fd[i]);
+			buffer->attributes.fd[i] = -1;
+		}
+	}
+	buffer->attributes.n_planes = 0;
+	free(buffer);
+}
+
+static void params_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void params_add(struct wl_client *client,
+		struct wl_resource *params_resource, int32_t name_fd,
+		uint32_t plane_idx, uint32_t offset, uint32_t stride,
+		uint32_t modifier_hi, uint32_t modifier_lo) {
+	struct wlr_dmabuf_buffer *buffer =
+		wl_resource_get_user_data(params_resource);
+	if (!buffer) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED,
+			"params was already used to create a wl_buffer");
+		close(name_fd);
+		return;
+	}
+
+	if (plane_idx >= WLR_LINUX_DMABUF_MAX_PLANES) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_IDX,
+			"plane index %u > %u", plane_idx, WLR_LINUX_DMABUF_MAX_PLANES);
+		close(name_fd);
+		return;
+	}
+
+	if (buffer->attributes.fd[plane_idx] != -1) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_SET,
+			"a dmabuf with id %d has already been added for plane %u",
+			buffer->attributes.fd[plane_idx], plane_idx);
+		close(name_fd);
+		return;
+	}
+
+	buffer->attributes.fd[plane_idx] = name_fd;
+	buffer->attributes.offset[plane_idx] = offset;
+	buffer->attributes.stride[plane_idx] = stride;
+	buffer->attributes.modifier[plane_idx] =
+		((uint64_t)modifier_hi << 32) | modifier_lo;
+	buffer->attributes.n_planes++;
+}
+
+static void buffer_handle_resource_destroy(struct wl_resource *buffer_resource) {
+	struct wlr_dmabuf_buffer *buffer =
+		wlr_dmabuf_buffer_from_buffer_resource(buffer_resource);
+	linux_dmabuf_buffer_destroy(buffer);
+}
+
+static void params_create_common(struct wl_client *client,
+		struct wl_resource *params_resource, uint32_t buffer_id,
+		int32_t width, int32_t height, uint32_t format, uint32_t flags) {
+	if (!wl_resource_get_user_data(params_resource)) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED,
+			"params was already used to create a wl_buffer");
+		return;
+	}
+	struct wlr_dmabuf_buffer *buffer =
+		wl_resource_get_user_data(params_resource);
+
+	// Prevent the params from being used again, the buffer owns the
+	// attributes from now on
+	wl_resource_set_user_data(params_resource, NULL);
+	buffer->params_resource = NULL;
+
+	if (!buffer->attributes.n_planes) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE,
+			"no dmabuf has been added to the params");
+		goto err_out;
+	}
+
+	if (buffer->attributes.fd[0] == -1) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE,
+			"no dmabuf has been added for plane 0");
+		goto err_out;
+	}
+
+	// Planes have to be added without gaps
+	for (int i = 0; i < buffer->attributes.n_planes; i++) {
+		if (buffer->attributes.fd[i] == -1) {
+			wl_resource_post_error(params_resource,
+				ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE,
+				"no dmabuf has been added for plane %d", i);
+			goto err_out;
+		}
+	}
+
+	buffer->attributes.width = width;
+	buffer->attributes.height = height;
+	buffer->attributes.format = format;
+	buffer->attributes.flags = flags;
+
+	if (width < 1 || height < 1) {
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_DIMENSIONS,
+			"invalid width %d or height %d", width, height);
+		goto err_out;
+	}
+
+	for (int i = 0; i < buffer->attributes.n_planes; i++) {
+		if ((uint64_t)buffer->attributes.offset[i]
+				+ buffer->attributes.stride[i] > UINT32_MAX) {
+			wl_resource_post_error(params_resource,
+				ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_OUT_OF_BOUNDS,
+				"size overflow for plane %d", i);
+			goto err_out;
+		}
+
+		// Not every kernel supports seeking on dmabufs, only check the size
+		// when it can be known
+		off_t size = lseek(buffer->attributes.fd[i], 0, SEEK_END);
+		if (size == -1) {
+			continue;
+		}
+
+		if (buffer->attributes.offset[i] >= (uint64_t)size) {
+			wl_resource_post_error(params_resource,
+				ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_OUT_OF_BOUNDS,
+				"invalid offset %u for plane %d",
+				buffer->attributes.offset[i], i);
+			goto err_out;
+		}
+
+		if (buffer->attributes.offset[i] + buffer->attributes.stride[i] >
+					(uint64_t)size ||
+				buffer->attributes.stride[i] == 0) {
+			wl_resource_post_error(params_resource,
+				ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_OUT_OF_BOUNDS,
+				"invalid stride %u for plane %d",
+				buffer->attributes.stride[i], i);
+			goto err_out;
+		}
+
+		// Planes > 0 may be subsampled, only the first one can be checked
+		if (i == 0 && buffer->attributes.offset[i] +
+				buffer->attributes.stride[i] * (uint64_t)height > (uint64_t)size) {
+			wl_resource_post_error(params_resource,
+				ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_OUT_OF_BOUNDS,
+				"invalid buffer stride or height for plane %d", i);
+			goto err_out;
+		}
+	}
+
+	// Import now so unusable buffers fail early, the image is then reused for
+	// every texture upload of this buffer
+	if (!buffer->egl) {
+		// The global has been destroyed
+		goto err_failed;
+	}
+	buffer->image = wlr_egl_create_image_from_dmabuf(buffer->egl,
+		&buffer->attributes);
+	if (!buffer->image) {
+		wlr_log(L_ERROR, "Failed to import dmabuf: %s", egl_error());
+		goto err_failed;
+	}
+
+	buffer->buffer_resource = wl_resource_create(client, &wl_buffer_interface,
+		1, buffer_id);
+	if (!buffer->buffer_resource) {
+		wl_resource_post_no_memory(params_resource);
+		goto err_out;
+	}
+
+	wl_resource_set_implementation(buffer->buffer_resource,
+		&wl_buffer_impl, buffer, buffer_handle_resource_destroy);
+
+	// Send 'created' only for the requests that didn't give an id
+	if (buffer_id == 0) {
+		zwp_linux_buffer_params_v1_send_created(params_resource,
+			buffer->buffer_resource);
+	}
+	return;
+
+err_failed:
+	if (buffer_id == 0) {
+		zwp_linux_buffer_params_v1_send_failed(params_resource);
+	} else {
+		// Since the behavior is client-defined for create_immed, it is
+		// allowed to kill the client
+		wl_resource_post_error(params_resource,
+			ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_WL_BUFFER,
+			"importing the supplied dmabufs failed");
+	}
+err_out:
+	linux_dmabuf_buffer_destroy(buffer);
+}
+
+static void params_create(struct wl_client *client,
+		struct wl_resource *params_resource,
+		int32_t width, int32_t height, uint32_t format, uint32_t flags) {
+	params_create_common(client, params_resource, 0, width, height, format,
+		flags);
+}
+
+static void params_create_immed(struct wl_client *client,
+		struct wl_resource *params_resource, uint32_t buffer_id,
+		int32_t width, int32_t height, uint32_t format, uint32_t flags) {
+	params_create_common(client, params_resource, buffer_id, width, height,
+		format, flags);
+}
+
+static const struct zwp_linux_buffer_params_v1_interface linux_buffer_params_impl = {
+	.destroy = params_destroy,
+	.add = params_add,
+	.create = params_create,
+	.create_immed = params_create_immed,
+};
+
+static void handle_params_destroy(struct wl_resource *params_resource) {
+	// The buffer is gone from the params once create has been called
+	struct wlr_dmabuf_buffer *buffer =
+		wl_resource_get_user_data(params_resource);
+	if (!buffer) {
+		return;
+	}
+	linux_dmabuf_buffer_destroy(buffer);
+}
+
+static void linux_dmabuf_create_params(struct wl_client *client,
+		struct wl_resource *linux_dmabuf_resource, uint32_t params_id) {
+	struct wlr_linux_dmabuf *linux_dmabuf =
+		wl_resource_get_user_data(linux_dmabuf_resource);
+	uint32_t version = wl_resource_get_version(linux_dmabuf_resource);
+
+	struct wlr_dmabuf_buffer *buffer = calloc(1, sizeof(struct wlr_dmabuf_buffer));
+	if (!buffer) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	for (int i = 0; i < WLR_LINUX_DMABUF_MAX_PLANES; i++) {
+		buffer->attributes.fd[i] = -1;
+	}
+	buffer->egl = linux_dmabuf ? linux_dmabuf->egl : NULL;
+
+	buffer->params_resource = wl_resource_create(client,
+		&zwp_linux_buffer_params_v1_interface, version, params_id);
+	if (!buffer->params_resource) {
+		free(buffer);
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(buffer->params_resource,
+		&linux_buffer_params_impl, buffer, handle_params_destroy);
+}
+
+static void linux_dmabuf_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static const struct zwp_linux_dmabuf_v1_interface linux_dmabuf_impl = {
+	.destroy = linux_dmabuf_destroy,
+	.create_params = linux_dmabuf_create_params,
+};
+
+static void linux_dmabuf_send_modifiers(struct wlr_linux_dmabuf *linux_dmabuf,
+		struct wl_resource *resource) {
+	struct wlr_egl *egl = linux_dmabuf->egl;
+	int *formats = NULL;
+	int num_formats = wlr_egl_get_dmabuf_formats(egl, &formats);
+	if (num_formats < 0) {
+		return;
+	}
+
+	for (int i = 0; i < num_formats; i++) {
+		if (wl_resource_get_version(resource) <
+				ZWP_LINUX_DMABUF_V1_MODIFIER_SINCE_VERSION) {
+			zwp_linux_dmabuf_v1_send_format(resource, formats[i]);
+			continue;
+		}
+
+		uint64_t *modifiers = NULL;
+		int num_modifiers = wlr_egl_get_dmabuf_modifiers(egl, formats[i],
+			&modifiers);
+		if (num_modifiers < 0) {
+			continue;
+		}
+		for (int j = 0; j < num_modifiers; j++) {
+			uint32_t modifier_lo = modifiers[j] & 0xFFFFFFFF;
+			uint32_t modifier_hi = modifiers[j] >> 32;
+			zwp_linux_dmabuf_v1_send_modifier(resource, formats[i],
+				modifier_hi, modifier_lo);
+		}
+		// Let the client allocate with implicit modifiers too
+		zwp_linux_dmabuf_v1_send_modifier(resource, formats[i],
+			DRM_FORMAT_MOD_INVALID >> 32, DRM_FORMAT_MOD_INVALID & 0xFFFFFFFF);
+		free(modifiers);
+	}
+	free(formats);
+}
+
+static void linux_dmabuf_resource_destroy(struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void linux_dmabuf_bind(struct wl_client *wl_client,
+		void *_linux_dmabuf, uint32_t version, uint32_t id) {
+	struct wlr_linux_dmabuf *linux_dmabuf = _linux_dmabuf;
+	assert(wl_client && linux_dmabuf);
+	if (version > 3) {
+		wlr_log(L_ERROR, "Client requested unsupported zwp_linux_dmabuf_v1 version, disconnecting");
+		wl_client_destroy(wl_client);
+		return;
+	}
+	struct wl_resource *wl_resource = wl_resource_create(
+		wl_client, &zwp_linux_dmabuf_v1_interface, version, id);
+	if (!wl_resource) {
+		wl_client_post_no_memory(wl_client);
+		return;
+	}
+	wl_resource_set_implementation(wl_resource, &linux_dmabuf_impl,
+		linux_dmabuf, linux_dmabuf_resource_destroy);
+	wl_list_insert(&linux_dmabuf->wl_resources,
+		wl_resource_get_link(wl_resource));
+	linux_dmabuf_send_modifiers(linux_dmabuf, wl_resource);
+}
+
+struct wlr_linux_dmabuf *wlr_linux_dmabuf_create(struct wl_display *display,
+		struct wlr_egl *egl) {
+	struct wlr_linux_dmabuf *linux_dmabuf =
+		calloc(1, sizeof(struct wlr_linux_dmabuf));
+	if (!linux_dmabuf) {
+		wlr_log(L_ERROR, "could not create linux dmabuf v1");
+		return NULL;
+	}
+	linux_dmabuf->egl = egl;
+	wl_list_init(&linux_dmabuf->wl_resources);
+	linux_dmabuf->wl_global = wl_global_create(display,
+		&zwp_linux_dmabuf_v1_interface, 3, linux_dmabuf, linux_dmabuf_bind);
+	if (!linux_dmabuf->wl_global) {
+		wlr_log(L_ERROR, "could not create linux dmabuf v1 wl global");
+		free(linux_dmabuf);
+		return NULL;
+	}
+	return linux_dmabuf;
+}
+
+void wlr_linux_dmabuf_destroy(struct wlr_linux_dmabuf *linux_dmabuf) {
+	if (!linux_dmabuf) {
+		return;
+	}
+	struct wl_resource *resource, *tmp_resource;
+	wl_resource_for_each_safe(resource, tmp_resource,
+			&linux_dmabuf->wl_resources) {
+		wl_resource_set_user_data(resource, NULL);
+		wl_list_remove(wl_resource_get_link(resource));
+		wl_list_init(wl_resource_get_link(resource));
+	}
+	wl_global_destroy(linux_dmabuf->wl_global);
+	free(linux_dmabuf);
+}
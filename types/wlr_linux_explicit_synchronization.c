@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_linux_dmabuf.h>
+#include <wlr/types/wlr_linux_explicit_synchronization.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+#include "linux-explicit-synchronization-unstable-v1-protocol.h"
+
+static void buffer_release_resource_destroy(struct wl_resource *resource) {
+	// The surface drops its references before it goes away, so it is still
+	// alive if it is set here
+	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+	if (!surface) {
+		return;
+	}
+	if (surface->pending.buffer_release == resource) {
+		surface->pending.buffer_release = NULL;
+	}
+	if (surface->current.buffer_release == resource) {
+		surface->current.buffer_release = NULL;
+	}
+	if (surface->texture_release == resource) {
+		surface->texture_release = NULL;
+	}
+	struct wlr_surface_state *state;
+	wl_list_for_each(state, &surface->state_queue, link) {
+		if (state->buffer_release == resource) {
+			state->buffer_release = NULL;
+		}
+	}
+}
+
+void wlr_linux_buffer_release_send(struct wl_resource *release, int fence_fd) {
+	if (fence_fd >= 0) {
+		zwp_linux_buffer_release_v1_send_fenced_release(release, fence_fd);
+	} else {
+		zwp_linux_buffer_release_v1_send_immediate_release(release);
+	}
+	wl_resource_destroy(release);
+}
+
+static void surface_sync_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void surface_sync_set_acquire_fence(struct wl_client *client,
+		struct wl_resource *resource, int32_t fd) {
+	struct wlr_linux_surface_synchronization *sync =
+		wl_resource_get_user_data(resource);
+	if (!sync) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+			"the surface has been destroyed");
+		close(fd);
+		return;
+	}
+	if (sync->surface->pending.acquire_fence >= 0) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_FENCE,
+			"an acquire fence has already been set for this commit");
+		close(fd);
+		return;
+	}
+	sync->surface->pending.acquire_fence = fd;
+}
+
+static void surface_sync_get_release(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id) {
+	struct wlr_linux_surface_synchronization *sync =
+		wl_resource_get_user_data(resource);
+	if (!sync) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+			"the surface has been destroyed");
+		return;
+	}
+	if (sync->surface->pending.buffer_release) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_RELEASE,
+			"a release has already been requested for this commit");
+		return;
+	}
+
+	struct wl_resource *release = wl_resource_create(client,
+		&zwp_linux_buffer_release_v1_interface,
+		wl_resource_get_version(resource), id);
+	if (!release) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(release, NULL, sync->surface,
+		buffer_release_resource_destroy);
+	sync->surface->pending.buffer_release = release;
+}
+
+static const struct zwp_linux_surface_synchronization_v1_interface
+		surface_sync_impl = {
+	.destroy = surface_sync_destroy,
+	.set_acquire_fence = surface_sync_set_acquire_fence,
+	.get_release = surface_sync_get_release,
+};
+
+static void surface_sync_finish(struct wlr_linux_surface_synchronization *sync) {
+	wl_list_remove(&sync->surface_destroy.link);
+	wl_list_remove(&sync->surface_precommit.link);
+	wl_resource_set_user_data(sync->resource, NULL);
+	free(sync);
+}
+
+static void surface_sync_resource_destroy(struct wl_resource *resource) {
+	struct wlr_linux_surface_synchronization *sync =
+		wl_resource_get_user_data(resource);
+	if (!sync) {
+		return;
+	}
+
+	// What was set since the last commit is discarded with the object
+	struct wlr_surface_state *pending = &sync->surface->pending;
+	if (pending->acquire_fence >= 0) {
+		close(pending->acquire_fence);
+		pending->acquire_fence = -1;
+	}
+	if (pending->buffer_release) {
+		wlr_linux_buffer_release_send(pending->buffer_release, -1);
+	}
+	surface_sync_finish(sync);
+}
+
+static void handle_surface_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_linux_surface_synchronization *sync =
+		wl_container_of(listener, sync, surface_destroy);
+	// The surface cleans up its own fences and releases
+	surface_sync_finish(sync);
+}
+
+static void handle_surface_precommit(struct wl_listener *listener, void *data) {
+	struct wlr_linux_surface_synchronization *sync =
+		wl_container_of(listener, sync, surface_precommit);
+	struct wlr_surface_precommit_event *event = data;
+	struct wlr_surface_state *pending = &sync->surface->pending;
+	if (pending->acquire_fence < 0 && !pending->buffer_release) {
+		return;
+	}
+
+	if (!(pending->invalid & WLR_SURFACE_INVALID_BUFFER) || !pending->buffer) {
+		wl_resource_post_error(sync->resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_BUFFER,
+			"no buffer attached for the fence or release");
+		event->rejected = true;
+		return;
+	}
+
+	// shm buffers are read by the CPU right away, they can't wait on fences
+	if (pending->acquire_fence >= 0 &&
+			!wlr_dmabuf_resource_is_buffer(pending->buffer)) {
+		wl_resource_post_error(sync->resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_UNSUPPORTED_BUFFER,
+			"acquire fences are only supported for dmabuf buffers");
+		event->rejected = true;
+	}
+}
+
+static void explicit_sync_get_synchronization(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource) {
+	struct wlr_surface *surface = wl_resource_get_user_data(surface_resource);
+
+	if (wl_resource_get_destroy_listener(surface_resource,
+			handle_surface_destroy)) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_ERROR_SYNCHRONIZATION_EXISTS,
+			"the surface already has a synchronization object");
+		return;
+	}
+
+	struct wlr_linux_surface_synchronization *sync =
+		calloc(1, sizeof(struct wlr_linux_surface_synchronization));
+	if (!sync) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	sync->resource = wl_resource_create(client,
+		&zwp_linux_surface_synchronization_v1_interface,
+		wl_resource_get_version(resource), id);
+	if (!sync->resource) {
+		free(sync);
+		wl_client_post_no_memory(client);
+		return;
+	}
+	sync->surface = surface;
+
+	sync->surface_destroy.notify = handle_surface_destroy;
+	wl_resource_add_destroy_listener(surface_resource, &sync->surface_destroy);
+	sync->surface_precommit.notify = handle_surface_precommit;
+	wl_signal_add(&surface->signals.precommit, &sync->surface_precommit);
+
+	wl_resource_set_implementation(sync->resource, &surface_sync_impl, sync,
+		surface_sync_resource_destroy);
+}
+
+static void explicit_sync_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+		explicit_sync_impl = {
+	.destroy = explicit_sync_destroy,
+	.get_synchronization = explicit_sync_get_synchronization,
+};
+
+static void explicit_sync_resource_destroy(struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void explicit_sync_bind(struct wl_client *wl_client,
+		void *_explicit_sync, uint32_t version, uint32_t id) {
+	struct wlr_linux_explicit_synchronization *explicit_sync = _explicit_sync;
+	assert(wl_client && explicit_sync);
+	if (version > 1) {
+		wlr_log(L_ERROR, "Client requested unsupported zwp_linux_explicit_synchronization_v1 version, disconnecting");
+		wl_client_destroy(wl_client);
+		return;
+	}
+	struct wl_resource *wl_resource = wl_resource_create(wl_client,
+		&zwp_linux_explicit_synchronization_v1_interface, version, id);
+	if (!wl_resource) {
+		wl_client_post_no_memory(wl_client);
+		return;
+	}
+	wl_resource_set_implementation(wl_resource, &explicit_sync_impl,
+		explicit_sync, explicit_sync_resource_destroy);
+	wl_list_insert(&explicit_sync->wl_resources,
+		wl_resource_get_link(wl_resource));
+}
+
+struct wlr_linux_explicit_synchronization *
+		wlr_linux_explicit_synchronization_create(struct wl_display *display) {
+	struct wlr_linux_explicit_synchronization *explicit_sync =
+		calloc(1, sizeof(struct wlr_linux_explicit_synchronization));
+	if (!explicit_sync) {
+		return NULL;
+	}
+	wl_list_init(&explicit_sync->wl_resources);
+	explicit_sync->wl_global = wl_global_create(display,
+		&zwp_linux_explicit_synchronization_v1_interface, 1, explicit_sync,
+		explicit_sync_bind);
+	if (!explicit_sync->wl_global) {
+		free(explicit_sync);
+		return NULL;
+	}
+	return explicit_sync;
+}
+
+void wlr_linux_explicit_synchronization_destroy(
+		struct wlr_linux_explicit_synchronization *explicit_sync) {
+	if (!explicit_sync) {
+		return;
+	}
+	struct wl_resource *resource, *tmp_resource;
+	wl_resource_for_each_safe(resource, tmp_resource,
+			&explicit_sync->wl_resources) {
+		wl_resource_set_user_data(resource, NULL);
+		wl_list_remove(wl_resource_get_link(resource));
+		wl_list_init(wl_resource_get_link(resource));
+	}
+	wl_global_destroy(explicit_sync->wl_global);
+	free(explicit_sync);
+}
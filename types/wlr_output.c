@@ -1,7 +1,9 @@
+#define _POSIX_C_SOURCE 199309L
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <tgmath.h>
+#include <time.h>
 #include <wayland-server.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/interfaces/wlr_output.h>
@@ -99,6 +101,8 @@ void wlr_output_init(struct wlr_output *output,
 	output->transform = WL_OUTPUT_TRANSFORM_NORMAL;
 	wl_signal_init(&output->events.frame);
 	wl_signal_init(&output->events.resolution);
+	wl_signal_init(&output->events.present);
+	wl_signal_init(&output->events.destroy);
 }
 
 void wlr_output_enable(struct wlr_output *output, bool enable) {
@@ -175,6 +179,8 @@ void wlr_output_destroy(struct wlr_output *output) {
 		return;
 	}
 
+	wl_signal_emit(&output->events.destroy, output);
+
 	wlr_texture_destroy(output->cursor.texture);
 	wlr_renderer_destroy(output->cursor.renderer);
 
@@ -219,3 +225,26 @@ void wlr_output_swap_buffers(struct wlr_output *output) {
 
 	output->impl->swap_buffers(output);
 }
+
+void wlr_output_send_present(struct wlr_output *output, struct timespec *when,
+		unsigned seq, uint32_t flags) {
+	struct timespec now;
+	if (!when) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		when = &now;
+	}
+
+	int refresh = 0;
+	if (output->current_mode && output->current_mode->refresh > 0) {
+		refresh = 1000000000000LL / output->current_mode->refresh;
+	}
+
+	struct wlr_output_event_present event = {
+		.output = output,
+		.when = when,
+		.seq = seq,
+		.refresh = refresh,
+		.flags = flags,
+	};
+	wl_signal_emit(&output->events.present, &event);
+}
@@ -14,9 +14,117 @@ void wlr_pointer_init(struct wlr_pointer *pointer,
 }
 
 void wlr_pointer_destroy(struct wlr_pointer *pointer) {
+	if (pointer && pointer->coalesce.timer) {
+		wl_event_source_remove(pointer->coalesce.timer);
+		pointer->coalesce.timer = NULL;
+	}
 	if (pointer && pointer->impl && pointer->impl->destroy) {
 		pointer->impl->destroy(pointer);
 	} else {
 		free(pointer);
 	}
 }
+
+static void flush_motion(struct wlr_pointer *pointer) {
+	if (pointer->coalesce.has_motion) {
+		pointer->coalesce.has_motion = false;
+		wl_signal_emit(&pointer->events.motion, &pointer->coalesce.motion);
+	}
+}
+
+static void flush_motion_absolute(struct wlr_pointer *pointer) {
+	if (pointer->coalesce.has_motion_absolute) {
+		pointer->coalesce.has_motion_absolute = false;
+		wl_signal_emit(&pointer->events.motion_absolute,
+			&pointer->coalesce.motion_absolute);
+	}
+}
+
+void wlr_pointer_flush_motion(struct wlr_pointer *pointer) {
+	if (pointer->coalesce.timer_armed) {
+		wl_event_source_timer_update(pointer->coalesce.timer, 0);
+		pointer->coalesce.timer_armed = false;
+	}
+	// Only one of them is pending, the other kind flushes it when it comes
+	flush_motion(pointer);
+	flush_motion_absolute(pointer);
+}
+
+static int coalesce_timer_handle(void *data) {
+	struct wlr_pointer *pointer = data;
+	pointer->coalesce.timer_armed = false;
+	wlr_pointer_flush_motion(pointer);
+	return 0;
+}
+
+static void arm_coalesce_timer(struct wlr_pointer *pointer) {
+	if (pointer->coalesce.timer && !pointer->coalesce.timer_armed) {
+		wl_event_source_timer_update(pointer->coalesce.timer,
+			pointer->coalesce.interval_ms);
+		pointer->coalesce.timer_armed = true;
+	}
+}
+
+void wlr_pointer_set_motion_coalescing(struct wlr_pointer *pointer,
+		bool enabled, struct wl_event_loop *loop, int interval_ms) {
+	wlr_pointer_flush_motion(pointer);
+	if (pointer->coalesce.timer) {
+		wl_event_source_remove(pointer->coalesce.timer);
+		pointer->coalesce.timer = NULL;
+	}
+
+	pointer->coalesce.enabled = enabled;
+	pointer->coalesce.interval_ms = interval_ms;
+	if (enabled && loop && interval_ms > 0) {
+		pointer->coalesce.timer = wl_event_loop_add_timer(loop,
+			coalesce_timer_handle, pointer);
+	}
+}
+
+void wlr_pointer_notify_motion(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_motion *event) {
+	if (!pointer->coalesce.enabled) {
+		wl_signal_emit(&pointer->events.motion, event);
+		return;
+	}
+	flush_motion_absolute(pointer);
+
+	struct wlr_event_pointer_motion *pending = &pointer->coalesce.motion;
+	if (pointer->coalesce.has_motion) {
+		pending->time_sec = event->time_sec;
+		pending->time_usec = event->time_usec;
+		pending->delta_x += event->delta_x;
+		pending->delta_y += event->delta_y;
+		pending->unaccel_dx += event->unaccel_dx;
+		pending->unaccel_dy += event->unaccel_dy;
+	} else {
+		*pending = *event;
+		pointer->coalesce.has_motion = true;
+	}
+	arm_coalesce_timer(pointer);
+}
+
+void wlr_pointer_notify_motion_absolute(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_motion_absolute *event) {
+	if (!pointer->coalesce.enabled) {
+		wl_signal_emit(&pointer->events.motion_absolute, event);
+		return;
+	}
+	flush_motion(pointer);
+
+	pointer->coalesce.motion_absolute = *event;
+	pointer->coalesce.has_motion_absolute = true;
+	arm_coalesce_timer(pointer);
+}
+
+void wlr_pointer_notify_button(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_button *event) {
+	wlr_pointer_flush_motion(pointer);
+	wl_signal_emit(&pointer->events.button, event);
+}
+
+void wlr_pointer_notify_axis(struct wlr_pointer *pointer,
+		struct wlr_event_pointer_axis *event) {
+	wlr_pointer_flush_motion(pointer);
+	wl_signal_emit(&pointer->events.axis, event);
+}
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 199309L
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_presentation.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+#include "presentation-time-protocol.h"
+
+static void feedback_resource_destroy(struct wl_resource *resource) {
+	struct wlr_presentation_feedback *feedback =
+		wl_resource_get_user_data(resource);
+	wl_list_remove(&feedback->link);
+	wl_list_remove(&feedback->surface_commit.link);
+	wl_list_remove(&feedback->surface_destroy.link);
+	wl_list_remove(&feedback->output_present.link);
+	wl_list_remove(&feedback->output_destroy.link);
+	free(feedback);
+}
+
+static void feedback_send_discarded(struct wlr_presentation_feedback *feedback) {
+	wp_presentation_feedback_send_discarded(feedback->resource);
+	wl_resource_destroy(feedback->resource);
+}
+
+static void feedback_send_presented(struct wlr_presentation_feedback *feedback,
+		struct wlr_output_event_present *event) {
+	struct wl_client *client = wl_resource_get_client(feedback->resource);
+	struct wl_resource *output_resource;
+	wl_resource_for_each(output_resource, &event->output->wl_resources) {
+		if (wl_resource_get_client(output_resource) == client) {
+			wp_presentation_feedback_send_sync_output(feedback->resource,
+				output_resource);
+		}
+	}
+
+	uint64_t tv_sec = event->when->tv_sec;
+	uint64_t seq = event->seq;
+	wp_presentation_feedback_send_presented(feedback->resource,
+		tv_sec >> 32, tv_sec & 0xFFFFFFFF, event->when->tv_nsec,
+		event->refresh, seq >> 32, seq & 0xFFFFFFFF, event->flags);
+	wl_resource_destroy(feedback->resource);
+}
+
+static void handle_surface_commit(struct wl_listener *listener, void *data) {
+	struct wlr_presentation_feedback *feedback =
+		wl_container_of(listener, feedback, surface_commit);
+	if (!feedback->committed) {
+		feedback->committed = true;
+	} else if (!feedback->output) {
+		// Superseded by a newer commit before it made it to the screen
+		feedback_send_discarded(feedback);
+	}
+}
+
+static void handle_surface_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_presentation_feedback *feedback =
+		wl_container_of(listener, feedback, surface_destroy);
+	feedback_send_discarded(feedback);
+}
+
+static void handle_output_present(struct wl_listener *listener, void *data) {
+	struct wlr_presentation_feedback *feedback =
+		wl_container_of(listener, feedback, output_present);
+	struct wlr_output_event_present *event = data;
+	feedback_send_presented(feedback, event);
+}
+
+static void handle_output_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_presentation_feedback *feedback =
+		wl_container_of(listener, feedback, output_destroy);
+	feedback_send_discarded(feedback);
+}
+
+static void presentation_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void presentation_feedback(struct wl_client *client,
+		struct wl_resource *presentation_resource,
+		struct wl_resource *surface_resource, uint32_t id) {
+	struct wlr_presentation *presentation =
+		wl_resource_get_user_data(presentation_resource);
+	struct wlr_surface *surface = wl_resource_get_user_data(surface_resource);
+
+	if (!presentation) {
+		// The global is gone, nothing will ever be presented
+		struct wl_resource *resource = wl_resource_create(client,
+			&wp_presentation_feedback_interface,
+			wl_resource_get_version(presentation_resource), id);
+		if (!resource) {
+			wl_client_post_no_memory(client);
+			return;
+		}
+		wp_presentation_feedback_send_discarded(resource);
+		wl_resource_destroy(resource);
+		return;
+	}
+
+	struct wlr_presentation_feedback *feedback =
+		calloc(1, sizeof(struct wlr_presentation_feedback));
+	if (!feedback) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	feedback->resource = wl_resource_create(client,
+		&wp_presentation_feedback_interface,
+		wl_resource_get_version(presentation_resource), id);
+	if (!feedback->resource) {
+		free(feedback);
+		wl_client_post_no_memory(client);
+		return;
+	}
+	feedback->presentation = presentation;
+	feedback->surface = surface;
+
+	feedback->surface_commit.notify = handle_surface_commit;
+	wl_signal_add(&surface->signals.commit, &feedback->surface_commit);
+	feedback->surface_destroy.notify = handle_surface_destroy;
+	wl_resource_add_destroy_listener(surface_resource,
+		&feedback->surface_destroy);
+	wl_list_init(&feedback->output_present.link);
+	wl_list_init(&feedback->output_destroy.link);
+
+	wl_list_insert(&presentation->feedbacks, &feedback->link);
+	wl_resource_set_implementation(feedback->resource, NULL, feedback,
+		feedback_resource_destroy);
+}
+
+static const struct wp_presentation_interface presentation_impl = {
+	.destroy = presentation_destroy,
+	.feedback = presentation_feedback,
+};
+
+static void presentation_resource_destroy(struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void presentation_bind(struct wl_client *wl_client, void *_presentation,
+		uint32_t version, uint32_t id) {
+	struct wlr_presentation *presentation = _presentation;
+	assert(wl_client && presentation);
+	if (version > 1) {
+		wlr_log(L_ERROR, "Client requested unsupported wp_presentation version, disconnecting");
+		wl_client_destroy(wl_client);
+		return;
+	}
+	struct wl_resource *wl_resource = wl_resource_create(
+		wl_client, &wp_presentation_interface, version, id);
+	if (!wl_resource) {
+		wl_client_post_no_memory(wl_client);
+		return;
+	}
+	wl_resource_set_implementation(wl_resource, &presentation_impl,
+		presentation, presentation_resource_destroy);
+	wl_list_insert(&presentation->wl_resources,
+		wl_resource_get_link(wl_resource));
+	wp_presentation_send_clock_id(wl_resource, CLOCK_MONOTONIC);
+}
+
+struct wlr_presentation *wlr_presentation_create(struct wl_display *display) {
+	struct wlr_presentation *presentation =
+		calloc(1, sizeof(struct wlr_presentation));
+	if (!presentation) {
+		return NULL;
+	}
+	wl_list_init(&presentation->wl_resources);
+	wl_list_init(&presentation->feedbacks);
+	presentation->wl_global = wl_global_create(display,
+		&wp_presentation_interface, 1, presentation, presentation_bind);
+	if (!presentation->wl_global) {
+		free(presentation);
+		return NULL;
+	}
+	return presentation;
+}
+
+void wlr_presentation_destroy(struct wlr_presentation *presentation) {
+	if (!presentation) {
+		return;
+	}
+	struct wlr_presentation_feedback *feedback, *tmp_feedback;
+	wl_list_for_each_safe(feedback, tmp_feedback, &presentation->feedbacks,
+			link) {
+		feedback_send_discarded(feedback);
+	}
+	struct wl_resource *resource, *tmp_resource;
+	wl_resource_for_each_safe(resource, tmp_resource,
+			&presentation->wl_resources) {
+		wl_resource_set_user_data(resource, NULL);
+		wl_list_remove(wl_resource_get_link(resource));
+		wl_list_init(wl_resource_get_link(resource));
+	}
+	wl_global_destroy(presentation->wl_global);
+	free(presentation);
+}
+
+void wlr_presentation_surface_sampled(struct wlr_presentation *presentation,
+		struct wlr_surface *surface, struct wlr_output *output) {
+	struct wlr_presentation_feedback *feedback;
+	wl_list_for_each(feedback, &presentation->feedbacks, link) {
+		if (feedback->surface != surface || !feedback->committed ||
+				feedback->output) {
+			continue;
+		}
+		feedback->output = output;
+		feedback->output_present.notify = handle_output_present;
+		wl_signal_add(&output->events.present, &feedback->output_present);
+		feedback->output_destroy.notify = handle_output_destroy;
+		wl_signal_add(&output->events.destroy, &feedback->output_destroy);
+	}
+}
@@ -3,6 +3,72 @@
 #include <assert.h>
 #include <wayland-server.h>
 #include <pixman.h>
+#include <wlr/types/wlr_region.h>
+
+static void transform_point(enum wl_output_transform transform,
+		int32_t width, int32_t height, int32_t *x, int32_t *y) {
+	int32_t sx = *x, sy = *y;
+	switch (transform) {
+	case WL_OUTPUT_TRANSFORM_NORMAL:
+		break;
+	case WL_OUTPUT_TRANSFORM_90:
+		*x = sy;
+		*y = width - sx;
+		break;
+	case WL_OUTPUT_TRANSFORM_180:
+		*x = width - sx;
+		*y = height - sy;
+		break;
+	case WL_OUTPUT_TRANSFORM_270:
+		*x = height - sy;
+		*y = sx;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED:
+		*x = width - sx;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+		*x = sy;
+		*y = sx;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+		*y = height - sy;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+		*x = height - sy;
+		*y = width - sx;
+		break;
+	}
+}
+
+void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
+		enum wl_output_transform transform, int32_t width, int32_t height) {
+	if (transform == WL_OUTPUT_TRANSFORM_NORMAL) {
+		pixman_region32_copy(dst, src);
+		return;
+	}
+
+	int nrects;
+	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	pixman_box32_t *dst_rects = calloc(nrects > 0 ? nrects : 1,
+		sizeof(pixman_box32_t));
+	if (!dst_rects) {
+		return;
+	}
+	for (int i = 0; i < nrects; ++i) {
+		int32_t x1 = src_rects[i].x1, y1 = src_rects[i].y1;
+		int32_t x2 = src_rects[i].x2, y2 = src_rects[i].y2;
+		transform_point(transform, width, height, &x1, &y1);
+		transform_point(transform, width, height, &x2, &y2);
+		dst_rects[i].x1 = x1 < x2 ? x1 : x2;
+		dst_rects[i].y1 = y1 < y2 ? y1 : y2;
+		dst_rects[i].x2 = x1 < x2 ? x2 : x1;
+		dst_rects[i].y2 = y1 < y2 ? y2 : y1;
+	}
+
+	pixman_region32_fini(dst);
+	pixman_region32_init_rects(dst, dst_rects, nrects);
+	free(dst_rects);
+}
 
 static void region_add(struct wl_client *client, struct wl_resource *resource,
 		int32_t x, int32_t y, int32_t width, int32_t height) {
@@ -57,3 +123,57 @@ void wlr_region_create(struct wl_client *client, struct wl_resource *res,
 	wl_resource_set_implementation(region_resource, &region_interface, region,
 		destroy_region);
 }
+
+static inline uint64_t box_area(const pixman_box32_t *box) {
+	return (uint64_t)(box->x2 - box->x1) * (uint64_t)(box->y2 - box->y1);
+}
+
+static inline pixman_box32_t box_union(const pixman_box32_t *a,
+		const pixman_box32_t *b) {
+	pixman_box32_t box = {
+		.x1 = a->x1 < b->x1 ? a->x1 : b->x1,
+		.y1 = a->y1 < b->y1 ? a->y1 : b->y1,
+		.x2 = a->x2 > b->x2 ? a->x2 : b->x2,
+		.y2 = a->y2 > b->y2 ? a->y2 : b->y2,
+	};
+	return box;
+}
+
+int wlr_region_coalesce(pixman_region32_t *region,
+		const struct wlr_region_coalesce_params *params, uint32_t bpp,
+		pixman_box32_t *boxes) {
+	assert(params->max_boxes > 0);
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &nrects);
+	int nboxes = 0;
+
+	// pixman sorts rectangles top to bottom, so neighbours in the list tend
+	// to end up in the same box. Each rectangle goes into the box where it
+	// adds the fewest extra bytes, unless a separate call is cheaper.
+	for (int i = 0; i < nrects; ++i) {
+		const pixman_box32_t *rect = &rects[i];
+		int best = -1;
+		uint64_t best_cost = UINT64_MAX;
+
+		for (int j = 0; j < nboxes; ++j) {
+			pixman_box32_t merged = box_union(&boxes[j], rect);
+			uint64_t extra = box_area(&merged) - box_area(&boxes[j]);
+			uint64_t rect_area = box_area(rect);
+			extra = extra > rect_area ? (extra - rect_area) * bpp : 0;
+			if (extra < best_cost) {
+				best_cost = extra;
+				best = j;
+			}
+		}
+
+		if (best >= 0 && (best_cost < params->call_cost ||
+				nboxes == params->max_boxes)) {
+			boxes[best] = box_union(&boxes[best], rect);
+		} else {
+			boxes[nboxes++] = *rect;
+		}
+	}
+
+	return nboxes;
+}
@@ -0,0 +1,1062 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server.h>
+#include <wlr/render.h>
+#include <wlr/render/matrix.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+
+static void scene_node_init(struct wlr_scene_node *node,
+		enum wlr_scene_node_type type, struct wlr_scene_node *parent) {
+	node->type = type;
+	node->parent = parent;
+	node->enabled = true;
+	wl_list_init(&node->children);
+	wl_list_init(&node->large_link);
+	wl_signal_init(&node->events.destroy);
+	if (parent) {
+		wl_list_insert(parent->children.prev, &node->link);
+	} else {
+		wl_list_init(&node->link);
+	}
+}
+
+static struct wlr_scene *scene_node_get_root(struct wlr_scene_node *node) {
+	while (node->parent) {
+		node = node->parent;
+	}
+	assert(node->type == WLR_SCENE_NODE_ROOT);
+	return (struct wlr_scene *)node;
+}
+
+static bool scene_node_is_leaf(struct wlr_scene_node *node) {
+	return node->type == WLR_SCENE_NODE_SURFACE ||
+		node->type == WLR_SCENE_NODE_RECT ||
+		node->type == WLR_SCENE_NODE_BUFFER;
+}
+
+static void scene_node_get_size(struct wlr_scene_node *node,
+		int32_t *width, int32_t *height) {
+	*width = *height = 0;
+	switch (node->type) {
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			(struct wlr_scene_surface *)node;
+		*width = scene_surface->surface->current.width;
+		*height = scene_surface->surface->current.height;
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *rect = (struct wlr_scene_rect *)node;
+		*width = rect->width;
+		*height = rect->height;
+		break;
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *buffer = (struct wlr_scene_buffer *)node;
+		*width = buffer->texture->width;
+		*height = buffer->texture->height;
+		break;
+	default:
+		break;
+	}
+}
+
+static void scene_output_damage_whole(struct wlr_scene_output *scene_output) {
+	pixman_region32_union_rect(&scene_output->damage, &scene_output->damage,
+		0, 0, scene_output->output->width, scene_output->output->height);
+}
+
+static void scene_damage_box(struct wlr_scene *scene,
+		const pixman_box32_t *box) {
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		pixman_region32_union_rect(&scene_output->damage,
+			&scene_output->damage,
+			box->x1 - scene_output->x, box->y1 - scene_output->y,
+			box->x2 - box->x1, box->y2 - box->y1);
+		pixman_region32_intersect_rect(&scene_output->damage,
+			&scene_output->damage, 0, 0,
+			scene_output->output->width, scene_output->output->height);
+	}
+}
+
+static void scene_node_damage_subtree(struct wlr_scene *scene,
+		struct wlr_scene_node *node) {
+	if (node->indexed) {
+		scene_damage_box(scene, &node->box);
+	}
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->children, link) {
+		scene_node_damage_subtree(scene, child);
+	}
+}
+
+/*
+ * Spatial index. Leaf nodes are registered in every grid cell their box
+ * overlaps, and cells are hashed into a fixed number of buckets. Lookups at a
+ * point only look at the nodes sharing its cell, whatever the size of the
+ * scene. The few nodes covering many cells, like fullscreen windows on large
+ * outputs, are kept in a plain list instead of being registered everywhere.
+ */
+
+// Boxes are clamped to this range, so their widths and their coordinates
+// relative to an output still fit in an int32
+#define SCENE_COORD_MIN (INT32_MIN / 2)
+#define SCENE_COORD_MAX (INT32_MAX / 2)
+
+static int32_t scene_clamp_coord(int64_t v) {
+	if (v < SCENE_COORD_MIN) {
+		return SCENE_COORD_MIN;
+	}
+	if (v > SCENE_COORD_MAX) {
+		return SCENE_COORD_MAX;
+	}
+	return v;
+}
+
+static int32_t scene_cell(int32_t v) {
+	// Rounds towards negative infinity for coordinates left of the origin
+	if (v >= 0) {
+		return v / WLR_SCENE_CELL_SIZE;
+	}
+	return -((-(int64_t)v + WLR_SCENE_CELL_SIZE - 1) / WLR_SCENE_CELL_SIZE);
+}
+
+static struct wl_list *scene_bucket(struct wlr_scene *scene,
+		int32_t cx, int32_t cy) {
+	uint32_t hash = ((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u);
+	return &scene->buckets[hash & (WLR_SCENE_GRID_BUCKETS - 1)];
+}
+
+static void scene_leaf_unindex(struct wlr_scene *scene,
+		struct wlr_scene_node *node) {
+	if (!node->indexed) {
+		return;
+	}
+	scene_damage_box(scene, &node->box);
+	for (int i = 0; i < node->n_cells; ++i) {
+		wl_list_remove(&node->cells[i].link);
+	}
+	free(node->cells);
+	node->cells = NULL;
+	node->n_cells = 0;
+	wl_list_remove(&node->large_link);
+	wl_list_init(&node->large_link);
+	node->indexed = false;
+	scene->generation++;
+}
+
+static void scene_leaf_index(struct wlr_scene *scene,
+		struct wlr_scene_node *node, int64_t lx, int64_t ly) {
+	int32_t width, height;
+	scene_node_get_size(node, &width, &height);
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+	// Sizes come from clients, don't let them overflow the box
+	node->box.x1 = scene_clamp_coord(lx);
+	node->box.y1 = scene_clamp_coord(ly);
+	node->box.x2 = scene_clamp_coord(lx + width);
+	node->box.y2 = scene_clamp_coord(ly + height);
+	if (node->box.x1 >= node->box.x2 || node->box.y1 >= node->box.y2) {
+		return;
+	}
+	node->indexed = true;
+	scene->generation++;
+	scene_damage_box(scene, &node->box);
+
+	int32_t cx1 = scene_cell(node->box.x1);
+	int32_t cy1 = scene_cell(node->box.y1);
+	int32_t cx2 = scene_cell(node->box.x2 - 1);
+	int32_t cy2 = scene_cell(node->box.y2 - 1);
+	int64_t span_x = (int64_t)cx2 - cx1 + 1;
+	int64_t span_y = (int64_t)cy2 - cy1 + 1;
+	if (span_x > WLR_SCENE_MAX_NODE_CELLS ||
+			span_y > WLR_SCENE_MAX_NODE_CELLS ||
+			span_x * span_y > WLR_SCENE_MAX_NODE_CELLS) {
+		wl_list_insert(&scene->large, &node->large_link);
+		return;
+	}
+	int n = span_x * span_y;
+	node->cells = calloc(n, sizeof(struct wlr_scene_cell_ref));
+	if (!node->cells) {
+		wlr_log(L_ERROR, "Failed to allocate scene cells");
+		wl_list_insert(&scene->large, &node->large_link);
+		return;
+	}
+	node->n_cells = n;
+	int i = 0;
+	for (int32_t cy = cy1; cy <= cy2; ++cy) {
+		for (int32_t cx = cx1; cx <= cx2; ++cx) {
+			struct wlr_scene_cell_ref *ref = &node->cells[i++];
+			ref->node = node;
+			ref->cx = cx;
+			ref->cy = cy;
+			wl_list_insert(scene_bucket(scene, cx, cy), &ref->link);
+		}
+	}
+}
+
+static void scene_node_update_subtree(struct wlr_scene *scene,
+		struct wlr_scene_node *node, int64_t lx, int64_t ly, bool enabled) {
+	enabled = enabled && node->enabled;
+	lx += node->x;
+	ly += node->y;
+	if (scene_node_is_leaf(node)) {
+		scene_leaf_unindex(scene, node);
+		if (enabled) {
+			scene_leaf_index(scene, node, lx, ly);
+		}
+	}
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->children, link) {
+		scene_node_update_subtree(scene, child, lx, ly, enabled);
+	}
+}
+
+/*
+ * Reindexes the node and its children after their position, size or
+ * visibility changed. The old and new boxes are damaged.
+ */
+static void scene_node_update(struct wlr_scene_node *node) {
+	int64_t lx = 0, ly = 0;
+	bool enabled = true;
+	for (struct wlr_scene_node *p = node->parent; p; p = p->parent) {
+		lx += p->x;
+		ly += p->y;
+		enabled = enabled && p->enabled;
+	}
+	scene_node_update_subtree(scene_node_get_root(node), node,
+		lx, ly, enabled);
+}
+
+static void scene_node_number(struct wlr_scene_node *node, uint32_t *order) {
+	node->order = (*order)++;
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->children, link) {
+		scene_node_number(child, order);
+	}
+}
+
+// Stacking order is renumbered lazily, restacking is rare next to lookups
+static void scene_update_order(struct wlr_scene *scene) {
+	if (!scene->order_dirty) {
+		return;
+	}
+	uint32_t order = 0;
+	scene_node_number(&scene->node, &order);
+	scene->order_dirty = false;
+}
+
+static void scene_node_restacked(struct wlr_scene_node *node) {
+	struct wlr_scene *scene = scene_node_get_root(node);
+	scene->order_dirty = true;
+	scene->generation++;
+	scene_node_damage_subtree(scene, node);
+}
+
+struct wlr_scene *wlr_scene_create(struct wlr_renderer *renderer) {
+	struct wlr_scene *scene = calloc(1, sizeof(struct wlr_scene));
+	if (!scene) {
+		return NULL;
+	}
+	scene_node_init(&scene->node, WLR_SCENE_NODE_ROOT, NULL);
+	scene->renderer = renderer;
+	wl_list_init(&scene->outputs);
+	wl_list_init(&scene->large);
+	for (int i = 0; i < WLR_SCENE_GRID_BUCKETS; ++i) {
+		wl_list_init(&scene->buckets[i]);
+	}
+	return scene;
+}
+
+struct wlr_scene_tree *wlr_scene_tree_create(struct wlr_scene_node *parent) {
+	struct wlr_scene_tree *tree = calloc(1, sizeof(struct wlr_scene_tree));
+	if (!tree) {
+		return NULL;
+	}
+	scene_node_init(&tree->node, WLR_SCENE_NODE_TREE, parent);
+	scene_node_restacked(&tree->node);
+	return tree;
+}
+
+static void scene_surface_handle_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_surface *scene_surface =
+		wl_container_of(listener, scene_surface, surface_commit);
+	struct wlr_scene_node *node = &scene_surface->node;
+	struct wlr_surface *surface = scene_surface->surface;
+
+	if (!node->indexed ||
+			node->box.x2 - node->box.x1 != surface->current.width ||
+			node->box.y2 - node->box.y1 != surface->current.height) {
+		scene_node_update(node);
+		return;
+	}
+
+	// Same place and size, only repaint what the client damaged
+	struct wlr_scene *scene = scene_node_get_root(node);
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		pixman_region32_copy(&damage, &surface->current.surface_damage);
+		pixman_region32_translate(&damage, node->box.x1 - scene_output->x,
+			node->box.y1 - scene_output->y);
+		pixman_region32_intersect_rect(&damage, &damage, 0, 0,
+			scene_output->output->width, scene_output->output->height);
+		pixman_region32_union(&scene_output->damage, &scene_output->damage,
+			&damage);
+	}
+	pixman_region32_fini(&damage);
+}
+
+static void scene_surface_handle_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_surface *scene_surface =
+		wl_container_of(listener, scene_surface, surface_destroy);
+	wlr_scene_node_destroy(&scene_surface->node);
+}
+
+struct wlr_scene_surface *wlr_scene_surface_create(
+		struct wlr_scene_node *parent, struct wlr_surface *surface) {
+	struct wlr_scene_surface *scene_surface =
+		calloc(1, sizeof(struct wlr_scene_surface));
+	if (!scene_surface) {
+		return NULL;
+	}
+	scene_node_init(&scene_surface->node, WLR_SCENE_NODE_SURFACE, parent);
+	scene_surface->surface = surface;
+
+	scene_surface->surface_commit.notify = scene_surface_handle_commit;
+	wl_signal_add(&surface->signals.commit, &scene_surface->surface_commit);
+	scene_surface->surface_destroy.notify = scene_surface_handle_destroy;
+	wl_signal_add(&surface->signals.destroy, &scene_surface->surface_destroy);
+
+	scene_node_restacked(&scene_surface->node);
+	scene_node_update(&scene_surface->node);
+	return scene_surface;
+}
+
+struct wlr_scene_rect *wlr_scene_rect_create(struct wlr_scene_node *parent,
+		int32_t width, int32_t height, const float color[static 4]) {
+	struct wlr_scene_rect *rect = calloc(1, sizeof(struct wlr_scene_rect));
+	if (!rect) {
+		return NULL;
+	}
+	scene_node_init(&rect->node, WLR_SCENE_NODE_RECT, parent);
+	rect->width = width;
+	rect->height = height;
+	memcpy(rect->color, color, sizeof(rect->color));
+
+	scene_node_restacked(&rect->node);
+	scene_node_update(&rect->node);
+	return rect;
+}
+
+void wlr_scene_rect_set_size(struct wlr_scene_rect *rect,
+		int32_t width, int32_t height) {
+	if (rect->width == width && rect->height == height) {
+		return;
+	}
+	rect->width = width;
+	rect->height = height;
+	scene_node_update(&rect->node);
+}
+
+void wlr_scene_rect_set_color(struct wlr_scene_rect *rect,
+		const float color[static 4]) {
+	if (memcmp(rect->color, color, sizeof(rect->color)) == 0) {
+		return;
+	}
+	memcpy(rect->color, color, sizeof(rect->color));
+	if (rect->node.indexed) {
+		scene_damage_box(scene_node_get_root(&rect->node), &rect->node.box);
+	}
+}
+
+struct wlr_scene_buffer *wlr_scene_buffer_create(struct wlr_scene_node *parent,
+		struct wlr_texture *texture) {
+	struct wlr_scene_buffer *buffer =
+		calloc(1, sizeof(struct wlr_scene_buffer));
+	if (!buffer) {
+		return NULL;
+	}
+	scene_node_init(&buffer->node, WLR_SCENE_NODE_BUFFER, parent);
+	buffer->texture = texture;
+
+	scene_node_restacked(&buffer->node);
+	scene_node_update(&buffer->node);
+	return buffer;
+}
+
+void wlr_scene_node_destroy(struct wlr_scene_node *node) {
+	if (!node) {
+		return;
+	}
+	wl_signal_emit(&node->events.destroy, node);
+
+	struct wlr_scene_node *child, *tmp;
+	wl_list_for_each_safe(child, tmp, &node->children, link) {
+		wlr_scene_node_destroy(child);
+	}
+
+	if (node->type == WLR_SCENE_NODE_ROOT) {
+		struct wlr_scene *scene = (struct wlr_scene *)node;
+		struct wlr_scene_output *scene_output, *tmp_output;
+		wl_list_for_each_safe(scene_output, tmp_output, &scene->outputs,
+				link) {
+			wlr_scene_output_destroy(scene_output);
+		}
+		free(scene);
+		return;
+	}
+
+	scene_leaf_unindex(scene_node_get_root(node), node);
+	wl_list_remove(&node->link);
+	if (node->type == WLR_SCENE_NODE_SURFACE) {
+		struct wlr_scene_surface *scene_surface =
+			(struct wlr_scene_surface *)node;
+		wl_list_remove(&scene_surface->surface_commit.link);
+		wl_list_remove(&scene_surface->surface_destroy.link);
+	}
+	free(node);
+}
+
+void wlr_scene_node_set_enabled(struct wlr_scene_node *node, bool enabled) {
+	if (node->enabled == enabled) {
+		return;
+	}
+	node->enabled = enabled;
+	scene_node_update(node);
+}
+
+void wlr_scene_node_set_position(struct wlr_scene_node *node,
+		int32_t x, int32_t y) {
+	if (node->x == x && node->y == y) {
+		return;
+	}
+	node->x = x;
+	node->y = y;
+	scene_node_update(node);
+}
+
+void wlr_scene_node_place_above(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling) {
+	assert(node->parent == sibling->parent);
+	if (node == sibling || sibling->link.next == &node->link) {
+		return;
+	}
+	wl_list_remove(&node->link);
+	wl_list_insert(&sibling->link, &node->link);
+	scene_node_restacked(node);
+}
+
+void wlr_scene_node_place_below(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling) {
+	assert(node->parent == sibling->parent);
+	if (node == sibling || node->link.next == &sibling->link) {
+		return;
+	}
+	wl_list_remove(&node->link);
+	wl_list_insert(sibling->link.prev, &node->link);
+	scene_node_restacked(node);
+}
+
+void wlr_scene_node_raise_to_top(struct wlr_scene_node *node) {
+	assert(node->parent);
+	if (node->parent->children.prev == &node->link) {
+		return;
+	}
+	wl_list_remove(&node->link);
+	wl_list_insert(node->parent->children.prev, &node->link);
+	scene_node_restacked(node);
+}
+
+void wlr_scene_node_lower_to_bottom(struct wlr_scene_node *node) {
+	assert(node->parent);
+	if (node->parent->children.next == &node->link) {
+		return;
+	}
+	wl_list_remove(&node->link);
+	wl_list_insert(&node->parent->children, &node->link);
+	scene_node_restacked(node);
+}
+
+void wlr_scene_node_reparent(struct wlr_scene_node *node,
+		struct wlr_scene_node *new_parent) {
+	assert(node->parent && new_parent);
+	if (node->parent == new_parent) {
+		wlr_scene_node_raise_to_top(node);
+		return;
+	}
+	for (struct wlr_scene_node *p = new_parent; p; p = p->parent) {
+		assert(p != node);
+	}
+
+	wl_list_remove(&node->link);
+	wl_list_insert(new_parent->children.prev, &node->link);
+	node->parent = new_parent;
+	scene_node_restacked(node);
+	scene_node_update(node);
+}
+
+static bool scene_node_accepts(struct wlr_scene_node *node,
+		int32_t x, int32_t y) {
+	if (x < node->box.x1 || x >= node->box.x2 ||
+			y < node->box.y1 || y >= node->box.y2) {
+		return false;
+	}
+	if (node->type == WLR_SCENE_NODE_SURFACE) {
+		struct wlr_scene_surface *scene_surface =
+			(struct wlr_scene_surface *)node;
+		return pixman_region32_contains_point(
+			&scene_surface->surface->current.input,
+			x - node->box.x1, y - node->box.y1, NULL);
+	}
+	return true;
+}
+
+struct wlr_scene_node *wlr_scene_node_at(struct wlr_scene *scene,
+		double lx, double ly, double *nx, double *ny) {
+	scene_update_order(scene);
+	int32_t x = floor(fmax(fmin(lx, SCENE_COORD_MAX), SCENE_COORD_MIN));
+	int32_t y = floor(fmax(fmin(ly, SCENE_COORD_MAX), SCENE_COORD_MIN));
+	int32_t cx = scene_cell(x), cy = scene_cell(y);
+
+	struct wlr_scene_node *found = NULL;
+	struct wlr_scene_cell_ref *ref;
+	wl_list_for_each(ref, scene_bucket(scene, cx, cy), link) {
+		if (ref->cx != cx || ref->cy != cy) {
+			continue;
+		}
+		if ((!found || ref->node->order > found->order) &&
+				scene_node_accepts(ref->node, x, y)) {
+			found = ref->node;
+		}
+	}
+	struct wlr_scene_node *node;
+	wl_list_for_each(node, &scene->large, large_link) {
+		if ((!found || node->order > found->order) &&
+				scene_node_accepts(node, x, y)) {
+			found = node;
+		}
+	}
+
+	if (found) {
+		if (nx) {
+			*nx = lx - found->box.x1;
+		}
+		if (ny) {
+			*ny = ly - found->box.y1;
+		}
+	}
+	return found;
+}
+
+struct wlr_scene_surface *wlr_scene_surface_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_SURFACE);
+	return (struct wlr_scene_surface *)node;
+}
+
+/*
+ * Subsurface trees: a tree node per surface, holding the nodes of the
+ * subsurfaces below it, its surface node and the subsurfaces above it.
+ */
+
+struct scene_subsurface_tree {
+	struct wlr_scene_tree *tree;
+	struct wlr_scene_surface *scene_surface;
+	struct wlr_surface *surface;
+	struct wlr_subsurface *subsurface; // NULL at the root of the tree
+
+	struct scene_subsurface_tree *parent;
+	struct wl_list children; // scene_subsurface_tree::link
+	struct wl_list link;
+
+	struct wl_listener tree_destroy;
+	struct wl_listener surface_commit;
+	struct wl_listener surface_new_subsurface;
+	// The surface at the root, the subsurface role for children
+	struct wl_listener destroy;
+};
+
+static struct scene_subsurface_tree *scene_subsurface_tree_create(
+		struct wlr_scene_node *parent, struct wlr_surface *surface,
+		struct wlr_subsurface *subsurface,
+		struct scene_subsurface_tree *parent_tree);
+
+static struct wlr_scene_node *subsurface_tree_place_child(
+		struct scene_subsurface_tree *subsurface_tree,
+		struct wlr_subsurface *subsurface, struct wlr_scene_node *prev) {
+	struct scene_subsurface_tree *child;
+	wl_list_for_each(child, &subsurface_tree->children, link) {
+		if (child->subsurface == subsurface) {
+			break;
+		}
+	}
+	if (&child->link == &subsurface_tree->children) {
+		return prev;
+	}
+
+	struct wlr_scene_node *node = &child->tree->node;
+	if (prev) {
+		wlr_scene_node_place_above(node, prev);
+	} else {
+		wlr_scene_node_lower_to_bottom(node);
+	}
+	wlr_scene_node_set_position(node,
+		subsurface->current.x, subsurface->current.y);
+	return node;
+}
+
+// Applies the subsurface positions and stacking committed by the parent
+static void subsurface_tree_reconfigure(
+		struct scene_subsurface_tree *subsurface_tree) {
+	struct wlr_surface *surface = subsurface_tree->surface;
+	struct wlr_scene_node *prev = NULL;
+	struct wlr_subsurface *subsurface;
+	wl_list_for_each(subsurface, &surface->subsurfaces_below, parent_link) {
+		prev = subsurface_tree_place_child(subsurface_tree, subsurface, prev);
+	}
+
+	struct wlr_scene_node *node = &subsurface_tree->scene_surface->node;
+	if (prev) {
+		wlr_scene_node_place_above(node, prev);
+	} else {
+		wlr_scene_node_lower_to_bottom(node);
+	}
+	prev = node;
+
+	wl_list_for_each(subsurface, &surface->subsurfaces_above, parent_link) {
+		prev = subsurface_tree_place_child(subsurface_tree, subsurface, prev);
+	}
+}
+
+static void subsurface_tree_handle_tree_destroy(struct wl_listener *listener,
+		void *data) {
+	struct scene_subsurface_tree *subsurface_tree =
+		wl_container_of(listener, subsurface_tree, tree_destroy);
+	// The children are destroyed along with the tree node right after this
+	struct scene_subsurface_tree *child, *tmp;
+	wl_list_for_each_safe(child, tmp, &subsurface_tree->children, link) {
+		wl_list_remove(&child->link);
+		wl_list_init(&child->link);
+		child->parent = NULL;
+	}
+	wl_list_remove(&subsurface_tree->link);
+	wl_list_remove(&subsurface_tree->tree_destroy.link);
+	wl_list_remove(&subsurface_tree->surface_commit.link);
+	wl_list_remove(&subsurface_tree->surface_new_subsurface.link);
+	wl_list_remove(&subsurface_tree->destroy.link);
+	free(subsurface_tree);
+}
+
+static void subsurface_tree_handle_surface_commit(struct wl_listener *listener,
+		void *data) {
+	struct scene_subsurface_tree *subsurface_tree =
+		wl_container_of(listener, subsurface_tree, surface_commit);
+	subsurface_tree_reconfigure(subsurface_tree);
+}
+
+static void subsurface_tree_handle_new_subsurface(struct wl_listener *listener,
+		void *data) {
+	struct scene_subsurface_tree *subsurface_tree =
+		wl_container_of(listener, subsurface_tree, surface_new_subsurface);
+	struct wlr_subsurface *subsurface = data;
+	if (!scene_subsurface_tree_create(&subsurface_tree->tree->node,
+			subsurface->surface, subsurface, subsurface_tree)) {
+		wlr_log(L_ERROR, "Failed to add subsurface to the scene");
+		return;
+	}
+	subsurface_tree_reconfigure(subsurface_tree);
+}
+
+static void subsurface_tree_handle_destroy(struct wl_listener *listener,
+		void *data) {
+	struct scene_subsurface_tree *subsurface_tree =
+		wl_container_of(listener, subsurface_tree, destroy);
+	wlr_scene_node_destroy(&subsurface_tree->tree->node);
+}
+
+static struct scene_subsurface_tree *scene_subsurface_tree_create(
+		struct wlr_scene_node *parent, struct wlr_surface *surface,
+		struct wlr_subsurface *subsurface,
+		struct scene_subsurface_tree *parent_tree) {
+	struct scene_subsurface_tree *subsurface_tree =
+		calloc(1, sizeof(struct scene_subsurface_tree));
+	if (!subsurface_tree) {
+		return NULL;
+	}
+	subsurface_tree->tree = wlr_scene_tree_create(parent);
+	if (!subsurface_tree->tree) {
+		free(subsurface_tree);
+		return NULL;
+	}
+	subsurface_tree->scene_surface =
+		wlr_scene_surface_create(&subsurface_tree->tree->node, surface);
+	if (!subsurface_tree->scene_surface) {
+		wlr_scene_node_destroy(&subsurface_tree->tree->node);
+		free(subsurface_tree);
+		return NULL;
+	}
+	subsurface_tree->surface = surface;
+	subsurface_tree->subsurface = subsurface;
+	subsurface_tree->parent = parent_tree;
+	wl_list_init(&subsurface_tree->children);
+	if (parent_tree) {
+		wl_list_insert(&parent_tree->children, &subsurface_tree->link);
+	} else {
+		wl_list_init(&subsurface_tree->link);
+	}
+
+	subsurface_tree->tree_destroy.notify = subsurface_tree_handle_tree_destroy;
+	wl_signal_add(&subsurface_tree->tree->node.events.destroy,
+		&subsurface_tree->tree_destroy);
+	subsurface_tree->surface_commit.notify =
+		subsurface_tree_handle_surface_commit;
+	wl_signal_add(&surface->signals.commit, &subsurface_tree->surface_commit);
+	subsurface_tree->surface_new_subsurface.notify =
+		subsurface_tree_handle_new_subsurface;
+	wl_signal_add(&surface->signals.new_subsurface,
+		&subsurface_tree->surface_new_subsurface);
+	// Registered after the surface node's own listener, which goes first
+	subsurface_tree->destroy.notify = subsurface_tree_handle_destroy;
+	if (subsurface) {
+		wl_signal_add(&subsurface->signals.destroy, &subsurface_tree->destroy);
+	} else {
+		wl_signal_add(&surface->signals.destroy, &subsurface_tree->destroy);
+	}
+
+	struct wlr_subsurface *child;
+	wl_list_for_each(child, &surface->subsurfaces_below, parent_link) {
+		scene_subsurface_tree_create(&subsurface_tree->tree->node,
+			child->surface, child, subsurface_tree);
+	}
+	wl_list_for_each(child, &surface->subsurfaces_above, parent_link) {
+		scene_subsurface_tree_create(&subsurface_tree->tree->node,
+			child->surface, child, subsurface_tree);
+	}
+	subsurface_tree_reconfigure(subsurface_tree);
+	return subsurface_tree;
+}
+
+struct wlr_scene_tree *wlr_scene_subsurface_tree_create(
+		struct wlr_scene_node *parent, struct wlr_surface *surface) {
+	struct scene_subsurface_tree *subsurface_tree =
+		scene_subsurface_tree_create(parent, surface, NULL, NULL);
+	if (!subsurface_tree) {
+		return NULL;
+	}
+	return subsurface_tree->tree;
+}
+
+static void scene_output_handle_output_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_output *scene_output =
+		wl_container_of(listener, scene_output, output_destroy);
+	wlr_scene_output_destroy(scene_output);
+}
+
+static void scene_output_handle_output_resolution(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_output *scene_output =
+		wl_container_of(listener, scene_output, output_resolution);
+	scene_output->generation = scene_output->scene->generation - 1;
+	scene_output_damage_whole(scene_output);
+}
+
+struct wlr_scene_output *wlr_scene_output_create(struct wlr_scene *scene,
+		struct wlr_output *output) {
+	struct wlr_scene_output *scene_output =
+		calloc(1, sizeof(struct wlr_scene_output));
+	if (!scene_output) {
+		return NULL;
+	}
+	scene_output->output = output;
+	scene_output->scene = scene;
+	pixman_region32_init(&scene_output->damage);
+	wl_array_init(&scene_output->visible);
+	// Forces the visible list to be built on the first render
+	scene_output->generation = scene->generation - 1;
+	scene_output_damage_whole(scene_output);
+
+	scene_output->output_destroy.notify = scene_output_handle_output_destroy;
+	wl_signal_add(&output->events.destroy, &scene_output->output_destroy);
+	scene_output->output_resolution.notify =
+		scene_output_handle_output_resolution;
+	wl_signal_add(&output->events.resolution,
+		&scene_output->output_resolution);
+
+	wl_list_insert(&scene->outputs, &scene_output->link);
+	return scene_output;
+}
+
+void wlr_scene_output_destroy(struct wlr_scene_output *scene_output) {
+	if (!scene_output) {
+		return;
+	}
+	wl_list_remove(&scene_output->link);
+	wl_list_remove(&scene_output->output_destroy.link);
+	wl_list_remove(&scene_output->output_resolution.link);
+	pixman_region32_fini(&scene_output->damage);
+	wl_array_release(&scene_output->visible);
+	free(scene_output);
+}
+
+void wlr_scene_output_set_position(struct wlr_scene_output *scene_output,
+		int32_t x, int32_t y) {
+	if (scene_output->x == x && scene_output->y == y) {
+		return;
+	}
+	scene_output->x = x;
+	scene_output->y = y;
+	scene_output->generation = scene_output->scene->generation - 1;
+	scene_output_damage_whole(scene_output);
+}
+
+static int scene_node_cmp(const void *_a, const void *_b) {
+	const struct wlr_scene_node *a = *(struct wlr_scene_node *const *)_a;
+	const struct wlr_scene_node *b = *(struct wlr_scene_node *const *)_b;
+	return (a->order > b->order) - (a->order < b->order);
+}
+
+static void scene_output_add_visible(struct wlr_scene_output *scene_output,
+		struct wlr_scene_node *node, const pixman_box32_t *box) {
+	if (node->visit == scene_output->scene->visit ||
+			node->box.x2 <= box->x1 || box->x2 <= node->box.x1 ||
+			node->box.y2 <= box->y1 || box->y2 <= node->box.y1) {
+		return;
+	}
+	node->visit = scene_output->scene->visit;
+	struct wlr_scene_node **entry =
+		wl_array_add(&scene_output->visible, sizeof(*entry));
+	if (entry) {
+		*entry = node;
+	}
+}
+
+/*
+ * Rebuilds the list of nodes intersecting the output from the cells it
+ * covers, only when nodes were added, moved, resized or restacked since.
+ */
+static void scene_output_update_visible(struct wlr_scene_output *scene_output) {
+	struct wlr_scene *scene = scene_output->scene;
+	if (scene_output->generation == scene->generation) {
+		return;
+	}
+	scene_output->generation = scene->generation;
+	scene_update_order(scene);
+	scene_output->visible.size = 0;
+	// Nodes spanning several cells are only added once
+	scene->visit++;
+
+	pixman_box32_t box = {
+		.x1 = scene_clamp_coord(scene_output->x),
+		.y1 = scene_clamp_coord(scene_output->y),
+		.x2 = scene_clamp_coord((int64_t)scene_output->x +
+			scene_output->output->width),
+		.y2 = scene_clamp_coord((int64_t)scene_output->y +
+			scene_output->output->height),
+	};
+	if (box.x2 <= box.x1 || box.y2 <= box.y1) {
+		return;
+	}
+	int32_t cx1 = scene_cell(box.x1), cy1 = scene_cell(box.y1);
+	int32_t cx2 = scene_cell(box.x2 - 1), cy2 = scene_cell(box.y2 - 1);
+	for (int32_t cy = cy1; cy <= cy2; ++cy) {
+		for (int32_t cx = cx1; cx <= cx2; ++cx) {
+			struct wlr_scene_cell_ref *ref;
+			wl_list_for_each(ref, scene_bucket(scene, cx, cy), link) {
+				if (ref->cx == cx && ref->cy == cy) {
+					scene_output_add_visible(scene_output, ref->node, &box);
+				}
+			}
+		}
+	}
+	struct wlr_scene_node *node;
+	wl_list_for_each(node, &scene->large, large_link) {
+		scene_output_add_visible(scene_output, node, &box);
+	}
+
+	qsort(scene_output->visible.data,
+		scene_output->visible.size / sizeof(struct wlr_scene_node *),
+		sizeof(struct wlr_scene_node *), scene_node_cmp);
+}
+
+static void scene_surface_flush(struct wlr_scene_surface *scene_surface) {
+	struct wlr_scene_node *node = &scene_surface->node;
+	struct wlr_surface *surface = scene_surface->surface;
+
+	wlr_surface_flush_damage(surface);
+	if (node->box.x2 - node->box.x1 != surface->current.width ||
+			node->box.y2 - node->box.y1 != surface->current.height) {
+		// The size of some buffers is only known once they're uploaded
+		scene_node_update(node);
+	}
+}
+
+static void scene_node_add_opaque(struct wlr_scene_node *node,
+		pixman_region32_t *opaque, int32_t x, int32_t y) {
+	int32_t width = node->box.x2 - node->box.x1;
+	int32_t height = node->box.y2 - node->box.y1;
+	switch (node->type) {
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_surface *surface =
+			((struct wlr_scene_surface *)node)->surface;
+		if (!surface->texture->valid) {
+			break;
+		}
+		pixman_region32_t region;
+		pixman_region32_init(&region);
+		pixman_region32_intersect_rect(&region, &surface->current.opaque,
+			0, 0, width, height);
+		pixman_region32_translate(&region, x, y);
+		pixman_region32_union(opaque, opaque, &region);
+		pixman_region32_fini(&region);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *rect = (struct wlr_scene_rect *)node;
+		if (rect->color[3] == 1.0f) {
+			pixman_region32_union_rect(opaque, opaque, x, y, width, height);
+		}
+		break;
+	default:
+		// Buffers may have an alpha channel
+		break;
+	}
+}
+
+/*
+ * Uploads the pending buffers of the visible surfaces, then goes through the
+ * nodes top to bottom and marks those hidden behind opaque nodes above them.
+ * occluded may be NULL to only upload.
+ */
+static void scene_output_cull(struct wlr_scene_output *scene_output,
+		struct wlr_scene_node **nodes, size_t n, bool *occluded) {
+	struct wlr_output *output = scene_output->output;
+	pixman_region32_t opaque, region;
+	pixman_region32_init(&opaque);
+	pixman_region32_init(&region);
+	for (size_t i = n; i-- > 0;) {
+		struct wlr_scene_node *node = nodes[i];
+		if (node->type == WLR_SCENE_NODE_SURFACE) {
+			scene_surface_flush((struct wlr_scene_surface *)node);
+		}
+		if (!occluded) {
+			continue;
+		}
+		if (!node->indexed) {
+			// Lost its size while uploading
+			occluded[i] = true;
+			continue;
+		}
+
+		int32_t x = node->box.x1 - scene_output->x;
+		int32_t y = node->box.y1 - scene_output->y;
+		pixman_region32_fini(&region);
+		pixman_region32_init_rect(&region, x, y,
+			node->box.x2 - node->box.x1, node->box.y2 - node->box.y1);
+		pixman_region32_intersect_rect(&region, &region, 0, 0,
+			output->width, output->height);
+		pixman_region32_subtract(&region, &region, &opaque);
+		occluded[i] = !pixman_region32_not_empty(&region);
+		if (!occluded[i]) {
+			scene_node_add_opaque(node, &opaque, x, y);
+		}
+	}
+	pixman_region32_fini(&region);
+	pixman_region32_fini(&opaque);
+}
+
+static void scene_surface_render(struct wlr_scene_surface *scene_surface,
+		struct wlr_scene_output *scene_output, int32_t x, int32_t y,
+		const struct timespec *now) {
+	struct wlr_surface *surface = scene_surface->surface;
+	struct wlr_output *output = scene_output->output;
+
+	if (!surface->texture->valid) {
+		return;
+	}
+
+	float matrix[16];
+	wlr_surface_get_matrix(surface, &matrix, &output->transform_matrix, x, y);
+	wlr_render_with_texcoord_matrix(scene_output->scene->renderer,
+		surface->texture, &matrix, &surface->texcoord_matrix);
+	wlr_surface_send_frame_done(surface, now);
+}
+
+void wlr_scene_output_render(struct wlr_scene_output *scene_output,
+		const struct timespec *now) {
+	struct wlr_output *output = scene_output->output;
+	struct wlr_renderer *renderer = scene_output->scene->renderer;
+	scene_output_update_visible(scene_output);
+
+	// The list stays valid while rendering, nodes resized by a late upload
+	// show up in the next one
+	struct wlr_scene_node **nodes = scene_output->visible.data;
+	size_t n = scene_output->visible.size / sizeof(*nodes);
+	// Hidden nodes are neither drawn nor sent frame callbacks, so hidden
+	// surfaces are throttled like unmapped ones
+	bool *occluded = n > 0 ? calloc(n, sizeof(bool)) : NULL;
+	if (n > 0 && !occluded) {
+		wlr_log(L_ERROR, "Allocation failed, rendering hidden nodes too");
+	}
+	scene_output_cull(scene_output, nodes, n, occluded);
+	for (size_t i = 0; i < n; ++i) {
+		struct wlr_scene_node *node = nodes[i];
+		if (occluded && occluded[i]) {
+			continue;
+		}
+		int32_t x = node->box.x1 - scene_output->x;
+		int32_t y = node->box.y1 - scene_output->y;
+		float matrix[16], view[16];
+		switch (node->type) {
+		case WLR_SCENE_NODE_SURFACE:
+			scene_surface_render((struct wlr_scene_surface *)node,
+				scene_output, x, y, now);
+			break;
+		case WLR_SCENE_NODE_RECT:;
+			struct wlr_scene_rect *rect = (struct wlr_scene_rect *)node;
+			wlr_matrix_translate(&matrix, x, y, 0);
+			wlr_matrix_scale(&view, rect->width, rect->height, 1);
+			wlr_matrix_mul(&matrix, &view, &view);
+			wlr_matrix_mul(&output->transform_matrix, &view, &matrix);
+			wlr_render_colored_quad(renderer, &rect->color, &matrix);
+			break;
+		case WLR_SCENE_NODE_BUFFER:;
+			struct wlr_scene_buffer *buffer = (struct wlr_scene_buffer *)node;
+			wlr_texture_get_matrix(buffer->texture, &matrix,
+				&output->transform_matrix, x, y);
+			wlr_render_with_matrix(renderer, buffer->texture, &matrix);
+			break;
+		default:
+			break;
+		}
+	}
+	free(occluded);
+
+	pixman_region32_clear(&scene_output->damage);
+}
+
+void wlr_scene_output_for_each_surface(struct wlr_scene_output *scene_output,
+		void (*iterator)(struct wlr_surface *surface, int sx, int sy,
+			void *data),
+		void *data) {
+	struct wlr_scene_node **nodes = scene_output->visible.data;
+	size_t n = scene_output->visible.size / sizeof(*nodes);
+	for (size_t i = 0; i < n; ++i) {
+		struct wlr_scene_node *node = nodes[i];
+		if (node->type != WLR_SCENE_NODE_SURFACE) {
+			continue;
+		}
+		struct wlr_scene_surface *scene_surface =
+			(struct wlr_scene_surface *)node;
+		iterator(scene_surface->surface, node->box.x1 - scene_output->x,
+			node->box.y1 - scene_output->y, data);
+	}
+}
@@ -0,0 +1,119 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_subcompositor.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+
+static const char *subsurface_role = "wl_subsurface";
+
+static bool surface_is_ancestor(struct wlr_surface *ancestor,
+		struct wlr_surface *surface) {
+	while (surface) {
+		if (surface == ancestor) {
+			return true;
+		}
+		if (!surface->subsurface) {
+			return false;
+		}
+		surface = surface->subsurface->parent;
+	}
+	return false;
+}
+
+static void subcompositor_get_subsurface(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource,
+		struct wl_resource *parent_resource) {
+	struct wlr_surface *surface = wl_resource_get_user_data(surface_resource);
+	struct wlr_surface *parent = wl_resource_get_user_data(parent_resource);
+
+	if (surface->subsurface) {
+		wl_resource_post_error(resource, WL_SUBCOMPOSITOR_ERROR_BAD_SURFACE,
+			"wl_surface@%d is already a subsurface",
+			wl_resource_get_id(surface_resource));
+		return;
+	}
+	if (surface->role && strcmp(surface->role, subsurface_role) != 0) {
+		wl_resource_post_error(resource, WL_SUBCOMPOSITOR_ERROR_BAD_SURFACE,
+			"wl_surface@%d already has the role %s",
+			wl_resource_get_id(surface_resource), surface->role);
+		return;
+	}
+	if (surface_is_ancestor(surface, parent)) {
+		wl_resource_post_error(resource, WL_SUBCOMPOSITOR_ERROR_BAD_SURFACE,
+			"wl_surface@%d is an ancestor of parent wl_surface@%d",
+			wl_resource_get_id(surface_resource),
+			wl_resource_get_id(parent_resource));
+		return;
+	}
+
+	wlr_surface_make_subsurface(surface, parent, id);
+}
+
+static void subcompositor_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static const struct wl_subcompositor_interface subcompositor_impl = {
+	.destroy = subcompositor_destroy,
+	.get_subsurface = subcompositor_get_subsurface,
+};
+
+static void subcompositor_resource_destroy(struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void subcompositor_bind(struct wl_client *wl_client,
+		void *_subcompositor, uint32_t version, uint32_t id) {
+	struct wlr_subcompositor *subcompositor = _subcompositor;
+	assert(wl_client && subcompositor);
+	if (version > 1) {
+		wlr_log(L_ERROR, "Client requested unsupported wl_subcompositor version, disconnecting");
+		wl_client_destroy(wl_client);
+		return;
+	}
+	struct wl_resource *wl_resource = wl_resource_create(
+		wl_client, &wl_subcompositor_interface, version, id);
+	if (!wl_resource) {
+		wl_client_post_no_memory(wl_client);
+		return;
+	}
+	wl_resource_set_implementation(wl_resource, &subcompositor_impl,
+		subcompositor, subcompositor_resource_destroy);
+	wl_list_insert(&subcompositor->wl_resources,
+		wl_resource_get_link(wl_resource));
+}
+
+struct wlr_subcompositor *wlr_subcompositor_create(struct wl_display *display) {
+	struct wlr_subcompositor *subcompositor =
+		calloc(1, sizeof(struct wlr_subcompositor));
+	if (!subcompositor) {
+		return NULL;
+	}
+	wl_list_init(&subcompositor->wl_resources);
+	subcompositor->wl_global = wl_global_create(display,
+		&wl_subcompositor_interface, 1, subcompositor, subcompositor_bind);
+	if (!subcompositor->wl_global) {
+		free(subcompositor);
+		return NULL;
+	}
+	return subcompositor;
+}
+
+void wlr_subcompositor_destroy(struct wlr_subcompositor *subcompositor) {
+	if (!subcompositor) {
+		return;
+	}
+	struct wl_resource *resource, *tmp_resource;
+	wl_resource_for_each_safe(resource, tmp_resource,
+			&subcompositor->wl_resources) {
+		wl_resource_set_user_data(resource, NULL);
+		wl_list_remove(wl_resource_get_link(resource));
+		wl_list_init(wl_resource_get_link(resource));
+	}
+	wl_global_destroy(subcompositor->wl_global);
+	free(subcompositor);
+}
@@ -1,9 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <wayland-server.h>
 #include <wlr/util/log.h>
 #include <wlr/egl.h>
 #include <wlr/render/interface.h>
+#include <wlr/render/matrix.h>
+#include <wlr/types/wlr_linux_dmabuf.h>
+#include <wlr/types/wlr_linux_explicit_synchronization.h>
 #include <wlr/types/wlr_surface.h>
 
 static void surface_destroy(struct wl_client *client, struct wl_resource *resource) {
@@ -59,7 +65,7 @@ static void surface_frame(struct wl_client *client,
 	wl_resource_set_implementation(cb->resource,
 			NULL, cb, destroy_frame_callback);
 
-	wl_list_insert(surface->frame_callback_list.prev, &cb->link);
+	wl_list_insert(surface->pending.frame_callback_list.prev, &cb->link);
 }
 
 static void surface_set_opaque_region(struct wl_client *client,
@@ -90,55 +96,618 @@ static void surface_set_input_region(struct wl_client *client,
 	}
 }
 
-static void surface_commit(struct wl_client *client,
-		struct wl_resource *resource) {
-	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+/*
+ * Recomputes the surface size and the matrices converting between surface
+ * and buffer coordinates from the current buffer size, transform, scale and
+ * viewport.
+ */
+static void surface_update_matrices(struct wlr_surface *surface) {
+	struct wlr_surface_state *state = &surface->current;
+	int32_t scale = state->scale;
+	int32_t width = state->buffer_width / scale;
+	int32_t height = state->buffer_height / scale;
+	if (state->transform % 2 == 1) {
+		int32_t tmp = width;
+		width = height;
+		height = tmp;
+	}
+
+	// Surface to unscaled buffer coordinates:
+	// bx = r[0] * sx + r[1] * sy + t[0], by = r[2] * sx + r[3] * sy + t[1]
+	float transform[16];
+	wlr_matrix_buffer_transform(transform, state->transform, width, height);
+	float r[4] = { transform[0], transform[1], transform[4], transform[5] };
+	float t[2] = { transform[3], transform[7] };
+
+	// The viewport maps the surface onto its source rectangle first:
+	// vx = sx * v[0] + o[0], vy = sy * v[1] + o[1]
+	float src_width = width, src_height = height;
+	float o[2] = { 0, 0 };
+	if (state->viewport.has_src) {
+		src_width = state->viewport.src_width;
+		src_height = state->viewport.src_height;
+		o[0] = state->viewport.src_x;
+		o[1] = state->viewport.src_y;
+	}
+	if (state->viewport.has_dst) {
+		state->width = state->viewport.dst_width;
+		state->height = state->viewport.dst_height;
+	} else {
+		state->width = src_width;
+		state->height = src_height;
+	}
+	float v[2] = { 1, 1 };
+	if (state->width > 0 && state->height > 0) {
+		v[0] = src_width / state->width;
+		v[1] = src_height / state->height;
+	}
+
+	float *to_buffer = surface->surface_to_buffer_matrix;
+	wlr_matrix_identity(&surface->surface_to_buffer_matrix);
+	to_buffer[0] = scale * r[0] * v[0];
+	to_buffer[1] = scale * r[1] * v[1];
+	to_buffer[3] = scale * (r[0] * o[0] + r[1] * o[1] + t[0]);
+	to_buffer[4] = scale * r[2] * v[0];
+	to_buffer[5] = scale * r[3] * v[1];
+	to_buffer[7] = scale * (r[2] * o[0] + r[3] * o[1] + t[1]);
+
+	// r is orthogonal, so its inverse is its transpose
+	float *to_surface = surface->buffer_to_surface_matrix;
+	wlr_matrix_identity(&surface->buffer_to_surface_matrix);
+	to_surface[0] = r[0] / (scale * v[0]);
+	to_surface[1] = r[2] / (scale * v[0]);
+	to_surface[3] = (-(r[0] * t[0] + r[2] * t[1]) - o[0]) / v[0];
+	to_surface[4] = r[1] / (scale * v[1]);
+	to_surface[5] = r[3] / (scale * v[1]);
+	to_surface[7] = (-(r[1] * t[0] + r[3] * t[1]) - o[1]) / v[1];
+
+	// Same as surface_to_buffer, from the unit square to [0, 1] texture
+	// coordinates
+	float *texcoord = surface->texcoord_matrix;
+	wlr_matrix_identity(&surface->texcoord_matrix);
+	if (state->buffer_width > 0 && state->buffer_height > 0) {
+		float bw = state->buffer_width, bh = state->buffer_height;
+		texcoord[0] = to_buffer[0] * state->width / bw;
+		texcoord[1] = to_buffer[1] * state->height / bw;
+		texcoord[3] = to_buffer[3] / bw;
+		texcoord[4] = to_buffer[4] * state->width / bh;
+		texcoord[5] = to_buffer[5] * state->height / bh;
+		texcoord[7] = to_buffer[7] / bh;
+	}
+}
+
+void wlr_surface_send_frame_done(struct wlr_surface *surface,
+		const struct timespec *when) {
+	uint32_t msec = (uint32_t)when->tv_sec * 1000 + when->tv_nsec / 1000000;
+	struct wlr_frame_callback *cb, *next;
+	wl_list_for_each_safe(cb, next, &surface->frame_callback_list, link) {
+		wl_callback_send_done(cb->resource, msec);
+		wl_resource_destroy(cb->resource);
+	}
+	if (surface->frame_timer_armed) {
+		wl_event_source_timer_update(surface->frame_timer, 0);
+		surface->frame_timer_armed = false;
+	}
+}
 
-	if ((surface->pending.invalid & WLR_SURFACE_INVALID_BUFFER)) {
-		surface->current.buffer = surface->pending.buffer;
+static int handle_frame_timer(void *data) {
+	struct wlr_surface *surface = data;
+	// Not presented for a whole interval, the surface is hidden
+	surface->frame_timer_armed = false;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wlr_surface_send_frame_done(surface, &now);
+	return 0;
+}
+
+/*
+ * Starts the hidden surface timeout for the callbacks of a new commit, unless
+ * it's already running for older ones.
+ */
+static void surface_arm_frame_timer(struct wlr_surface *surface) {
+	if (surface->frame_timer_armed ||
+			wl_list_empty(&surface->frame_callback_list)) {
+		return;
 	}
-	if ((surface->pending.invalid & WLR_SURFACE_INVALID_SURFACE_DAMAGE)) {
-		// TODO: Sort out buffer damage too
-		pixman_region32_union(&surface->current.surface_damage,
-				&surface->current.surface_damage,
-				&surface->pending.surface_damage);
-		// TODO: Surface sizing is complicated
-		//pixman_region32_intersect_rect(&surface->current.surface_damage,
-		//		&surface->current.surface_damage,
-		//		0, 0, surface->width, surface->height);
-		pixman_region32_clear(&surface->pending.surface_damage);
+	if (!surface->frame_timer) {
+		struct wl_client *client = wl_resource_get_client(surface->resource);
+		struct wl_event_loop *loop =
+			wl_display_get_event_loop(wl_client_get_display(client));
+		surface->frame_timer = wl_event_loop_add_timer(loop,
+			handle_frame_timer, surface);
+		if (!surface->frame_timer) {
+			wlr_log(L_ERROR, "Failed to create frame callback timer");
+			return;
+		}
 	}
-	// TODO: Commit other changes
+	wl_event_source_timer_update(surface->frame_timer,
+		surface->hidden_frame_interval);
+	surface->frame_timer_armed = true;
+}
+
+// Keeps transformed coordinates far enough inside the int32 range that
+// pixman can still compute x + width
+#define TRANSFORM_COORD_MAX (1 << 29)
+
+static float clamp_coord(float v) {
+	return fminf(fmaxf(v, -TRANSFORM_COORD_MAX), TRANSFORM_COORD_MAX);
+}
+
+/*
+ * Adds src, transformed by mat, to dst. Rectangles are rounded outwards,
+ * so fractional results still cover all affected pixels.
+ */
+static void transform_region(pixman_region32_t *dst, pixman_region32_t *src,
+		const float mat[static 16]) {
+	int n;
+	pixman_box32_t *rects = pixman_region32_rectangles(src, &n);
+	for (int i = 0; i < n; ++i) {
+		float x1 = mat[0] * rects[i].x1 + mat[1] * rects[i].y1 + mat[3];
+		float y1 = mat[4] * rects[i].x1 + mat[5] * rects[i].y1 + mat[7];
+		float x2 = mat[0] * rects[i].x2 + mat[1] * rects[i].y2 + mat[3];
+		float y2 = mat[4] * rects[i].x2 + mat[5] * rects[i].y2 + mat[7];
 
-	surface->pending.invalid = 0;
+		int32_t x = floorf(clamp_coord(fminf(x1, x2)));
+		int32_t y = floorf(clamp_coord(fminf(y1, y2)));
+		int32_t w = (int32_t)ceilf(clamp_coord(fmaxf(x1, x2))) - x;
+		int32_t h = (int32_t)ceilf(clamp_coord(fmaxf(y1, y2))) - y;
+		pixman_region32_union_rect(dst, dst, x, y, w, h);
+	}
+}
+
+static void surface_clear_acquire_fence(struct wlr_surface *surface) {
+	if (surface->acquire_source) {
+		wl_event_source_remove(surface->acquire_source);
+		surface->acquire_source = NULL;
+	}
+}
+
+static void surface_apply_queue(struct wlr_surface *surface);
+
+static int handle_acquire_fence(int fd, uint32_t mask, void *data) {
+	// sync_files become readable once they signal
+	struct wlr_surface *surface = data;
+	struct wlr_surface_state *state =
+		wl_container_of(surface->state_queue.next, state, link);
+	surface_clear_acquire_fence(surface);
+	close(state->acquire_fence);
+	state->acquire_fence = -1;
+	surface_apply_queue(surface);
+	return 0;
+}
+
+/*
+ * Waits for the acquire fence of the oldest queued state. Later states are
+ * applied in order after it, so their fences are only waited on once they
+ * reach the front of the queue.
+ */
+static void surface_wait_acquire_fence(struct wlr_surface *surface,
+		struct wlr_surface_state *state) {
+	if (surface->acquire_source) {
+		return;
+	}
+	struct wl_client *client = wl_resource_get_client(surface->resource);
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(wl_client_get_display(client));
+	surface->acquire_source = wl_event_loop_add_fd(loop,
+		state->acquire_fence, WL_EVENT_READABLE,
+		handle_acquire_fence, surface);
+	if (!surface->acquire_source) {
+		// Fall back to implicit synchronization
+		wlr_log(L_ERROR, "Failed to wait on acquire fence");
+		close(state->acquire_fence);
+		state->acquire_fence = -1;
+	}
+}
+
+// Sends the explicit release for the buffer the texture samples from. The
+// fence covers every frame rendered with it so far.
+static void surface_release_texture_buffer(struct wlr_surface *surface) {
+	if (!surface->texture_release) {
+		return;
+	}
+	int fence = wlr_renderer_create_fence(surface->renderer);
+	wlr_linux_buffer_release_send(surface->texture_release, fence);
+	if (fence >= 0) {
+		close(fence);
+	}
+	surface->texture_release = NULL;
+}
+
+static void surface_handle_texture_buffer_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_surface *surface =
+		wl_container_of(listener, surface, texture_buffer_destroy);
+	wl_list_remove(&listener->link);
+	wl_list_init(&listener->link);
+	surface->texture_buffer = NULL;
+}
+
+// GPU buffers are sampled in place, so unlike shm copies they only get their
+// wl_buffer.release once the texture moves on to another buffer
+static void surface_set_texture_buffer(struct wlr_surface *surface,
+		struct wl_resource *buffer) {
+	if (buffer == surface->texture_buffer) {
+		return;
+	}
+	if (surface->texture_buffer) {
+		wl_resource_queue_event(surface->texture_buffer, WL_BUFFER_RELEASE);
+		wl_list_remove(&surface->texture_buffer_destroy.link);
+		wl_list_init(&surface->texture_buffer_destroy.link);
+	}
+	surface->texture_buffer = buffer;
+	if (buffer) {
+		wl_resource_add_destroy_listener(buffer,
+			&surface->texture_buffer_destroy);
+	}
+}
+
+static void surface_commit_subsurfaces(struct wlr_surface *surface);
+
+/*
+ * Applies next, the pending state or a queued one, to the current state. Only
+ * the fields marked invalid in next are touched.
+ */
+static void surface_commit_state(struct wlr_surface *surface,
+		struct wlr_surface_state *next) {
+	struct wlr_surface_state *current = &surface->current;
+	bool update_matrices = false;
+
+	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER)) {
+		// A buffer that never made it into the texture was never read
+		if (current->buffer_release) {
+			wlr_linux_buffer_release_send(current->buffer_release, -1);
+		}
+		current->buffer_release = next->buffer_release;
+		next->buffer_release = NULL;
+
+		current->invalid |= WLR_SURFACE_INVALID_BUFFER;
+		current->buffer = next->buffer;
+		struct wl_shm_buffer *buffer = current->buffer ?
+			wl_shm_buffer_get(current->buffer) : NULL;
+		if (buffer) {
+			current->buffer_width = wl_shm_buffer_get_width(buffer);
+			current->buffer_height = wl_shm_buffer_get_height(buffer);
+		} else if (!current->buffer) {
+			current->buffer_width = current->buffer_height = 0;
+		}
+		// The size of other buffers is known once they're uploaded
+		update_matrices = true;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_SCALE)) {
+		current->scale = next->scale;
+		update_matrices = true;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_TRANSFORM)) {
+		current->transform = next->transform;
+		update_matrices = true;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_VIEWPORT)) {
+		current->viewport = next->viewport;
+		update_matrices = true;
+	}
+	if (update_matrices) {
+		surface_update_matrices(surface);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_VIEWPORT)) {
+		// The contents are rescaled, but the buffer doesn't change
+		pixman_region32_union_rect(&current->surface_damage,
+				&current->surface_damage, 0, 0,
+				current->width, current->height);
+	}
+
+	// Clip before transforming, clients commonly damage with INT32_MAX
+	// sizes that don't survive the transform
+	if (current->buffer_width > 0 && current->buffer_height > 0) {
+		pixman_region32_intersect_rect(&next->surface_damage,
+				&next->surface_damage, 0, 0,
+				current->width, current->height);
+		pixman_region32_intersect_rect(&next->buffer_damage,
+				&next->buffer_damage, 0, 0,
+				current->buffer_width, current->buffer_height);
+	}
+
+	// Track damage in both coordinate spaces: uploads need buffer pixels,
+	// compositors repaint surface coordinates
+	if ((next->invalid & WLR_SURFACE_INVALID_SURFACE_DAMAGE)) {
+		pixman_region32_union(&current->surface_damage,
+				&current->surface_damage, &next->surface_damage);
+		transform_region(&current->buffer_damage, &next->surface_damage,
+				surface->surface_to_buffer_matrix);
+		pixman_region32_clear(&next->surface_damage);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER_DAMAGE)) {
+		pixman_region32_union(&current->buffer_damage,
+				&current->buffer_damage, &next->buffer_damage);
+		transform_region(&current->surface_damage, &next->buffer_damage,
+				surface->buffer_to_surface_matrix);
+		pixman_region32_clear(&next->buffer_damage);
+	}
+	if (current->buffer_width > 0 && current->buffer_height > 0) {
+		pixman_region32_intersect_rect(&current->buffer_damage,
+				&current->buffer_damage, 0, 0,
+				current->buffer_width, current->buffer_height);
+		pixman_region32_intersect_rect(&current->surface_damage,
+				&current->surface_damage, 0, 0,
+				current->width, current->height);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_OPAQUE_REGION)) {
+		pixman_region32_copy(&current->opaque, &next->opaque);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_INPUT_REGION)) {
+		pixman_region32_copy(&current->input, &next->input);
+	}
+
+	wl_list_insert_list(surface->frame_callback_list.prev,
+		&next->frame_callback_list);
+	wl_list_init(&next->frame_callback_list);
+
+	next->invalid = 0;
+	surface_arm_frame_timer(surface);
 	// TODO: add the invalid bitfield to this callback
 	wl_signal_emit(&surface->signals.commit, surface);
+
+	surface_commit_subsurfaces(surface);
 }
 
-void wlr_surface_flush_damage(struct wlr_surface *surface) {
-	if (!surface->current.buffer) {
-		if (surface->texture->valid) {
-			// TODO: Detach buffers
+/*
+ * Accumulates next into state without applying it, for queued states.
+ * Replaced buffers were never read and are released right away.
+ */
+static void surface_state_move(struct wlr_surface *surface,
+		struct wlr_surface_state *state, struct wlr_surface_state *next) {
+	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER)) {
+		if (state->acquire_fence >= 0) {
+			close(state->acquire_fence);
+		}
+		if (state->buffer_release) {
+			wlr_linux_buffer_release_send(state->buffer_release, -1);
+		}
+		if (state->buffer && state->buffer != next->buffer &&
+				state->buffer != surface->current.buffer &&
+				state->buffer != surface->texture_buffer) {
+			wl_resource_queue_event(state->buffer, WL_BUFFER_RELEASE);
+		}
+		state->buffer = next->buffer;
+		state->acquire_fence = next->acquire_fence;
+		state->buffer_release = next->buffer_release;
+		next->acquire_fence = -1;
+		next->buffer_release = NULL;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_SURFACE_DAMAGE)) {
+		pixman_region32_union(&state->surface_damage,
+				&state->surface_damage, &next->surface_damage);
+		pixman_region32_clear(&next->surface_damage);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER_DAMAGE)) {
+		pixman_region32_union(&state->buffer_damage,
+				&state->buffer_damage, &next->buffer_damage);
+		pixman_region32_clear(&next->buffer_damage);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_OPAQUE_REGION)) {
+		pixman_region32_copy(&state->opaque, &next->opaque);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_INPUT_REGION)) {
+		pixman_region32_copy(&state->input, &next->input);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_TRANSFORM)) {
+		state->transform = next->transform;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_SCALE)) {
+		state->scale = next->scale;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_VIEWPORT)) {
+		state->viewport = next->viewport;
+	}
+	wl_list_insert_list(state->frame_callback_list.prev,
+		&next->frame_callback_list);
+	wl_list_init(&next->frame_callback_list);
+	state->invalid |= next->invalid;
+	next->invalid = 0;
+}
+
+// Beyond this, commits are merged into the newest queued state regardless
+#define SURFACE_MAX_QUEUED 8
+
+static void surface_state_init(struct wlr_surface_state *state) {
+	state->scale = 1;
+	state->transform = WL_OUTPUT_TRANSFORM_NORMAL;
+	state->acquire_fence = -1;
+	wl_list_init(&state->frame_callback_list);
+	wl_list_init(&state->link);
+	pixman_region32_init(&state->surface_damage);
+	pixman_region32_init(&state->buffer_damage);
+	pixman_region32_init(&state->opaque);
+	pixman_region32_init_rect(&state->input,
+		INT32_MIN, INT32_MIN, UINT32_MAX, UINT32_MAX);
+}
+
+static void surface_state_finish(struct wlr_surface_state *state) {
+	if (state->acquire_fence >= 0) {
+		close(state->acquire_fence);
+		state->acquire_fence = -1;
+	}
+	if (state->buffer_release) {
+		wlr_linux_buffer_release_send(state->buffer_release, -1);
+	}
+	struct wlr_frame_callback *cb, *next;
+	wl_list_for_each_safe(cb, next, &state->frame_callback_list, link) {
+		wl_resource_destroy(cb->resource);
+	}
+	pixman_region32_fini(&state->surface_damage);
+	pixman_region32_fini(&state->buffer_damage);
+	pixman_region32_fini(&state->opaque);
+	pixman_region32_fini(&state->input);
+}
+
+static struct wlr_surface_state *surface_state_create(void) {
+	struct wlr_surface_state *state =
+		calloc(1, sizeof(struct wlr_surface_state));
+	if (!state) {
+		return NULL;
+	}
+	surface_state_init(state);
+	return state;
+}
+
+static void surface_state_destroy(struct wlr_surface_state *state) {
+	wl_list_remove(&state->link);
+	surface_state_finish(state);
+	free(state);
+}
+
+/*
+ * Applies queued states in commit order, up to the first one that still
+ * waits for its acquire fence or for the parent of a synchronized subsurface.
+ */
+static void surface_apply_queue(struct wlr_surface *surface) {
+	while (!wl_list_empty(&surface->state_queue)) {
+		struct wlr_surface_state *state =
+			wl_container_of(surface->state_queue.next, state, link);
+		if (state->acquire_fence >= 0) {
+			// Keep showing the previous buffer until the client's GPU is
+			// done rendering the new one
+			surface_wait_acquire_fence(surface, state);
+			if (state->acquire_fence >= 0) {
+				return;
+			}
+		}
+		if (state->synchronized) {
+			return;
 		}
+		surface_commit_state(surface, state);
+		surface_state_destroy(state);
+	}
+}
+
+// Lets the states held back for the parent through
+static void surface_release_synchronized(struct wlr_surface *surface) {
+	struct wlr_surface_state *state;
+	wl_list_for_each(state, &surface->state_queue, link) {
+		state->synchronized = false;
+	}
+	surface_apply_queue(surface);
+}
+
+/*
+ * A subsurface is synchronized if it or any of its ancestors is.
+ */
+static bool subsurface_is_synchronized(struct wlr_subsurface *subsurface) {
+	while (subsurface) {
+		if (subsurface->synchronized) {
+			return true;
+		}
+		if (!subsurface->parent) {
+			return false;
+		}
+		subsurface = subsurface->parent->subsurface;
+	}
+	return false;
+}
+
+static void subsurface_parent_commit(struct wlr_subsurface *subsurface) {
+	subsurface->current = subsurface->pending;
+	// Synchronized children show their new state along with the parent's
+	surface_release_synchronized(subsurface->surface);
+}
+
+// Restacking is double-buffered like the rest of the parent's state
+static void subsurface_list_commit(struct wl_list *list,
+		struct wl_list *pending_list) {
+	struct wlr_subsurface *subsurface;
+	wl_list_for_each(subsurface, pending_list, parent_pending_link) {
+		wl_list_remove(&subsurface->parent_link);
+		wl_list_insert(list->prev, &subsurface->parent_link);
+	}
+}
+
+static void surface_commit_subsurfaces(struct wlr_surface *surface) {
+	subsurface_list_commit(&surface->subsurfaces_below,
+		&surface->subsurfaces_pending_below);
+	subsurface_list_commit(&surface->subsurfaces_above,
+		&surface->subsurfaces_pending_above);
+
+	struct wlr_subsurface *subsurface;
+	wl_list_for_each(subsurface, &surface->subsurfaces_below, parent_link) {
+		subsurface_parent_commit(subsurface);
+	}
+	wl_list_for_each(subsurface, &surface->subsurfaces_above, parent_link) {
+		subsurface_parent_commit(subsurface);
+	}
+}
+
+static void surface_commit(struct wl_client *client,
+		struct wl_resource *resource) {
+	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+
+	// Listeners validate the pending state before it is applied
+	struct wlr_surface_precommit_event event = { .surface = surface };
+	wl_signal_emit(&surface->signals.precommit, &event);
+	if (event.rejected) {
+		// The client is being disconnected, don't act on what it sent
+		surface_state_finish(&surface->pending);
+		surface->pending = (struct wlr_surface_state){0};
+		surface_state_init(&surface->pending);
 		return;
 	}
-	struct wl_shm_buffer *buffer = wl_shm_buffer_get(surface->current.buffer);
-	if (!buffer) {
-		if (wlr_renderer_buffer_is_drm(surface->renderer, surface->pending.buffer)) {
-			wlr_texture_upload_drm(surface->texture, surface->pending.buffer);
-			goto release;
-		} else {
-			wlr_log(L_INFO, "Unknown buffer handle attached");
+
+	// Synchronized subsurfaces are applied on the parent's next commit
+	bool synchronized = surface->subsurface &&
+		subsurface_is_synchronized(surface->subsurface);
+	struct wlr_surface_state *pending = &surface->pending;
+	if (wl_list_empty(&surface->state_queue) && !synchronized &&
+			pending->acquire_fence < 0) {
+		surface_commit_state(surface, pending);
+		return;
+	}
+
+	// Commits held back for the same reason are merged, so a client can't
+	// grow the queue without bounds. A new buffer replaces a fenced one that
+	// was never shown, along with its fence.
+	struct wlr_surface_state *state = NULL;
+	if (!wl_list_empty(&surface->state_queue)) {
+		state = wl_container_of(surface->state_queue.prev, state, link);
+		if (state->synchronized != synchronized &&
+				wl_list_length(&surface->state_queue) >= SURFACE_MAX_QUEUED) {
+			// Toggling the sync mode between commits could still grow the
+			// queue, hold the merged state back for both reasons instead
+			state->synchronized = true;
+		} else if (state->synchronized != synchronized) {
+			state = NULL;
+		}
+		if (state && (pending->invalid & WLR_SURFACE_INVALID_BUFFER) &&
+				state->link.prev == &surface->state_queue) {
+			// Stop waiting on the fence that is about to be closed
+			surface_clear_acquire_fence(surface);
+		}
+	}
+	if (!state) {
+		state = surface_state_create();
+		if (!state) {
+			wl_resource_post_no_memory(resource);
 			return;
 		}
+		state->synchronized = synchronized;
+		wl_list_insert(surface->state_queue.prev, &state->link);
 	}
-	pixman_region32_t damage = surface->current.surface_damage;
-	if (!pixman_region32_not_empty(&damage)) {
-		goto release;
+	surface_state_move(surface, state, pending);
+	surface_apply_queue(surface);
+}
+
+static void surface_upload_damage(struct wlr_surface *surface,
+		struct wl_shm_buffer *buffer, uint32_t format) {
+	// Each update has a fixed cost, trade it against uploading extra pixels
+	struct wlr_region_coalesce_params params = surface->upload_coalesce;
+	if (params.max_boxes < 1) {
+		params.max_boxes = 1;
+	} else if (params.max_boxes > WLR_REGION_COALESCE_MAX_BOXES) {
+		params.max_boxes = WLR_REGION_COALESCE_MAX_BOXES;
 	}
-	int n;
-	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &n);
-	uint32_t format = wl_shm_buffer_get_format(buffer);
+	pixman_box32_t rects[WLR_REGION_COALESCE_MAX_BOXES];
+	uint32_t bpp = wl_shm_buffer_get_stride(buffer) /
+		wl_shm_buffer_get_width(buffer);
+	int n = wlr_region_coalesce(&surface->current.buffer_damage,
+		&params, bpp, rects);
 	for (int i = 0; i < n; ++i) {
 		pixman_box32_t rect = rects[i];
 		if (!wlr_texture_update_shm(surface->texture, format,
@@ -149,28 +718,121 @@ void wlr_surface_flush_damage(struct wlr_surface *surface) {
 			break;
 		}
 	}
-	pixman_region32_fini(&surface->current.surface_damage);
-	pixman_region32_init(&surface->current.surface_damage);
+}
+
+void wlr_surface_get_matrix(struct wlr_surface *surface,
+		float (*matrix)[16], const float (*projection)[16], int x, int y) {
+	float world[16];
+	wlr_matrix_identity(matrix);
+	wlr_matrix_translate(&world, x, y, 0);
+	wlr_matrix_mul(matrix, &world, matrix);
+	wlr_matrix_scale(&world,
+			surface->current.width, surface->current.height, 1);
+	wlr_matrix_mul(matrix, &world, matrix);
+	wlr_matrix_mul(projection, matrix, matrix);
+}
+
+void wlr_surface_flush_damage(struct wlr_surface *surface) {
+	if ((surface->current.invalid & WLR_SURFACE_INVALID_BUFFER)) {
+		// The texture stops sampling from the previous buffer now
+		surface->current.invalid &= ~WLR_SURFACE_INVALID_BUFFER;
+		surface_release_texture_buffer(surface);
+		if (surface->texture_buffer != surface->current.buffer) {
+			surface_set_texture_buffer(surface, NULL);
+		}
+		surface->texture_release = surface->current.buffer_release;
+		surface->current.buffer_release = NULL;
+	}
+	if (!surface->current.buffer) {
+		if (surface->texture->valid) {
+			// TODO: Detach buffers
+		}
+		return;
+	}
+	struct wl_shm_buffer *buffer = wl_shm_buffer_get(surface->current.buffer);
+	if (!buffer) {
+		if (wlr_dmabuf_resource_is_buffer(surface->current.buffer)) {
+			wlr_texture_upload_dmabuf(surface->texture, surface->current.buffer);
+		} else if (wlr_renderer_buffer_is_drm(surface->renderer,
+				surface->current.buffer)) {
+			wlr_texture_upload_drm(surface->texture, surface->current.buffer);
+		} else {
+			wlr_log(L_INFO, "Unknown buffer handle attached");
+			return;
+		}
+		surface_set_texture_buffer(surface, surface->current.buffer);
+		if (surface->texture->width != surface->current.buffer_width ||
+				surface->texture->height != surface->current.buffer_height) {
+			surface->current.buffer_width = surface->texture->width;
+			surface->current.buffer_height = surface->texture->height;
+			surface_update_matrices(surface);
+		}
+		pixman_region32_clear(&surface->current.surface_damage);
+		pixman_region32_clear(&surface->current.buffer_damage);
+		return;
+	}
+	uint32_t format = wl_shm_buffer_get_format(buffer);
+	if (!surface->texture->valid ||
+			surface->texture->width != surface->current.buffer_width ||
+			surface->texture->height != surface->current.buffer_height) {
+		// Nothing to update in place, the whole buffer is needed
+		wlr_texture_upload_shm(surface->texture, format, buffer);
+		goto clear_damage;
+	}
+	if (!pixman_region32_not_empty(&surface->current.buffer_damage)) {
+		goto release;
+	}
+	surface_upload_damage(surface, buffer, format);
+clear_damage:
+	pixman_region32_clear(&surface->current.surface_damage);
+	pixman_region32_clear(&surface->current.buffer_damage);
 release:
+	// shm contents have been copied, the buffer can be reused right away
 	wl_resource_queue_event(surface->current.buffer, WL_BUFFER_RELEASE);
+	if (surface->texture_release) {
+		wlr_linux_buffer_release_send(surface->texture_release, -1);
+		surface->texture_release = NULL;
+	}
 }
 
 static void surface_set_buffer_transform(struct wl_client *client,
 		struct wl_resource *resource, int transform) {
-	wlr_log(L_DEBUG, "TODO: surface surface buffer transform");
+	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+	if (transform < WL_OUTPUT_TRANSFORM_NORMAL ||
+			transform > WL_OUTPUT_TRANSFORM_FLIPPED_270) {
+		wl_resource_post_error(resource, WL_SURFACE_ERROR_INVALID_TRANSFORM,
+			"Invalid buffer transform %d", transform);
+		return;
+	}
+	surface->pending.invalid |= WLR_SURFACE_INVALID_TRANSFORM;
+	surface->pending.transform = transform;
 }
 
 static void surface_set_buffer_scale(struct wl_client *client,
 		struct wl_resource *resource,
 		int32_t scale) {
-	wlr_log(L_DEBUG, "TODO: surface set buffer scale");
+	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+	if (scale <= 0) {
+		wl_resource_post_error(resource, WL_SURFACE_ERROR_INVALID_SCALE,
+			"Invalid buffer scale %d", scale);
+		return;
+	}
+	surface->pending.invalid |= WLR_SURFACE_INVALID_SCALE;
+	surface->pending.scale = scale;
 }
 
 static void surface_damage_buffer(struct wl_client *client,
 		struct wl_resource *resource,
 		int32_t x, int32_t y, int32_t width,
 		int32_t height) {
-	wlr_log(L_DEBUG, "TODO: surface damage buffer");
+	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+	if (width < 0 || height < 0) {
+		return;
+	}
+	surface->pending.invalid |= WLR_SURFACE_INVALID_BUFFER_DAMAGE;
+	pixman_region32_union_rect(&surface->pending.buffer_damage,
+			&surface->pending.buffer_damage,
+			x, y, width, height);
 }
 
 const struct wl_surface_interface surface_interface = {
@@ -188,8 +850,22 @@ const struct wl_surface_interface surface_interface = {
 
 static void destroy_surface(struct wl_resource *resource) {
 	struct wlr_surface *surface = wl_resource_get_user_data(resource);
+	wl_signal_emit(&surface->signals.destroy, surface);
+
+	surface_clear_acquire_fence(surface);
+	struct wlr_surface_state *state, *tmp;
+	wl_list_for_each_safe(state, tmp, &surface->state_queue, link) {
+		surface_state_destroy(state);
+	}
+	surface_state_finish(&surface->pending);
+	surface_state_finish(&surface->current);
+	surface_release_texture_buffer(surface);
+	surface_set_texture_buffer(surface, NULL);
 
 	wlr_texture_destroy(surface->texture);
+	if (surface->frame_timer) {
+		wl_event_source_remove(surface->frame_timer);
+	}
 	struct wlr_frame_callback *cb, *next;
 	wl_list_for_each_safe(cb, next, &surface->frame_callback_list, link) {
 		wl_resource_destroy(cb->resource);
@@ -204,9 +880,235 @@ struct wlr_surface *wlr_surface_create(struct wl_resource *res,
 	surface->renderer = renderer;
 	surface->texture = wlr_render_texture_init(renderer);
 	surface->resource = res;
+	surface->upload_coalesce.call_cost = WLR_REGION_COALESCE_CALL_COST;
+	surface->upload_coalesce.max_boxes = WLR_REGION_COALESCE_MAX_BOXES;
+	surface->hidden_frame_interval = WLR_SURFACE_HIDDEN_FRAME_INTERVAL;
+	surface_state_init(&surface->pending);
+	surface_state_init(&surface->current);
+	surface_update_matrices(surface);
+	wl_signal_init(&surface->signals.precommit);
 	wl_signal_init(&surface->signals.commit);
+	wl_signal_init(&surface->signals.new_subsurface);
+	wl_signal_init(&surface->signals.destroy);
 	wl_list_init(&surface->frame_callback_list);
+	wl_list_init(&surface->state_queue);
+	surface->texture_buffer_destroy.notify =
+		surface_handle_texture_buffer_destroy;
+	wl_list_init(&surface->texture_buffer_destroy.link);
+	wl_list_init(&surface->subsurfaces_below);
+	wl_list_init(&surface->subsurfaces_above);
+	wl_list_init(&surface->subsurfaces_pending_below);
+	wl_list_init(&surface->subsurfaces_pending_above);
 	wl_resource_set_implementation(res, &surface_interface,
 			surface, destroy_surface);
 	return surface;
 }
+
+static void subsurface_unlink_parent(struct wlr_subsurface *subsurface) {
+	wl_list_remove(&subsurface->parent_link);
+	wl_list_init(&subsurface->parent_link);
+	wl_list_remove(&subsurface->parent_pending_link);
+	wl_list_init(&subsurface->parent_pending_link);
+	wl_list_remove(&subsurface->parent_destroy.link);
+	wl_list_init(&subsurface->parent_destroy.link);
+	subsurface->parent = NULL;
+}
+
+static void subsurface_destroy(struct wlr_subsurface *subsurface) {
+	wl_signal_emit(&subsurface->signals.destroy, subsurface);
+	subsurface_unlink_parent(subsurface);
+	wl_list_remove(&subsurface->surface_destroy.link);
+	subsurface->surface->subsurface = NULL;
+	wl_resource_set_user_data(subsurface->resource, NULL);
+	free(subsurface);
+}
+
+static void subsurface_resource_destroy(struct wl_resource *resource) {
+	struct wlr_subsurface *subsurface = wl_resource_get_user_data(resource);
+	if (subsurface) {
+		struct wlr_surface *surface = subsurface->surface;
+		subsurface_destroy(subsurface);
+		// Without the role nothing holds its commits back anymore
+		surface_release_synchronized(surface);
+	}
+}
+
+static void subsurface_handle_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void subsurface_set_position(struct wl_client *client,
+		struct wl_resource *resource, int32_t x, int32_t y) {
+	struct wlr_subsurface *subsurface = wl_resource_get_user_data(resource);
+	if (!subsurface) {
+		return;
+	}
+	subsurface->pending.x = x;
+	subsurface->pending.y = y;
+}
+
+static struct wlr_subsurface *subsurface_find_sibling(
+		struct wlr_subsurface *subsurface, struct wlr_surface *surface) {
+	struct wlr_surface *parent = subsurface->parent;
+	struct wlr_subsurface *sibling;
+	wl_list_for_each(sibling, &parent->subsurfaces_pending_below,
+			parent_pending_link) {
+		if (sibling->surface == surface && sibling != subsurface) {
+			return sibling;
+		}
+	}
+	wl_list_for_each(sibling, &parent->subsurfaces_pending_above,
+			parent_pending_link) {
+		if (sibling->surface == surface && sibling != subsurface) {
+			return sibling;
+		}
+	}
+	return NULL;
+}
+
+static void subsurface_place_above(struct wl_client *client,
+		struct wl_resource *resource, struct wl_resource *sibling_resource) {
+	struct wlr_subsurface *subsurface = wl_resource_get_user_data(resource);
+	if (!subsurface || !subsurface->parent) {
+		return;
+	}
+	struct wlr_surface *sibling_surface =
+		wl_resource_get_user_data(sibling_resource);
+
+	struct wl_list *node;
+	if (sibling_surface == subsurface->parent) {
+		node = &subsurface->parent->subsurfaces_pending_above;
+	} else {
+		struct wlr_subsurface *sibling =
+			subsurface_find_sibling(subsurface, sibling_surface);
+		if (!sibling) {
+			wl_resource_post_error(resource, WL_SUBSURFACE_ERROR_BAD_SURFACE,
+				"place_above: wl_surface@%d is not a parent or sibling",
+				wl_resource_get_id(sibling_resource));
+			return;
+		}
+		node = &sibling->parent_pending_link;
+	}
+
+	wl_list_remove(&subsurface->parent_pending_link);
+	wl_list_insert(node, &subsurface->parent_pending_link);
+}
+
+static void subsurface_place_below(struct wl_client *client,
+		struct wl_resource *resource, struct wl_resource *sibling_resource) {
+	struct wlr_subsurface *subsurface = wl_resource_get_user_data(resource);
+	if (!subsurface || !subsurface->parent) {
+		return;
+	}
+	struct wlr_surface *sibling_surface =
+		wl_resource_get_user_data(sibling_resource);
+
+	struct wl_list *node;
+	if (sibling_surface == subsurface->parent) {
+		node = subsurface->parent->subsurfaces_pending_below.prev;
+	} else {
+		struct wlr_subsurface *sibling =
+			subsurface_find_sibling(subsurface, sibling_surface);
+		if (!sibling) {
+			wl_resource_post_error(resource, WL_SUBSURFACE_ERROR_BAD_SURFACE,
+				"place_below: wl_surface@%d is not a parent or sibling",
+				wl_resource_get_id(sibling_resource));
+			return;
+		}
+		node = sibling->parent_pending_link.prev;
+	}
+
+	wl_list_remove(&subsurface->parent_pending_link);
+	wl_list_insert(node, &subsurface->parent_pending_link);
+}
+
+static void subsurface_set_sync(struct wl_client *client,
+		struct wl_resource *resource) {
+	struct wlr_subsurface *subsurface = wl_resource_get_user_data(resource);
+	if (!subsurface) {
+		return;
+	}
+	subsurface->synchronized = true;
+}
+
+static void subsurface_set_desync(struct wl_client *client,
+		struct wl_resource *resource) {
+	struct wlr_subsurface *subsurface = wl_resource_get_user_data(resource);
+	if (!subsurface || !subsurface->synchronized) {
+		return;
+	}
+	subsurface->synchronized = false;
+
+	// What was held back while synchronized shows up right away now, unless
+	// a parent still holds it back
+	if (!subsurface_is_synchronized(subsurface)) {
+		surface_release_synchronized(subsurface->surface);
+	}
+}
+
+static const struct wl_subsurface_interface subsurface_interface = {
+	.destroy = subsurface_handle_destroy,
+	.set_position = subsurface_set_position,
+	.place_above = subsurface_place_above,
+	.place_below = subsurface_place_below,
+	.set_sync = subsurface_set_sync,
+	.set_desync = subsurface_set_desync,
+};
+
+static void subsurface_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_subsurface *subsurface =
+		wl_container_of(listener, subsurface, surface_destroy);
+	subsurface_destroy(subsurface);
+}
+
+static void subsurface_handle_parent_destroy(struct wl_listener *listener,
+		void *data) {
+	// The subsurface stays around without a parent, unmapped
+	struct wlr_subsurface *subsurface =
+		wl_container_of(listener, subsurface, parent_destroy);
+	subsurface_unlink_parent(subsurface);
+}
+
+struct wlr_subsurface *wlr_surface_make_subsurface(struct wlr_surface *surface,
+		struct wlr_surface *parent, uint32_t id) {
+	struct wl_client *client = wl_resource_get_client(surface->resource);
+
+	struct wlr_subsurface *subsurface =
+		calloc(1, sizeof(struct wlr_subsurface));
+	if (!subsurface) {
+		wl_client_post_no_memory(client);
+		return NULL;
+	}
+	subsurface->resource =
+		wl_resource_create(client, &wl_subsurface_interface, 1, id);
+	if (!subsurface->resource) {
+		free(subsurface);
+		wl_client_post_no_memory(client);
+		return NULL;
+	}
+	subsurface->synchronized = true;
+	wl_signal_init(&subsurface->signals.destroy);
+	subsurface->surface = surface;
+	subsurface->parent = parent;
+	surface->subsurface = subsurface;
+	surface->role = "wl_subsurface";
+
+	subsurface->surface_destroy.notify = subsurface_handle_surface_destroy;
+	wl_resource_add_destroy_listener(surface->resource,
+		&subsurface->surface_destroy);
+	subsurface->parent_destroy.notify = subsurface_handle_parent_destroy;
+	wl_resource_add_destroy_listener(parent->resource,
+		&subsurface->parent_destroy);
+
+	// New subsurfaces are placed on top of their siblings right away
+	wl_list_insert(parent->subsurfaces_above.prev, &subsurface->parent_link);
+	wl_list_insert(parent->subsurfaces_pending_above.prev,
+		&subsurface->parent_pending_link);
+
+	wl_resource_set_implementation(subsurface->resource,
+		&subsurface_interface, subsurface, subsurface_resource_destroy);
+	wl_signal_emit(&parent->signals.new_subsurface, subsurface);
+	return subsurface;
+}
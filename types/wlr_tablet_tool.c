@@ -8,6 +8,7 @@ void wlr_tablet_tool_init(struct wlr_tablet_tool *tool,
 		struct wlr_tablet_tool_impl *impl) {
 	tool->impl = impl;
 	wl_signal_init(&tool->events.axis);
+	wl_signal_init(&tool->events.axis_sample);
 	wl_signal_init(&tool->events.proximity);
 	wl_signal_init(&tool->events.tip);
 	wl_signal_init(&tool->events.button);
@@ -15,9 +16,127 @@ void wlr_tablet_tool_init(struct wlr_tablet_tool *tool,
 
 void wlr_tablet_tool_destroy(struct wlr_tablet_tool *tool) {
 	if (!tool) return;
+	if (tool->coalesce.timer) {
+		wl_event_source_remove(tool->coalesce.timer);
+		tool->coalesce.timer = NULL;
+	}
 	if (tool->impl && tool->impl->destroy) {
 		tool->impl->destroy(tool);
 	} else {
 		free(tool);
 	}
 }
+
+void wlr_tablet_tool_flush_axis(struct wlr_tablet_tool *tool) {
+	if (tool->coalesce.timer_armed) {
+		wl_event_source_timer_update(tool->coalesce.timer, 0);
+		tool->coalesce.timer_armed = false;
+	}
+	if (tool->coalesce.has_axis) {
+		tool->coalesce.has_axis = false;
+		wl_signal_emit(&tool->events.axis, &tool->coalesce.axis);
+	}
+}
+
+static int coalesce_timer_handle(void *data) {
+	struct wlr_tablet_tool *tool = data;
+	tool->coalesce.timer_armed = false;
+	wlr_tablet_tool_flush_axis(tool);
+	return 0;
+}
+
+static void arm_coalesce_timer(struct wlr_tablet_tool *tool) {
+	if (tool->coalesce.timer && !tool->coalesce.timer_armed) {
+		wl_event_source_timer_update(tool->coalesce.timer,
+			tool->coalesce.interval_ms);
+		tool->coalesce.timer_armed = true;
+	}
+}
+
+void wlr_tablet_tool_set_axis_coalescing(struct wlr_tablet_tool *tool,
+		bool enabled, struct wl_event_loop *loop, int interval_ms) {
+	wlr_tablet_tool_flush_axis(tool);
+	if (tool->coalesce.timer) {
+		wl_event_source_remove(tool->coalesce.timer);
+		tool->coalesce.timer = NULL;
+	}
+
+	tool->coalesce.enabled = enabled;
+	tool->coalesce.interval_ms = interval_ms;
+	if (enabled && loop && interval_ms > 0) {
+		tool->coalesce.timer = wl_event_loop_add_timer(loop,
+			coalesce_timer_handle, tool);
+	}
+}
+
+static void merge_axis(struct wlr_event_tablet_tool_axis *pending,
+		struct wlr_event_tablet_tool_axis *event) {
+	uint32_t axes = event->updated_axes;
+	pending->time_sec = event->time_sec;
+	pending->time_usec = event->time_usec;
+	pending->width_mm = event->width_mm;
+	pending->height_mm = event->height_mm;
+	pending->updated_axes |= axes;
+	if (axes & WLR_TABLET_TOOL_AXIS_X) {
+		pending->x_mm = event->x_mm;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_Y) {
+		pending->y_mm = event->y_mm;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_PRESSURE) {
+		pending->pressure = event->pressure;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_DISTANCE) {
+		pending->distance = event->distance;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_TILT_X) {
+		pending->tilt_x = event->tilt_x;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_TILT_Y) {
+		pending->tilt_y = event->tilt_y;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_ROTATION) {
+		pending->rotation = event->rotation;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_SLIDER) {
+		pending->slider = event->slider;
+	}
+	if (axes & WLR_TABLET_TOOL_AXIS_WHEEL) {
+		pending->wheel_delta += event->wheel_delta;
+	}
+}
+
+void wlr_tablet_tool_notify_axis(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_axis *event) {
+	wl_signal_emit(&tool->events.axis_sample, event);
+	if (!tool->coalesce.enabled) {
+		wl_signal_emit(&tool->events.axis, event);
+		return;
+	}
+
+	if (tool->coalesce.has_axis) {
+		merge_axis(&tool->coalesce.axis, event);
+	} else {
+		tool->coalesce.axis = *event;
+		tool->coalesce.has_axis = true;
+	}
+	arm_coalesce_timer(tool);
+}
+
+void wlr_tablet_tool_notify_proximity(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_proximity *event) {
+	wlr_tablet_tool_flush_axis(tool);
+	wl_signal_emit(&tool->events.proximity, event);
+}
+
+void wlr_tablet_tool_notify_tip(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_tip *event) {
+	wlr_tablet_tool_flush_axis(tool);
+	wl_signal_emit(&tool->events.tip, event);
+}
+
+void wlr_tablet_tool_notify_button(struct wlr_tablet_tool *tool,
+		struct wlr_event_tablet_tool_button *event) {
+	wlr_tablet_tool_flush_axis(tool);
+	wl_signal_emit(&tool->events.button, event);
+}
@@ -11,6 +11,8 @@ void wlr_touch_init(struct wlr_touch *touch,
 	wl_signal_init(&touch->events.up);
 	wl_signal_init(&touch->events.motion);
 	wl_signal_init(&touch->events.cancel);
+	wl_signal_init(&touch->events.frame);
+	touch->pending.n_points = 0;
 }
 
 void wlr_touch_destroy(struct wlr_touch *touch) {
@@ -20,3 +22,94 @@ void wlr_touch_destroy(struct wlr_touch *touch) {
 		free(touch);
 	}
 }
+
+static void emit_frame(struct wlr_touch *touch,
+		struct wlr_event_touch_frame *event) {
+	if (touch->pending.n_points == 0) {
+		return;
+	}
+	event->width_mm = touch->pending.width_mm;
+	event->height_mm = touch->pending.height_mm;
+	event->n_points = touch->pending.n_points;
+	event->points = touch->pending.points;
+	wl_signal_emit(&touch->events.frame, event);
+	touch->pending.n_points = 0;
+}
+
+static struct wlr_touch_point *last_point(struct wlr_touch *touch,
+		int32_t slot) {
+	for (size_t i = touch->pending.n_points; i-- > 0;) {
+		if (touch->pending.points[i].slot == slot) {
+			return &touch->pending.points[i];
+		}
+	}
+	return NULL;
+}
+
+static struct wlr_touch_point *add_point(struct wlr_touch *touch,
+		uint32_t time_sec, uint64_t time_usec, int32_t slot,
+		enum wlr_touch_point_state state) {
+	if (touch->pending.n_points == WLR_TOUCH_FRAME_MAX_POINTS) {
+		struct wlr_event_touch_frame frame = {
+			.time_sec = time_sec,
+			.time_usec = time_usec,
+		};
+		emit_frame(touch, &frame);
+	}
+	struct wlr_touch_point *point =
+		&touch->pending.points[touch->pending.n_points++];
+	point->slot = slot;
+	point->state = state;
+	point->x_mm = point->y_mm = 0;
+	return point;
+}
+
+void wlr_touch_notify_down(struct wlr_touch *touch,
+		struct wlr_event_touch_down *event) {
+	wl_signal_emit(&touch->events.down, event);
+	struct wlr_touch_point *point = add_point(touch, event->time_sec,
+		event->time_usec, event->slot, WLR_TOUCH_POINT_DOWN);
+	point->x_mm = event->x_mm;
+	point->y_mm = event->y_mm;
+	touch->pending.width_mm = event->width_mm;
+	touch->pending.height_mm = event->height_mm;
+}
+
+void wlr_touch_notify_up(struct wlr_touch *touch,
+		struct wlr_event_touch_up *event) {
+	wl_signal_emit(&touch->events.up, event);
+	add_point(touch, event->time_sec, event->time_usec, event->slot,
+		WLR_TOUCH_POINT_UP);
+}
+
+void wlr_touch_notify_motion(struct wlr_touch *touch,
+		struct wlr_event_touch_motion *event) {
+	wl_signal_emit(&touch->events.motion, event);
+	struct wlr_touch_point *point = last_point(touch, event->slot);
+	if (!point || point->state == WLR_TOUCH_POINT_UP) {
+		point = add_point(touch, event->time_sec, event->time_usec,
+			event->slot, WLR_TOUCH_POINT_MOTION);
+	}
+	point->x_mm = event->x_mm;
+	point->y_mm = event->y_mm;
+	touch->pending.width_mm = event->width_mm;
+	touch->pending.height_mm = event->height_mm;
+}
+
+void wlr_touch_notify_cancel(struct wlr_touch *touch,
+		struct wlr_event_touch_cancel *event) {
+	// The point is gone, nothing of it is left to send in the frame
+	size_t n = 0;
+	for (size_t i = 0; i < touch->pending.n_points; ++i) {
+		if (touch->pending.points[i].slot != event->slot) {
+			touch->pending.points[n++] = touch->pending.points[i];
+		}
+	}
+	touch->pending.n_points = n;
+	wl_signal_emit(&touch->events.cancel, event);
+}
+
+void wlr_touch_notify_frame(struct wlr_touch *touch,
+		struct wlr_event_touch_frame *event) {
+	emit_frame(touch, event);
+}
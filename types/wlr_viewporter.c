@@ -0,0 +1,266 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/types/wlr_viewporter.h>
+#include <wlr/util/log.h>
+#include "viewporter-protocol.h"
+
+static void viewport_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void viewport_set_source(struct wl_client *client,
+		struct wl_resource *resource, wl_fixed_t x, wl_fixed_t y,
+		wl_fixed_t width, wl_fixed_t height) {
+	struct wlr_viewport *viewport = wl_resource_get_user_data(resource);
+	if (!viewport) {
+		wl_resource_post_error(resource, WP_VIEWPORT_ERROR_NO_SURFACE,
+			"the surface has been destroyed");
+		return;
+	}
+	struct wlr_surface_state *pending = &viewport->surface->pending;
+
+	if (x == wl_fixed_from_int(-1) && y == wl_fixed_from_int(-1) &&
+			width == wl_fixed_from_int(-1) && height == wl_fixed_from_int(-1)) {
+		pending->viewport.has_src = false;
+	} else if (x < 0 || y < 0 || width <= 0 || height <= 0) {
+		wl_resource_post_error(resource, WP_VIEWPORT_ERROR_BAD_VALUE,
+			"invalid source rectangle");
+		return;
+	} else {
+		pending->viewport.has_src = true;
+		pending->viewport.src_x = wl_fixed_to_double(x);
+		pending->viewport.src_y = wl_fixed_to_double(y);
+		pending->viewport.src_width = wl_fixed_to_double(width);
+		pending->viewport.src_height = wl_fixed_to_double(height);
+	}
+	pending->invalid |= WLR_SURFACE_INVALID_VIEWPORT;
+}
+
+static void viewport_set_destination(struct wl_client *client,
+		struct wl_resource *resource, int32_t width, int32_t height) {
+	struct wlr_viewport *viewport = wl_resource_get_user_data(resource);
+	if (!viewport) {
+		wl_resource_post_error(resource, WP_VIEWPORT_ERROR_NO_SURFACE,
+			"the surface has been destroyed");
+		return;
+	}
+	struct wlr_surface_state *pending = &viewport->surface->pending;
+
+	if (width == -1 && height == -1) {
+		pending->viewport.has_dst = false;
+	} else if (width <= 0 || height <= 0) {
+		wl_resource_post_error(resource, WP_VIEWPORT_ERROR_BAD_VALUE,
+			"invalid destination size");
+		return;
+	} else {
+		pending->viewport.has_dst = true;
+		pending->viewport.dst_width = width;
+		pending->viewport.dst_height = height;
+	}
+	pending->invalid |= WLR_SURFACE_INVALID_VIEWPORT;
+}
+
+static const struct wp_viewport_interface viewport_impl = {
+	.destroy = viewport_destroy,
+	.set_source = viewport_set_source,
+	.set_destination = viewport_set_destination,
+};
+
+static void viewport_finish(struct wlr_viewport *viewport) {
+	wl_list_remove(&viewport->surface_destroy.link);
+	wl_list_remove(&viewport->surface_precommit.link);
+	wl_resource_set_user_data(viewport->resource, NULL);
+	free(viewport);
+}
+
+static void viewport_resource_destroy(struct wl_resource *resource) {
+	struct wlr_viewport *viewport = wl_resource_get_user_data(resource);
+	if (!viewport) {
+		return;
+	}
+
+	// The surface goes back to its normal size on the next commit
+	struct wlr_surface_state *pending = &viewport->surface->pending;
+	pending->viewport.has_src = false;
+	pending->viewport.has_dst = false;
+	pending->invalid |= WLR_SURFACE_INVALID_VIEWPORT;
+	viewport_finish(viewport);
+}
+
+static void handle_surface_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_viewport *viewport =
+		wl_container_of(listener, viewport, surface_destroy);
+	viewport_finish(viewport);
+}
+
+/*
+ * Gets the size of the buffer the pending state will show, in surface
+ * coordinates before the viewport is applied. Returns false if it is not
+ * known yet, e.g. for buffers only sized once uploaded.
+ */
+static bool pending_buffer_size(struct wlr_surface *surface,
+		int32_t *width, int32_t *height) {
+	struct wlr_surface_state *pending = &surface->pending;
+	struct wlr_surface_state *current = &surface->current;
+
+	int32_t buffer_width = current->buffer_width;
+	int32_t buffer_height = current->buffer_height;
+	if ((pending->invalid & WLR_SURFACE_INVALID_BUFFER)) {
+		struct wl_shm_buffer *shm = pending->buffer ?
+			wl_shm_buffer_get(pending->buffer) : NULL;
+		if (!shm) {
+			return false;
+		}
+		buffer_width = wl_shm_buffer_get_width(shm);
+		buffer_height = wl_shm_buffer_get_height(shm);
+	}
+	if (buffer_width <= 0 || buffer_height <= 0) {
+		return false;
+	}
+
+	int32_t scale = (pending->invalid & WLR_SURFACE_INVALID_SCALE) ?
+		pending->scale : current->scale;
+	uint32_t transform = (pending->invalid & WLR_SURFACE_INVALID_TRANSFORM) ?
+		pending->transform : current->transform;
+	*width = buffer_width / scale;
+	*height = buffer_height / scale;
+	if (transform % 2 == 1) {
+		int32_t tmp = *width;
+		*width = *height;
+		*height = tmp;
+	}
+	return true;
+}
+
+static void handle_surface_precommit(struct wl_listener *listener, void *data) {
+	struct wlr_viewport *viewport =
+		wl_container_of(listener, viewport, surface_precommit);
+	struct wlr_surface_precommit_event *event = data;
+	struct wlr_surface_state *pending = &viewport->surface->pending;
+	if (!pending->viewport.has_src) {
+		return;
+	}
+
+	if (!pending->viewport.has_dst &&
+			(pending->viewport.src_width != (int32_t)pending->viewport.src_width ||
+			pending->viewport.src_height != (int32_t)pending->viewport.src_height)) {
+		wl_resource_post_error(viewport->resource, WP_VIEWPORT_ERROR_BAD_SIZE,
+			"the source size must be integer if no destination is set");
+		event->rejected = true;
+		return;
+	}
+
+	int32_t width, height;
+	if (pending_buffer_size(viewport->surface, &width, &height) &&
+			(pending->viewport.src_x + pending->viewport.src_width > width ||
+			pending->viewport.src_y + pending->viewport.src_height > height)) {
+		wl_resource_post_error(viewport->resource,
+			WP_VIEWPORT_ERROR_OUT_OF_BUFFER,
+			"the source rectangle extends outside of the buffer");
+		event->rejected = true;
+	}
+}
+
+static void viewporter_get_viewport(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource) {
+	struct wlr_surface *surface = wl_resource_get_user_data(surface_resource);
+
+	if (wl_resource_get_destroy_listener(surface_resource,
+			handle_surface_destroy)) {
+		wl_resource_post_error(resource, WP_VIEWPORTER_ERROR_VIEWPORT_EXISTS,
+			"the surface already has a viewport");
+		return;
+	}
+
+	struct wlr_viewport *viewport = calloc(1, sizeof(struct wlr_viewport));
+	if (!viewport) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	viewport->resource = wl_resource_create(client, &wp_viewport_interface,
+		wl_resource_get_version(resource), id);
+	if (!viewport->resource) {
+		free(viewport);
+		wl_client_post_no_memory(client);
+		return;
+	}
+	viewport->surface = surface;
+
+	viewport->surface_destroy.notify = handle_surface_destroy;
+	wl_resource_add_destroy_listener(surface_resource,
+		&viewport->surface_destroy);
+	viewport->surface_precommit.notify = handle_surface_precommit;
+	wl_signal_add(&surface->signals.precommit, &viewport->surface_precommit);
+
+	wl_resource_set_implementation(viewport->resource, &viewport_impl,
+		viewport, viewport_resource_destroy);
+}
+
+static void viewporter_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static const struct wp_viewporter_interface viewporter_impl = {
+	.destroy = viewporter_destroy,
+	.get_viewport = viewporter_get_viewport,
+};
+
+static void viewporter_resource_destroy(struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void viewporter_bind(struct wl_client *wl_client, void *_viewporter,
+		uint32_t version, uint32_t id) {
+	struct wlr_viewporter *viewporter = _viewporter;
+	assert(wl_client && viewporter);
+	if (version > 1) {
+		wlr_log(L_ERROR, "Client requested unsupported wp_viewporter version, disconnecting");
+		wl_client_destroy(wl_client);
+		return;
+	}
+	struct wl_resource *wl_resource = wl_resource_create(wl_client,
+		&wp_viewporter_interface, version, id);
+	if (!wl_resource) {
+		wl_client_post_no_memory(wl_client);
+		return;
+	}
+	wl_resource_set_implementation(wl_resource, &viewporter_impl,
+		viewporter, viewporter_resource_destroy);
+	wl_list_insert(&viewporter->wl_resources, wl_resource_get_link(wl_resource));
+}
+
+struct wlr_viewporter *wlr_viewporter_create(struct wl_display *display) {
+	struct wlr_viewporter *viewporter =
+		calloc(1, sizeof(struct wlr_viewporter));
+	if (!viewporter) {
+		return NULL;
+	}
+	wl_list_init(&viewporter->wl_resources);
+	viewporter->wl_global = wl_global_create(display, &wp_viewporter_interface,
+		1, viewporter, viewporter_bind);
+	if (!viewporter->wl_global) {
+		free(viewporter);
+		return NULL;
+	}
+	return viewporter;
+}
+
+void wlr_viewporter_destroy(struct wlr_viewporter *viewporter) {
+	if (!viewporter) {
+		return;
+	}
+	struct wl_resource *resource, *tmp_resource;
+	wl_resource_for_each_safe(resource, tmp_resource,
+			&viewporter->wl_resources) {
+		wl_resource_set_user_data(resource, NULL);
+		wl_list_remove(wl_resource_get_link(resource));
+		wl_list_init(wl_resource_get_link(resource));
+	}
+	wl_global_destroy(viewporter->wl_global);
+	free(viewporter);
+}